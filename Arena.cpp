@@ -0,0 +1,121 @@
+#include "Arena.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+// PRE: This object is not defined.
+// POST: This object is defined and holds no memory.
+Arena::Arena(): mBlocks( 0 ), mNext( 0 ), mEnd( 0 ), mUsed( 0 )
+{}
+
+// PRE: This object is defined.
+// POST: Every block of the arena is released.
+Arena::~Arena()
+{
+	while( mBlocks != 0 )
+	{
+		Block *next = mBlocks->next;
+		free( mBlocks );
+		mBlocks = next;
+	}
+}
+
+// PRE: This object is defined.
+// POST: A block with room for at least size bytes is current.
+void Arena::addBlock( size_t size )
+{
+	if( size < ARENA_BLOCK )
+		size = ARENA_BLOCK;
+
+	//The header is padded so the data after it is max aligned.
+	size_t header = ( sizeof( Block ) + alignof( max_align_t ) - 1 ) & ~( alignof( max_align_t ) - 1 );
+	Block *block = (Block *)malloc( header + size );
+	block->next = mBlocks;
+	block->size = size;
+	mBlocks = block;
+	mNext = (char *)block + header;
+	mEnd = mNext + size;
+}
+
+// PRE: This object is defined and align is a power of two.
+// POST: The RV is size bytes aligned to align that stay valid
+//		until reset() or the arena is destroyed.
+void *Arena::allocate( size_t size, size_t align )
+{
+	uintptr_t start = ( (uintptr_t)mNext + align - 1 ) & ~( (uintptr_t)align - 1 );
+	if( mBlocks == 0 || start + size > (uintptr_t)mEnd )
+	{
+		addBlock( size + align );
+		start = ( (uintptr_t)mNext + align - 1 ) & ~( (uintptr_t)align - 1 );
+	}
+
+	mNext = (char *)( start + size );
+	mUsed += size;
+	return (void *)start;
+}
+
+// PRE: This object and str are defined.
+// POST: The RV is a copy of str in the arena.
+char *Arena::copyString( const char *str )
+{
+	size_t length = strlen( str ) + 1;
+	char *copy = (char *)allocate( length, 1 );
+	memcpy( copy, str, length );
+	return copy;
+}
+
+// PRE: This object is defined.
+// POST: Every allocation is released. The first block is kept
+//		for the next run and the rest are freed.
+void Arena::reset()
+{
+	if( mBlocks == 0 )
+		return;
+
+	while( mBlocks->next != 0 )
+	{
+		Block *next = mBlocks->next;
+		free( mBlocks );
+		mBlocks = next;
+	}
+
+	size_t header = ( sizeof( Block ) + alignof( max_align_t ) - 1 ) & ~( alignof( max_align_t ) - 1 );
+	mNext = (char *)mBlocks + header;
+	mEnd = mNext + mBlocks->size;
+	mUsed = 0;
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+void testArenaAllocate()
+{
+	Arena a;
+	char *c = (char *)a.allocate( 1, 1 );
+	double *d = (double *)a.allocate( sizeof( double ), alignof( double ) );
+	assert( (uintptr_t)d % alignof( double ) == 0 );
+	assert( (char *)d > c );
+
+	//Enough to need more than one block, and one bigger than a block.
+	for( int i = 0; i < 1000; i++ )
+		memset( a.allocate( 100 ), i, 100 );
+	char *big = (char *)a.allocate( ARENA_BLOCK * 2 );
+	memset( big, 0, ARENA_BLOCK * 2 );
+
+	char *s = a.copyString( "lw $t0, x" );
+	assert( strcmp( s, "lw $t0, x" ) == 0 );
+}
+
+void testArenaReset()
+{
+	Arena a;
+	void *first = a.allocate( 16 );
+	for( int i = 0; i < 10; i++ )
+		a.allocate( ARENA_BLOCK / 2 );
+	assert( a.used() > ARENA_BLOCK );
+
+	a.reset();
+	assert( a.used() == 0 );
+	assert( a.allocate( 16 ) == first );
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef __ARENA__
+#define __ARENA__
+#include <stddef.h>
+
+/*
+    Arena: A bump pointer allocator for memory that lives exactly as long
+    as one assembly run. Allocations are carved out of large blocks one
+    after the other and are never freed on their own, everything is
+    released at once by reset() or when the arena is destroyed. Nothing
+    that is put in an arena has its destructor run.
+*/
+
+//Size of the blocks the arena carves its allocations out of.
+#define ARENA_BLOCK ( 64 * 1024 )
+
+class Arena
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined and holds no memory.
+		Arena();
+		// PRE: This object is defined.
+		// POST: Every block of the arena is released.
+		~Arena();
+
+		// PRE: This object is defined and align is a power of two.
+		// POST: The RV is size bytes aligned to align that stay valid
+		//		until reset() or the arena is destroyed.
+		void *allocate( size_t size, size_t align = alignof( max_align_t ) );
+
+		// PRE: This object and str are defined.
+		// POST: The RV is a copy of str in the arena.
+		char *copyString( const char *str );
+
+		// PRE: This object is defined.
+		// POST: Every allocation is released. The first block is kept
+		//		for the next run and the rest are freed.
+		void reset();
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of bytes allocated since the last reset.
+		size_t used() const { return mUsed; }
+	private:
+		// Disallow copying, the arena owns its blocks.
+		Arena( const Arena & );
+		Arena &operator=( const Arena & );
+
+		typedef struct __block
+		{
+			struct __block *next;//The block allocated before this one.
+			size_t size;//Bytes after the header.
+		}Block;
+
+		// PRE: This object is defined.
+		// POST: A block with room for at least size bytes is current.
+		void addBlock( size_t size );
+
+		Block *mBlocks;//The current block, the newest.
+		char *mNext;//Next free byte of the current block.
+		char *mEnd;//One past the last byte of the current block.
+		size_t mUsed;
+};
+
+#ifdef TESTING
+// Tests that allocations are aligned and may span several blocks.
+void testArenaAllocate();
+// Tests that a reset arena hands its first block out again.
+void testArenaReset();
+#endif
+
+#endif
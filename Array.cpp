@@ -0,0 +1,27 @@
+#ifdef TESTING
+#include "Array.h"
+#include <assert.h>
+
+void testArrayAdd()
+{
+	Array<int> t;
+	for( int i = 0; i < 100; i++ )
+		t.add( i );
+
+	assert( t.length() == 100 );
+	for( int i = 0; i < 100; i++ )
+		assert( t[i] == i );
+}
+
+void testArrayResize()
+{
+	Array<int> t;
+	t.add( 7 );
+	t.resize( 50 );
+	assert( t.length() == 50 );
+	assert( t[0] == 7 );
+	t.clear();
+	assert( t.length() == 0 );
+}
+
+#endif
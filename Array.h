@@ -0,0 +1,96 @@
+#pragma once
+#ifndef __ARRAY__
+#define __ARRAY__
+#include <string.h>
+
+/*
+    Array: A growable array that keeps its elements next to each other in
+    memory. Unlike List it gives constant time access by index, which is
+    what the parser tables that are walked front to back want.
+*/
+template <class T> class Array
+{
+	public:
+		Array();
+		~Array();
+		void add( const T &obj );
+		void reserve( unsigned int capacity );
+		void resize( unsigned int length );
+		// PRE: This object is defined and index < length().
+		// POST: The RV is the element at index.
+		T &operator[]( unsigned int index ) { return mData[index]; }
+		const T &operator[]( unsigned int index ) const { return mData[index]; }
+		// PRE: This object is defined.
+		// POST: The RV is the first element or 0 when empty.
+		T *data() { return mData; }
+		const T *data() const { return mData; }
+		// PRE: This object is defined.
+		// POST: The RV is the number of elements.
+		unsigned int length() const { return mLength; }
+		// PRE: This object is defined.
+		// POST: The array is empty, its memory is kept for reuse.
+		void clear() { mLength = 0; }
+	private:
+		// Disallow copying, the array owns its memory.
+		Array( const Array & );
+		Array &operator=( const Array & );
+
+		T *mData;
+		unsigned int mLength;
+		unsigned int mCapacity;
+};
+
+// PRE: This object is not defined.
+// POST: This object is defined and is empty.
+template <class T> Array<T>::Array(): mData( 0 ), mLength( 0 ), mCapacity( 0 )
+{}
+
+// PRE: This object is defined.
+// POST: The memory held by this object is released.
+template <class T> Array<T>::~Array()
+{
+	delete [] mData;
+}
+
+// PRE: This object is defined.
+// POST: There is room for at least capacity elements without growing.
+template <class T> void Array<T>::reserve( unsigned int capacity )
+{
+	if( capacity > mCapacity )
+	{
+		T *temp = new T[capacity];
+		for( unsigned int i = 0; i < mLength; i++ )
+			temp[i] = mData[i];
+		delete [] mData;
+		mData = temp;
+		mCapacity = capacity;
+	}
+}
+
+// PRE: This object is defined.
+// POST: The array holds length elements, new elements are left as
+//		default constructed.
+template <class T> void Array<T>::resize( unsigned int length )
+{
+	if( length > mCapacity )
+		reserve( length > mCapacity * 2 ? length : mCapacity * 2 );
+	mLength = length;
+}
+
+// PRE: This object is defined and as is obj.
+// POST: obj is copied onto the end of this array.
+template <class T> void Array<T>::add( const T &obj )
+{
+	if( mLength == mCapacity )
+		reserve( mCapacity == 0 ? 16 : mCapacity * 2 );
+	mData[mLength++] = obj;
+}
+
+#ifdef TESTING
+// Tests the array insertion and index access.
+void testArrayAdd();
+// Tests that resize keeps the existing elements.
+void testArrayResize();
+#endif
+
+#endif
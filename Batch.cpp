@@ -0,0 +1,196 @@
+#include "Batch.h"
+#include "ThreadPool.h"
+#include "SourceReader.h"
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+using std::endl;
+
+/*
+	BatchResult is what is kept of one file once its parser is gone.
+*/
+typedef struct __batchresult
+{
+	bool ok;
+	bool cached;
+	uint32_t codeWords;
+	uint32_t words;
+	uint32_t errors;
+	uint32_t removed;//Loads and stores the optimizer left out.
+	uint32_t promoted;//Variables the optimizer put in registers.
+	uint32_t unreachable;//Words --strip left out.
+	double seconds;
+	std::string log;//What the parser reported.
+}BatchResult;
+
+typedef struct __batch
+{
+	char **files;
+	const BatchOptions *options;
+	BatchResult *results;
+}Batch;
+
+// PRE: context is a Batch and index < the number of files in it.
+// POST: The file at index is assembled and its result is filled in.
+static void assembleFile( uint32_t index, void *context )
+{
+	Batch &batch = *(Batch *)context;
+	BatchResult &result = batch.results[index];
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::ostringstream log;
+	Parser parser( batch.files[index] );
+	parser.setLog( &log );
+	parser.setWritePreProcessed( batch.options->writePreProcessed );
+	parser.setIncremental( batch.options->incremental );
+	parser.setCache( batch.options->cache );
+	parser.setOutputFormat( batch.options->format );
+	parser.setThreads( batch.options->threads );
+	parser.setOptimize( batch.options->optimize );
+	parser.setStrip( batch.options->strip );
+	for( uint32_t i = 0; i < batch.options->roots->length(); i++ )
+		parser.addRoot( ( *batch.options->roots )[i] );
+	parser.preprocess();
+	parser.parse();
+
+	result.errors = parser.getErrors();
+	result.ok = result.errors == 0 && parser.wasWritten();
+	result.cached = parser.wasCached();
+	result.words = parser.getWordCount();
+	result.codeWords = parser.wasWritten() ? parser.getCodeWords() : 0;
+	result.removed = parser.getRemovedWords();
+	result.promoted = parser.getPromoted();
+	result.unreachable = parser.getUnreachable();
+	result.log = log.str();
+	result.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// PRE: options and out are defined, files holds count file names.
+// POST: Every file is assembled and the report of each file and of the
+//		batch is written to out. The RV is the number of files that
+//		failed.
+uint32_t assembleBatch( char **files, uint32_t count, const BatchOptions &options, std::ostream &out )
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	BatchResult *results = new BatchResult[count];
+	Batch batch = { files, &options, results };
+
+	ThreadPool pool( options.jobs );
+	pool.run( count, assembleFile, &batch );
+
+	uint32_t failed = 0;
+	uint64_t words = 0;
+	for( uint32_t i = 0; i < count; i++ )
+	{
+		BatchResult &result = results[i];
+		out << result.log << files[i] << ": ";
+		if( result.ok )
+		{
+			out << ( result.cached ? "ok from cache, " : "ok, " ) << result.codeWords << " code words, "
+				<< result.words - result.codeWords << " data words, ";
+			if( options.optimize != 0 )
+				out << result.removed << " loads and stores removed, ";
+			if( options.optimize >= 2 )
+				out << result.promoted << " variables promoted, ";
+			if( options.strip )
+				out << result.unreachable << " unreachable words removed, ";
+			out << result.seconds * 1000 << " ms" << endl;
+			words += result.words;
+		}
+		else
+		{
+			out << "failed, " << result.errors << ( result.errors == 1 ? " error" : " errors" ) << endl;
+			failed++;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	out << count << " files, " << count - failed << " assembled, " << failed << " failed, "
+		<< words << " words in " << seconds << " s on " << pool.threads() << " jobs" << endl;
+
+	delete [] results;
+	return failed;
+}
+
+// PRE: file, files and arena are defined.
+// POST: The file names listed in file are added to files, the names are
+//		kept in arena. The RV is false if file could not be opened.
+bool readResponseFile( const char *file, Array<char *> &files, Arena &arena )
+{
+	SourceReader reader;
+	if( !reader.open( file ) )
+		return false;
+
+	std::string_view line;
+	while( reader.nextLine( line ) )
+	{
+		size_t first = line.find_first_not_of( " \t\r" );
+		if( first == std::string_view::npos || line[first] == '#' )
+			continue;
+		size_t last = line.find_last_not_of( " \t\r" );
+
+		char *name = (char *)arena.allocate( last - first + 2, 1 );
+		memcpy( name, line.data() + first, last - first + 1 );
+		name[last - first + 1] = '\0';
+		files.add( name );
+	}
+	return true;
+}
+
+#ifdef TESTING
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+void testBatchAssemble()
+{
+	char good[] = "testBatchGood.tmp";
+	char bad[] = "testBatchBad.tmp";
+	char missing[] = "testBatchMissing.tmp";
+	FILE *file = fopen( good, "w" );
+	fputs( "lw $a0, x\nout $a0\nhalt\n", file );
+	fclose( file );
+	file = fopen( bad, "w" );
+	fputs( "add $a0, $t9, $a1\nhalt\n", file );
+	fclose( file );
+
+	char *files[3] = { good, bad, missing };
+	Array<char *> roots;
+	BatchOptions options = { false, false, Formats::HEX, 1, 2, 0, 0, false, &roots };
+	std::ostringstream out;
+	assert( assembleBatch( files, 3, options, out ) == 2 );
+
+	std::string report = out.str();
+	assert( report.find( "testBatchGood.tmp: ok, 3 code words, 1 data words" ) != std::string::npos );
+	assert( report.find( "Unknown register $t9" ) < report.find( "testBatchBad.tmp: failed, 1 error" ) );
+	assert( report.find( "testBatchMissing.tmp could not be opened." ) != std::string::npos );
+	assert( report.find( "3 files, 1 assembled, 2 failed, 4 words" ) != std::string::npos );
+	assert( access( "testBatchGood.tmp.bin", F_OK ) == 0 );
+
+	remove( good );
+	remove( bad );
+	remove( "testBatchGood.tmp.bin" );
+	remove( "testBatchBad.tmp.bin" );
+}
+
+void testBatchResponseFile()
+{
+	const char *name = "testBatchList.tmp";
+	FILE *file = fopen( name, "w" );
+	fputs( "# modules\none.s\n\n  two words.s \t\r\nthree.s", file );
+	fclose( file );
+
+	Arena arena;
+	Array<char *> files;
+	assert( readResponseFile( name, files, arena ) );
+	assert( files.length() == 3 );
+	assert( strcmp( files[0], "one.s" ) == 0 );
+	assert( strcmp( files[1], "two words.s" ) == 0 );
+	assert( strcmp( files[2], "three.s" ) == 0 );
+	assert( !readResponseFile( "testBatchNoList.tmp", files, arena ) );
+	remove( name );
+}
+#endif
@@ -0,0 +1,52 @@
+/*
+    Batch: Assembles many files in one process.
+
+    Every file gets a Parser of its own and the parsers share nothing, so
+    the files are handed out to a ThreadPool of jobs threads. What each
+    parser reports is kept with its result and printed in the order the
+    files were given, followed by a line for the file and a summary of the
+    whole batch.
+
+    A response file, given as @name, holds one file name per line. Blank
+    lines and lines starting with '#' are skipped.
+*/
+
+#ifndef __BATCH__
+#define __BATCH__
+
+#include <stdint.h>
+#include <iosfwd>
+#include "Parser.h"
+
+typedef struct __batchoptions
+{
+	bool writePreProcessed;
+	bool incremental;//See Parser::setIncremental.
+	Formats::Format format;
+	uint32_t threads;//Threads for each file, see Parser::setThreads.
+	uint32_t jobs;//Files assembled at once, 0 means one per core.
+	const Cache *cache;//0 for none, see Parser::setCache.
+	uint32_t optimize;//The level, 0 for none, see Parser::setOptimize.
+	bool strip;//See Parser::setStrip.
+	const Array<char *> *roots;//Lables --strip keeps, see Parser::addRoot.
+}BatchOptions;
+
+// PRE: options and out are defined, files holds count file names.
+// POST: Every file is assembled and the report of each file and of the
+//		batch is written to out. The RV is the number of files that
+//		failed.
+uint32_t assembleBatch( char **files, uint32_t count, const BatchOptions &options, std::ostream &out );
+
+// PRE: file, files and arena are defined.
+// POST: The file names listed in file are added to files, the names are
+//		kept in arena. The RV is false if file could not be opened.
+bool readResponseFile( const char *file, Array<char *> &files, Arena &arena );
+
+#ifdef TESTING
+// Tests that a batch assembles every file and reports the ones that fail.
+void testBatchAssemble();
+// Tests reading the file names out of a response file.
+void testBatchResponseFile();
+#endif
+
+#endif
@@ -0,0 +1,414 @@
+#include "Cache.h"
+#include "Parser.h"
+#include "Emitter.h"
+#include "Array.h"
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <atomic>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Temporary files older than this many seconds were left by a parser that
+//was stopped.
+#define CACHE_STALE 600
+//Chars of an entry name, the key in hex.
+#define CACHE_NAME 32
+//Bytes read at a time when an entry is stored.
+#define CACHE_READ ( 64 * 1024 )
+
+// PRE: source is defined, options holds every setting that changes the
+//		output.
+// POST: The RV is the key of source assembled with options by this
+//		version of the assembler.
+CacheKey makeCacheKey( std::string_view source, uint32_t options )
+{
+	//Two FNV-1a hashes from different starting points.
+	uint64_t prefix[3] = { ASSEMBLER_VERSION, options, source.length() };
+	uint64_t high = 14695981039346656037ull;
+	uint64_t low = 0x6A09E667F3BCC908ull;
+	const unsigned char *bytes = (const unsigned char *)prefix;
+	for( size_t i = 0; i < sizeof( prefix ); i++ )
+	{
+		high = ( high ^ bytes[i] ) * 1099511628211ull;
+		low = ( low ^ bytes[i] ) * 1099511628211ull;
+	}
+
+	bytes = (const unsigned char *)source.data();
+	for( size_t i = 0; i < source.length(); i++ )
+	{
+		high = ( high ^ bytes[i] ) * 1099511628211ull;
+		low = ( low ^ bytes[i] ) * 1099511628211ull;
+	}
+
+	CacheKey key = { high, low };
+	return key;
+}
+
+// PRE: This object is not defined.
+// POST: This object is defined and has no entry.
+CacheEntry::CacheEntry(): mMap( 0 ), mSize( 0 ), mHeader( 0 )
+{}
+
+// PRE: This object is defined.
+// POST: The entry is unmapped.
+CacheEntry::~CacheEntry()
+{
+	close();
+}
+
+// PRE: This object, file and key are defined.
+// POST: The RV is true if file is a complete entry for key.
+bool CacheEntry::open( const char *file, const CacheKey &key )
+{
+	close();
+	int fd = ::open( file, O_RDONLY );
+	if( fd < 0 )
+		return false;
+
+	struct stat info;
+	if( fstat( fd, &info ) == 0 && (size_t)info.st_size >= sizeof( CacheHeader ) )
+	{
+		void *map = mmap( 0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( map != MAP_FAILED )
+		{
+			mMap = map;
+			mSize = info.st_size;
+		}
+	}
+	::close( fd );
+
+	if( mMap == 0 )
+		return false;
+
+	mHeader = (const CacheHeader *)mMap;
+	if( mHeader->magic != CACHE_MAGIC || mHeader->version != CACHE_VERSION ||
+		mHeader->key.high != key.high || mHeader->key.low != key.low ||
+		mSize - sizeof( CacheHeader ) != mHeader->outputBytes + mHeader->preBytes )
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+// PRE: This object is defined and open() was successful.
+// POST: The RV is the output file.
+std::string_view CacheEntry::output() const
+{
+	return std::string_view( (const char *)mMap + sizeof( CacheHeader ), mHeader->outputBytes );
+}
+
+// PRE: This object is defined and open() was successful.
+// POST: The RV is the .pre.
+std::string_view CacheEntry::preprocessed() const
+{
+	return std::string_view( (const char *)mMap + sizeof( CacheHeader ) + mHeader->outputBytes,
+							 mHeader->preBytes );
+}
+
+// PRE: This object is defined.
+// POST: The entry is unmapped.
+void CacheEntry::close()
+{
+	if( mMap != 0 )
+		munmap( mMap, mSize );
+
+	mMap = 0;
+	mSize = 0;
+	mHeader = 0;
+}
+
+// PRE: directory is defined.
+// POST: This object is defined, directory is made if it is not
+//		there and the entries in it are kept under limit bytes.
+Cache::Cache( const char *directory, uint64_t limit ): mLimit( limit )
+{
+	mDirectory = new char[strlen( directory ) + 1];
+	strcpy( mDirectory, directory );
+
+	struct stat info;
+	mUsable = ( mkdir( mDirectory, 0755 ) == 0 || errno == EEXIST ) &&
+			  stat( mDirectory, &info ) == 0 && S_ISDIR( info.st_mode );
+}
+
+// PRE: This object is defined.
+// POST: All memory held by this object is released.
+Cache::~Cache()
+{
+	delete [] mDirectory;
+}
+
+// PRE: This object and key are defined, name can hold the directory
+//		and 34 more chars.
+// POST: name is the path of the entry for key.
+void Cache::entryName( const CacheKey &key, char *name ) const
+{
+	sprintf( name, "%s/%016llx%016llx", mDirectory, (unsigned long long)key.high,
+			 (unsigned long long)key.low );
+}
+
+// PRE: This object, key and entry are defined.
+// POST: If there is an entry for key it is opened in entry, marked
+//		as just used and the RV is true.
+bool Cache::fetch( const CacheKey &key, CacheEntry &entry ) const
+{
+	if( !mUsable )
+		return false;
+
+	char *name = new char[strlen( mDirectory ) + CACHE_NAME + 2];
+	entryName( key, name );
+	bool found = entry.open( name, key );
+	if( found )
+		utimensat( AT_FDCWD, name, 0, 0 );
+	delete [] name;
+	return found;
+}
+
+// PRE: file and bytes are defined.
+// POST: bytes holds the whole of file. The RV is false if it could not
+//		be read.
+static bool readFile( const char *file, Array<char> &bytes )
+{
+	int fd = open( file, O_RDONLY );
+	if( fd < 0 )
+		return false;
+
+	ssize_t count;
+	do
+	{
+		uint32_t length = bytes.length();
+		bytes.resize( length + CACHE_READ );
+		count = read( fd, bytes.data() + length, CACHE_READ );
+		bytes.resize( length + ( count > 0 ? count : 0 ) );
+	}
+	while( count > 0 || ( count < 0 && errno == EINTR ) );
+
+	close( fd );
+	return count == 0;
+}
+
+// PRE: This object, key and outputFile are defined. preFile is 0 if
+//		no .pre was written.
+// POST: The files are stored as the entry for key and the oldest
+//		entries are removed if the directory is over its limit. The
+//		RV is false if the entry could not be stored.
+bool Cache::store( const CacheKey &key, const char *outputFile, const char *preFile,
+				   uint32_t words, uint32_t codeWords ) const
+{
+	static std::atomic<uint32_t> sTemporary( 0 );
+
+	Array<char> output, pre;
+	if( !mUsable || !readFile( outputFile, output ) || ( preFile != 0 && !readFile( preFile, pre ) ) )
+		return false;
+
+	CacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.key = key;
+	header.outputBytes = output.length();
+	header.preBytes = pre.length();
+	header.words = words;
+	header.codeWords = codeWords;
+
+	size_t length = strlen( mDirectory ) + CACHE_NAME + 64;
+	char *name = new char[length];
+	char *temp = new char[length];
+	entryName( key, name );
+	sprintf( temp, "%s/tmp.%d.%u", mDirectory, (int)getpid(), sTemporary++ );
+
+	Emitter emitter;
+	bool stored = emitter.open( temp );
+	if( stored )
+	{
+		emitter.writeBytes( &header, sizeof( header ) );
+		emitter.writeBytes( output.data(), output.length() );
+		emitter.writeBytes( pre.data(), pre.length() );
+		stored = emitter.close() && rename( temp, name ) == 0;
+		if( !stored )
+			remove( temp );
+	}
+
+	delete [] name;
+	delete [] temp;
+	if( stored )
+		evict();
+	return stored;
+}
+
+/*
+	CacheFile is an entry or temporary file found while evicting.
+*/
+typedef struct __cachefile
+{
+	char name[CACHE_NAME + 1];
+	uint64_t bytes;
+	int64_t used;//Time it was last used, in nanoseconds.
+}CacheFile;
+
+// PRE: This object is defined.
+// POST: Entries are removed, the ones used longest ago first, until
+//		they fit in mLimit. Temporary files left by a parser that
+//		was stopped are removed too.
+void Cache::evict() const
+{
+	DIR *directory = opendir( mDirectory );
+	if( directory == 0 )
+		return;
+
+	char *path = new char[strlen( mDirectory ) + CACHE_NAME + 64];
+	Array<CacheFile> files;
+	uint64_t total = 0;
+	time_t now = time( 0 );
+	struct dirent *found;
+	while( ( found = readdir( directory ) ) != 0 )
+	{
+		bool temporary = strncmp( found->d_name, "tmp.", 4 ) == 0;
+		if( !temporary && strlen( found->d_name ) != CACHE_NAME )
+			continue;
+
+		struct stat info;
+		sprintf( path, "%s/%s", mDirectory, found->d_name );
+		if( stat( path, &info ) != 0 || !S_ISREG( info.st_mode ) )
+			continue;
+
+		if( temporary )
+		{
+			if( now - info.st_mtime > CACHE_STALE )
+				remove( path );
+			continue;
+		}
+
+		CacheFile file;
+		strcpy( file.name, found->d_name );
+		file.bytes = info.st_size;
+		file.used = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+		files.add( file );
+		total += file.bytes;
+	}
+	closedir( directory );
+
+	//Take the oldest entry that is left until the rest fit. Eviction is
+	//rare so there is no need to sort.
+	while( total > mLimit && files.length() > 0 )
+	{
+		uint32_t oldest = 0;
+		for( uint32_t i = 1; i < files.length(); i++ )
+			if( files[i].used < files[oldest].used )
+				oldest = i;
+
+		sprintf( path, "%s/%s", mDirectory, files[oldest].name );
+		remove( path );//Another parser may have removed it already.
+		total -= files[oldest].bytes;
+		files[oldest] = files[files.length() - 1];
+		files.resize( files.length() - 1 );
+	}
+
+	delete [] path;
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+// PRE: name and text are defined.
+// POST: file name holds text.
+static void writeText( const char *name, const char *text )
+{
+	FILE *file = fopen( name, "w" );
+	fputs( text, file );
+	fclose( file );
+}
+
+// PRE: directory is defined.
+// POST: The entries in directory and directory itself are removed.
+static void removeCache( const char *directory )
+{
+	DIR *dir = opendir( directory );
+	if( dir == 0 )
+		return;
+
+	char path[512];
+	struct dirent *found;
+	while( ( found = readdir( dir ) ) != 0 )
+	{
+		if( found->d_name[0] == '.' )
+			continue;
+		sprintf( path, "%s/%s", directory, found->d_name );
+		remove( path );
+	}
+	closedir( dir );
+	rmdir( directory );
+}
+
+void testCacheStoreFetch()
+{
+	const char *directory = "testCache.tmp";
+	removeCache( directory );
+	writeText( "testCache.bin", "70000000\n" );
+	writeText( "testCache.pre", "halt\n" );
+
+	Cache cache( directory, CACHE_LIMIT );
+	assert( cache.isUsable() );
+	CacheKey key = makeCacheKey( "halt\n", 0 );
+	CacheEntry entry;
+	assert( !cache.fetch( key, entry ) );
+	assert( cache.store( key, "testCache.bin", "testCache.pre", 1, 1 ) );
+
+	assert( cache.fetch( key, entry ) );
+	assert( entry.output() == "70000000\n" );
+	assert( entry.preprocessed() == "halt\n" );
+	assert( entry.header().words == 1 && entry.header().codeWords == 1 );
+	entry.close();
+
+	//Any change to the source or the options is a different entry.
+	assert( !cache.fetch( makeCacheKey( "halt\n", 1 ), entry ) );
+	assert( !cache.fetch( makeCacheKey( "halt \n", 0 ), entry ) );
+
+	removeCache( directory );
+	remove( "testCache.bin" );
+	remove( "testCache.pre" );
+}
+
+void testCacheEvict()
+{
+	const char *directory = "testCache.tmp";
+	removeCache( directory );
+	char text[1000];
+	memset( text, 'a', sizeof( text ) - 1 );
+	text[sizeof( text ) - 1] = '\0';
+	writeText( "testCache.bin", text );
+
+	//Room for two entries.
+	Cache cache( directory, 2 * ( sizeof( CacheHeader ) + 999 ) );
+	CacheKey keys[3] = { makeCacheKey( "a", 0 ), makeCacheKey( "b", 0 ), makeCacheKey( "c", 0 ) };
+	CacheEntry entry;
+	assert( cache.store( keys[0], "testCache.bin", 0, 0, 0 ) );
+	assert( cache.store( keys[1], "testCache.bin", 0, 0, 0 ) );
+
+	//Make the first entry the one used last.
+	char name[128];
+	struct timespec times[2];
+	times[0].tv_sec = times[1].tv_sec = time( 0 ) - 100;
+	times[0].tv_nsec = times[1].tv_nsec = 0;
+	sprintf( name, "%s/%016llx%016llx", directory, (unsigned long long)keys[1].high,
+			 (unsigned long long)keys[1].low );
+	assert( utimensat( AT_FDCWD, name, times, 0 ) == 0 );
+	assert( cache.fetch( keys[0], entry ) );
+	entry.close();
+
+	assert( cache.store( keys[2], "testCache.bin", 0, 0, 0 ) );
+	assert( cache.fetch( keys[0], entry ) );
+	assert( !cache.fetch( keys[1], entry ) );
+	assert( cache.fetch( keys[2], entry ) );
+	entry.close();
+
+	removeCache( directory );
+	remove( "testCache.bin" );
+}
+#endif
@@ -0,0 +1,146 @@
+/*
+    Cache: A directory of assembled files keyed by what went into them.
+
+    The key is a 128 bit hash of the assembler version, the options that
+    change the output and every byte of the source. An entry holds the
+    output file and the .pre exactly as they were written, so a source that
+    was assembled before is copied out of the cache rather than assembled.
+
+    Each entry is written to a temporary file in the directory and renamed
+    to its key, so a parser never sees half of an entry and any number of
+    parsers, in one process or many, can share the directory. Reading an
+    entry sets its time, and when a store takes the directory over its
+    limit the entries used longest ago are removed until it fits.
+
+        offset  0  CacheHeader
+        offset 48  the output file, outputBytes long
+                   the .pre, preBytes long
+*/
+
+#ifndef __CACHE__
+#define __CACHE__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+
+#define CACHE_MAGIC 0x4332434C//'L' 'C' '2' 'C' in file order.
+#define CACHE_VERSION 1
+//Default limit on the bytes of entries in a cache directory.
+#define CACHE_LIMIT ( (uint64_t)256 << 20 )
+
+typedef struct __cachekey
+{
+	uint64_t high;
+	uint64_t low;
+}CacheKey;
+
+typedef struct __cacheheader
+{
+	uint32_t magic;
+	uint32_t version;
+	CacheKey key;
+	uint64_t outputBytes;
+	uint64_t preBytes;
+	uint32_t words;//What Parser::getWordCount() gave.
+	uint32_t codeWords;
+}CacheHeader;
+
+// PRE: source is defined, options holds every setting that changes the
+//		output.
+// POST: The RV is the key of source assembled with options by this
+//		version of the assembler.
+CacheKey makeCacheKey( std::string_view source, uint32_t options );
+
+/*
+	CacheEntry maps one entry of the cache for reading.
+*/
+class CacheEntry
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined and has no entry.
+		CacheEntry();
+		// PRE: This object is defined.
+		// POST: The entry is unmapped.
+		~CacheEntry();
+
+		// PRE: This object, file and key are defined.
+		// POST: The RV is true if file is a complete entry for key.
+		bool open( const char *file, const CacheKey &key );
+
+		// PRE: This object is defined and open() was successful.
+		// POST: The RV is the header, the output file or the .pre.
+		const CacheHeader &header() const { return *mHeader; }
+		std::string_view output() const;
+		std::string_view preprocessed() const;
+
+		// PRE: This object is defined.
+		// POST: The entry is unmapped.
+		void close();
+	private:
+		// Disallow copying, the object owns the mapping.
+		CacheEntry( const CacheEntry & );
+		CacheEntry &operator=( const CacheEntry & );
+
+		void *mMap;
+		size_t mSize;
+		const CacheHeader *mHeader;
+};
+
+class Cache
+{
+	public:
+		// PRE: directory is defined.
+		// POST: This object is defined, directory is made if it is not
+		//		there and the entries in it are kept under limit bytes.
+		Cache( const char *directory, uint64_t limit );
+		// PRE: This object is defined.
+		// POST: All memory held by this object is released.
+		~Cache();
+
+		// PRE: This object is defined.
+		// POST: The RV is true if the directory is there to be used.
+		bool isUsable() const { return mUsable; }
+
+		// PRE: This object, key and entry are defined.
+		// POST: If there is an entry for key it is opened in entry, marked
+		//		as just used and the RV is true.
+		bool fetch( const CacheKey &key, CacheEntry &entry ) const;
+
+		// PRE: This object, key and outputFile are defined. preFile is 0 if
+		//		no .pre was written.
+		// POST: The files are stored as the entry for key and the oldest
+		//		entries are removed if the directory is over its limit. The
+		//		RV is false if the entry could not be stored.
+		bool store( const CacheKey &key, const char *outputFile, const char *preFile,
+					uint32_t words, uint32_t codeWords ) const;
+	private:
+		// PRE: This object and key are defined, name can hold the directory
+		//		and 34 more chars.
+		// POST: name is the path of the entry for key.
+		void entryName( const CacheKey &key, char *name ) const;
+
+		// PRE: This object is defined.
+		// POST: Entries are removed, the ones used longest ago first, until
+		//		they fit in mLimit. Temporary files left by a parser that
+		//		was stopped are removed too.
+		void evict() const;
+
+		// Disallow copying, the object owns its directory name.
+		Cache( const Cache & );
+		Cache &operator=( const Cache & );
+
+		char *mDirectory;
+		uint64_t mLimit;
+		bool mUsable;
+};
+
+#ifdef TESTING
+// Tests that a stored entry is fetched back only for its own key.
+void testCacheStoreFetch();
+// Tests that the entries used longest ago are removed first.
+void testCacheEvict();
+#endif
+
+#endif
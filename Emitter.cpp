@@ -0,0 +1,182 @@
+#include "Emitter.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char sHexDigits[16] =
+{
+	'0', '1', '2', '3', '4', '5', '6', '7',
+	'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+// PRE: This object is not defined.
+// POST: This object is defined and has no file.
+Emitter::Emitter(): mFile( -1 ), mOwned( false ), mFailed( false ), mBuffer( 0 ), mLength( 0 )
+{}
+
+// PRE: This object is defined.
+// POST: Anything buffered is written and the file is closed.
+Emitter::~Emitter()
+{
+	close();
+	delete [] mBuffer;
+}
+
+// PRE: This object and file are defined.
+// POST: The RV is true if file could be created or truncated
+//		for writing.
+bool Emitter::open( const char *file )
+{
+	close();
+	int fd = ::open( file, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( fd < 0 )
+		return false;
+
+	attach( fd );
+	mOwned = true;
+	return true;
+}
+
+// PRE: This object is defined and fd is open for writing.
+// POST: Output goes to fd, which is not closed by the emitter.
+void Emitter::attach( int fd )
+{
+	close();
+	if( mBuffer == 0 )
+		mBuffer = new char[EMIT_BLOCK];
+	mFile = fd;
+	mOwned = false;
+	mFailed = false;
+	mLength = 0;
+}
+
+// PRE: This object is defined and has a file.
+// POST: Each of the count words is buffered as a line of hex.
+void Emitter::writeHex( const uint32_t *words, size_t count )
+{
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( mLength + HEX_WORD > EMIT_BLOCK )
+			flush();
+
+		uint32_t word = words[i];
+		char *out = mBuffer + mLength;
+		for( int j = 7; j >= 0; j-- )
+		{
+			out[j] = sHexDigits[word & 0xF];
+			word >>= 4;
+		}
+		out[8] = '\n';
+		mLength += HEX_WORD;
+	}
+}
+
+// PRE: This object is defined and has a file.
+// POST: length bytes of data are buffered.
+void Emitter::writeBytes( const void *data, size_t length )
+{
+	const char *bytes = (const char *)data;
+	while( length > 0 )
+	{
+		if( mLength == EMIT_BLOCK )
+			flush();
+
+		size_t count = EMIT_BLOCK - mLength;
+		if( count > length )
+			count = length;
+		memcpy( mBuffer + mLength, bytes, count );
+		mLength += count;
+		bytes += count;
+		length -= count;
+	}
+}
+
+// PRE: This object is defined.
+// POST: The buffer is written out. The RV is false if any write
+//		since the file was opened failed.
+bool Emitter::flush()
+{
+	size_t written = 0;
+	while( written < mLength && !mFailed )
+	{
+		ssize_t count = write( mFile, mBuffer + written, mLength - written );
+		if( count > 0 )
+			written += count;
+		else if( count == 0 || errno != EINTR )
+			mFailed = true;
+	}
+
+	mLength = 0;
+	return !mFailed;
+}
+
+// PRE: This object is defined.
+// POST: The buffer is flushed and the file closed if the emitter
+//		opened it. The RV is false if any write failed.
+bool Emitter::close()
+{
+	if( mFile < 0 )
+		return true;
+
+	bool ok = flush();
+	if( mOwned && ::close( mFile ) != 0 )
+		ok = false;
+
+	mFile = -1;
+	mOwned = false;
+	return ok;
+}
+
+#ifdef TESTING
+#include <assert.h>
+#include <stdio.h>
+
+void testEmitterHex()
+{
+	const char *name = "testEmitter.tmp";
+	uint32_t words[3] = { 0x0000ABCD, 0xFFFFFFFF, 0x12345678 };
+	Emitter e;
+	assert( e.open( name ) );
+	e.writeHex( words, 3 );
+	assert( e.close() );
+
+	char text[64];
+	FILE *file = fopen( name, "r" );
+	size_t length = fread( text, 1, sizeof( text ), file );
+	fclose( file );
+	remove( name );
+
+	assert( length == 3 * HEX_WORD );
+	assert( memcmp( text, "0000ABCD\nFFFFFFFF\n12345678\n", length ) == 0 );
+}
+
+void testEmitterLarge()
+{
+	const char *name = "testEmitter.tmp";
+	const size_t count = EMIT_BLOCK / HEX_WORD * 3;
+	uint32_t *words = new uint32_t[count];
+	for( size_t i = 0; i < count; i++ )
+		words[i] = i;
+
+	Emitter e;
+	assert( e.open( name ) );
+	e.writeBytes( "head", 4 );
+	e.writeHex( words, count );
+	assert( e.close() );
+	delete [] words;
+
+	FILE *file = fopen( name, "r" );
+	fseek( file, 0, SEEK_END );
+	assert( (size_t)ftell( file ) == 4 + count * HEX_WORD );
+	char text[HEX_WORD + 1];
+	fseek( file, 4 + ( count - 1 ) * HEX_WORD, SEEK_SET );
+	assert( fread( text, 1, HEX_WORD, file ) == HEX_WORD );
+	fclose( file );
+	remove( name );
+
+	char expected[HEX_WORD + 1];
+	sprintf( expected, "%08X\n", (unsigned int)( count - 1 ) );
+	assert( memcmp( text, expected, HEX_WORD ) == 0 );
+}
+#endif
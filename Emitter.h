@@ -0,0 +1,76 @@
+/*
+    Emitter: Writes the assembled words out through one large buffer.
+
+    Words are formatted straight into the buffer, eight hex digits and a
+    '\n' each, with every nibble looked up in a table. The buffer is only
+    handed to write() when it is full or the emitter is flushed, so an
+    image of a million words takes a handful of system calls.
+*/
+
+#ifndef __EMITTER__
+#define __EMITTER__
+
+#include <stdint.h>
+#include <stddef.h>
+
+//Size of the output buffer.
+#define EMIT_BLOCK ( 1 << 20 )
+//Bytes written for one word in hex, "XXXXXXXX\n".
+#define HEX_WORD 9
+
+class Emitter
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined and has no file.
+		Emitter();
+		// PRE: This object is defined.
+		// POST: Anything buffered is written and the file is closed.
+		~Emitter();
+
+		// PRE: This object and file are defined.
+		// POST: The RV is true if file could be created or truncated
+		//		for writing.
+		bool open( const char *file );
+
+		// PRE: This object is defined and fd is open for writing.
+		// POST: Output goes to fd, which is not closed by the emitter.
+		void attach( int fd );
+
+		// PRE: This object is defined and has a file.
+		// POST: Each of the count words is buffered as a line of hex.
+		void writeHex( const uint32_t *words, size_t count );
+
+		// PRE: This object is defined and has a file.
+		// POST: length bytes of data are buffered.
+		void writeBytes( const void *data, size_t length );
+
+		// PRE: This object is defined.
+		// POST: The buffer is written out. The RV is false if any write
+		//		since the file was opened failed.
+		bool flush();
+
+		// PRE: This object is defined.
+		// POST: The buffer is flushed and the file closed if the emitter
+		//		opened it. The RV is false if any write failed.
+		bool close();
+	private:
+		// Disallow copying, the emitter owns the file.
+		Emitter( const Emitter & );
+		Emitter &operator=( const Emitter & );
+
+		int mFile;
+		bool mOwned;//The emitter opened mFile and closes it.
+		bool mFailed;//A write to mFile failed.
+		char *mBuffer;
+		size_t mLength;//Bytes waiting in mBuffer.
+};
+
+#ifdef TESTING
+// Tests the hex format of the words.
+void testEmitterHex();
+// Tests that output larger than the buffer is written whole.
+void testEmitterLarge();
+#endif
+
+#endif
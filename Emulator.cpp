@@ -0,0 +1,389 @@
+#include "Emulator.h"
+#include "Image.h"
+#include "SourceReader.h"
+#include <string.h>
+#include <iostream>
+
+//Handler of the slot past the end of memory, running into it goes back
+//to address 0.
+#define WRAP 16
+//Handlers in the dispatch table, every value of a 4 bit opcode and WRAP.
+#define NUM_HANDLERS 17
+
+// PRE: memoryWords is defined.
+// POST: This object is defined with at least memoryWords words of
+//		memory, all 0.
+Emulator::Emulator( uint32_t memoryWords ): mMemory( 0 ), mDecoded( 0 ), mMask( 0 ), mPC( 0 ), mSteps( 0 )
+{
+	uint32_t words = 1;
+	while( words < memoryWords && words < ( 1u << 30 ) )
+		words <<= 1;
+	allocate( words );
+}
+
+// PRE: This object is defined.
+// POST: The memory is released.
+Emulator::~Emulator()
+{
+	delete [] mMemory;
+	delete [] mDecoded;
+}
+
+// PRE: This object is defined and memoryWords is a power of two.
+// POST: The memory holds memoryWords words, all 0.
+void Emulator::allocate( uint32_t memoryWords )
+{
+	delete [] mMemory;
+	delete [] mDecoded;
+	mMemory = new uint32_t[memoryWords]();
+	mDecoded = new Decoded[memoryWords + 1];
+	mMask = memoryWords - 1;
+
+	for( uint32_t i = 0; i < memoryWords; i++ )
+		decode( i );
+	mDecoded[memoryWords].op = WRAP;
+
+	memset( mRegisters, 0, sizeof( mRegisters ) );
+	mRegisters[13] = memoryWords * 4;//$sp starts at the top of memory.
+	mPC = 0;
+	mSteps = 0;
+}
+
+// PRE: This object is defined and index < the words of memory.
+// POST: mDecoded[index] is the word at index decoded.
+void Emulator::decode( uint32_t index )
+{
+	InstructionUnion instruct;
+	instruct.binary = mMemory[index];
+	Decoded &slot = mDecoded[index];
+	slot.op = instruct.op;
+	slot.x = instruct.x;
+	slot.y = instruct.y;
+	slot.z = instruct.z;
+	slot.value = instruct.value;
+
+	switch( instruct.op )
+	{
+		case ADD: case NAND: case ADDI: case LW: case IN:
+			if( slot.x == 0 )
+				slot.x = NUM_REGISTERS;
+			break;
+		case JALR:
+			if( slot.y == 0 )
+				slot.y = NUM_REGISTERS;
+			break;
+		case BEQ:
+			//The offset is in bytes from the next instruction.
+			slot.value = ( index + 1 + ( instruct.value >> 2 ) ) & mMask;
+			break;
+	}
+}
+
+// PRE: This object is defined, words holds count words.
+// POST: words are in memory from address 0 and decoded, memory
+//		grows to hold them. Execution starts at entry.
+void Emulator::loadWords( const uint32_t *words, uint32_t count, uint32_t entry )
+{
+	uint32_t memoryWords = mMask + 1;
+	while( memoryWords < count )
+		memoryWords <<= 1;
+	allocate( memoryWords );
+
+	memcpy( mMemory, words, count * 4 );
+	for( uint32_t i = 0; i < count; i++ )
+		decode( i );
+	mPC = entry;
+}
+
+// PRE: This object and file are defined.
+// POST: The program in file, an image or the hex of a .bin, is in
+//		memory and decoded. The RV is false if it could not be read.
+bool Emulator::load( const char *file )
+{
+	ImageFile image;
+	if( !image.open( file ) )
+		return loadHex( file );
+
+	const ImageHeader &header = image.header();
+	Array<uint32_t> words;
+	words.resize( header.words );
+	for( uint32_t i = 0; i < header.words; i++ )
+		words[i] = littleEndian( image.words()[i] );
+	loadWords( words.data(), header.words, header.entry );
+	return true;
+}
+
+// PRE: This object and file are defined.
+// POST: The hex words of file are loaded. The RV is false if file
+//		could not be read or a line is not a word.
+bool Emulator::loadHex( const char *file )
+{
+	SourceReader reader;
+	if( !reader.open( file ) )
+		return false;
+
+	Array<uint32_t> words;
+	std::string_view line;
+	while( reader.nextLine( line ) )
+	{
+		if( !line.empty() && line.back() == '\r' )
+			line.remove_suffix( 1 );
+		if( line.empty() || line.length() > 8 )
+			return false;
+
+		uint32_t word = 0;
+		for( size_t i = 0; i < line.length(); i++ )
+		{
+			char c = line[i];
+			if( c >= '0' && c <= '9' )
+				word = word << 4 | ( c - '0' );
+			else if( c >= 'A' && c <= 'F' )
+				word = word << 4 | ( c - 'A' + 10 );
+			else if( c >= 'a' && c <= 'f' )
+				word = word << 4 | ( c - 'a' + 10 );
+			else
+				return false;
+		}
+		words.add( word );
+	}
+	if( words.length() == 0 )
+		return false;
+
+	loadWords( words.data(), words.length(), 0 );
+	return true;
+}
+
+// PRE: This object is defined and a program is loaded.
+// POST: The program runs until it halts or, when limit is not 0,
+//		once it has run at least limit instructions. The RV is true
+//		if it halted.
+bool Emulator::run( uint64_t limit, std::istream &in, std::ostream &out )
+{
+	//Every handler ends by jumping to the handler of the next slot, so
+	//each has a branch of its own for the CPU to predict.
+	static void *const handlers[NUM_HANDLERS] =
+	{
+		&&add, &&nand, &&addi, &&lw, &&sw, &&beq, &&jalr, &&halt, &&in, &&out,
+		&&bad, &&bad, &&bad, &&bad, &&bad, &&bad, &&wrap
+	};
+
+	uint32_t *r = mRegisters;
+	uint32_t *memory = mMemory;
+	Decoded *code = mDecoded;
+	uint32_t mask = mMask;
+	uint32_t pc = ( mPC >> 2 ) & mask;
+	uint64_t steps = mSteps;
+	//Only jumps can keep a program from halting, so only they check it.
+	uint64_t stop = limit == 0 ? UINT64_MAX : steps + limit;
+	const Decoded *d;
+	bool halted = false;
+
+#define DISPATCH() d = &code[pc]; steps++; goto *handlers[d->op]
+#define NEXT() pc++; DISPATCH()
+
+	DISPATCH();
+
+add:
+	r[d->x] = r[d->y] + r[d->z];
+	NEXT();
+nand:
+	r[d->x] = ~( r[d->y] & r[d->z] );
+	NEXT();
+addi:
+	r[d->x] = r[d->y] + d->value;
+	NEXT();
+lw:
+	r[d->x] = memory[( ( r[d->y] + d->value ) >> 2 ) & mask];
+	NEXT();
+sw:
+	{
+		uint32_t index = ( ( r[d->y] + d->value ) >> 2 ) & mask;
+		memory[index] = r[d->x];
+		decode( index );
+	}
+	NEXT();
+beq:
+	if( r[d->x] != r[d->y] )
+	{
+		NEXT();
+	}
+	pc = d->value;
+	if( steps >= stop )
+		goto done;
+	DISPATCH();
+jalr:
+	{
+		uint32_t target = r[d->x];
+		r[d->y] = ( ( pc + 1 ) & mask ) << 2;
+		pc = ( target >> 2 ) & mask;
+	}
+	if( steps >= stop )
+		goto done;
+	DISPATCH();
+in:
+	{
+		int32_t value;
+		if( !( in >> value ) )
+			value = 0;
+		r[d->x] = value;
+	}
+	NEXT();
+out:
+	out << (int32_t)r[d->x] << '\n';
+	NEXT();
+wrap:
+	//Not an instruction, so it is not counted.
+	steps--;
+	pc = 0;
+	if( steps >= stop )
+		goto done;
+	DISPATCH();
+halt:
+	halted = true;
+	goto done;
+bad:
+	//An opcode that does not exist stops the program where it is.
+	goto done;
+
+#undef NEXT
+#undef DISPATCH
+
+done:
+	r[NUM_REGISTERS] = 0;
+	mPC = pc << 2;
+	mSteps = steps;
+	return halted;
+}
+
+#ifdef TESTING
+#include <assert.h>
+#include <stdio.h>
+#include <sstream>
+
+// PRE: source is an LC2200 program and emulator is defined.
+// POST: source is assembled and the .bin is loaded into emulator.
+static void assembleInto( const char *source, Emulator &emulator )
+{
+	char name[] = "testEmulator.s";
+	FILE *file = fopen( name, "w" );
+	fputs( source, file );
+	fclose( file );
+
+	std::ostringstream log;
+	Parser p( name );
+	p.setLog( &log );
+	p.preprocess();
+	p.parse();
+	assert( p.getErrors() == 0 );
+	assert( emulator.load( "testEmulator.s.bin" ) );
+	remove( name );
+	remove( "testEmulator.s.bin" );
+}
+
+// PRE: op and the fields are defined.
+// POST: The RV is the word of the instruction.
+static uint32_t encode( Opcode op, uint32_t x, uint32_t y, int32_t value )
+{
+	InstructionUnion instruct;
+	instruct.binary = 0;
+	instruct.value = value;
+	instruct.op = op;
+	instruct.x = x;
+	instruct.y = y;
+	return instruct.binary;
+}
+
+void testEmulatorVariables()
+{
+	Emulator emulator( 64 );
+	assembleInto( "in a\nin b\nadd c, a, b\nout c\nhalt\n", emulator );
+
+	std::istringstream in( "3 -7" );
+	std::ostringstream out;
+	assert( emulator.run( 0, in, out ) );
+	assert( out.str() == "-4\n" );
+	assert( emulator.getWord( emulator.getPC() ) == 0x70000000 );
+}
+
+void testEmulatorLoop()
+{
+	Emulator emulator( 64 );
+	assembleInto( "addi $a0, $zero, 5\n"
+				  "addi $a1, $zero, 0\n"
+				  "loop: beq $a0, $zero, done\n"
+				  "addi $a1, $a1, 3\n"
+				  "addi $a0, $a0, -1\n"
+				  "beq $zero, $zero, loop\n"
+				  "done: out $a1\n"
+				  "nand $a2, $a1, $a1\n"
+				  "out $a2\n"
+				  "halt\n", emulator );
+
+	std::istringstream in;
+	std::ostringstream out;
+	assert( emulator.run( 0, in, out ) );
+	assert( out.str() == "15\n-16\n" );
+	assert( emulator.getSteps() == 2 + 5 * 4 + 1 + 4 );
+}
+
+void testEmulatorJalr()
+{
+	uint32_t words[] =
+	{
+		encode( ADDI, 3, 0, 16 ),//$a0 = the address of out $ra.
+		encode( JALR, 3, 15, 0 ),//$ra = 8.
+		encode( HALT, 0, 0, 0 ),
+		encode( HALT, 0, 0, 0 ),
+		encode( OUT, 15, 0, 0 ),
+		encode( ADDI, 0, 0, 5 ),//$zero stays 0.
+		encode( OUT, 0, 0, 0 ),
+		encode( HALT, 0, 0, 0 )
+	};
+	Emulator emulator( 16 );
+	emulator.loadWords( words, 8, 0 );
+
+	std::istringstream in;
+	std::ostringstream out;
+	assert( emulator.run( 0, in, out ) );
+	assert( out.str() == "8\n0\n" );
+	assert( emulator.getPC() == 28 );
+	assert( emulator.getRegister( 0 ) == 0 );
+}
+
+void testEmulatorStoreCode()
+{
+	uint32_t words[] =
+	{
+		encode( LW, 3, 0, 16 ),//The halt below.
+		encode( SW, 3, 0, 8 ),//Over the out.
+		encode( OUT, 3, 0, 0 ),
+		encode( HALT, 0, 0, 0 ),
+		encode( HALT, 0, 0, 0 )
+	};
+	Emulator emulator( 8 );
+	emulator.loadWords( words, 5, 0 );
+
+	std::istringstream in;
+	std::ostringstream out;
+	assert( emulator.run( 0, in, out ) );
+	assert( out.str() == "" );
+	assert( emulator.getPC() == 8 );
+}
+
+void testEmulatorLimit()
+{
+	uint32_t words[] = { encode( BEQ, 0, 0, -4 ) };
+	Emulator emulator( 4 );
+	emulator.loadWords( words, 1, 0 );
+
+	std::istringstream in;
+	std::ostringstream out;
+	assert( !emulator.run( 1000, in, out ) );
+	assert( emulator.getSteps() == 1000 );
+
+	//Memory of nothing but 0, an add to $zero, runs around to address 0.
+	Emulator empty( 4 );
+	assert( !empty.run( 100, in, out ) );
+	assert( empty.getSteps() >= 100 && empty.getPC() == 0 );
+}
+#endif
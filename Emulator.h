@@ -0,0 +1,125 @@
+/*
+    Emulator: Runs an assembled LC2200 program.
+
+    The .bin or .img the parser wrote is loaded into a memory of words
+    starting at address 0, and every word is decoded once into a Decoded
+    slot that holds its registers and value ready to use. Running jumps
+    from the handler of one slot straight to the handler of the next, with
+    the computed goto of GCC, so nothing is decoded in the loop. A store
+    decodes the word it changes again, so a program may write code.
+
+    Addresses are in bytes as the parser gives them. PC moves on by 4 and
+    a taken BEQ goes to PC + 4 + offset. JALR X, Y puts PC + 4 in Y and
+    goes to the address in X. IN reads a number from the input and OUT
+    writes one to the output on a line of its own. $zero is always 0, $sp
+    starts at the top of memory and the other registers at 0. Addresses
+    wrap at the size of memory, which is a power of two.
+*/
+
+#ifndef __EMULATOR__
+#define __EMULATOR__
+
+#include <stdint.h>
+#include <iosfwd>
+#include "Parser.h"
+
+//Words of memory when no size is given, 4MB.
+#define EMULATOR_MEMORY ( 1 << 20 )
+
+/*
+	Decoded is one word of memory ready to run. A register that the
+	instruction writes is NUM_REGISTERS in place of $zero, so that writes
+	to $zero are thrown away.
+*/
+typedef struct __decoded
+{
+	uint8_t op;//Opcode, or WRAP for the slot past the end of memory.
+	uint8_t x;
+	uint8_t y;
+	uint8_t z;
+	int32_t value;//Offset, or the word a taken BEQ goes to.
+}Decoded;
+
+class Emulator
+{
+	public:
+		// PRE: memoryWords is defined.
+		// POST: This object is defined with at least memoryWords words of
+		//		memory, all 0.
+		Emulator( uint32_t memoryWords );
+		// PRE: This object is defined.
+		// POST: The memory is released.
+		~Emulator();
+
+		// PRE: This object and file are defined.
+		// POST: The program in file, an image or the hex of a .bin, is in
+		//		memory and decoded. The RV is false if it could not be read.
+		bool load( const char *file );
+
+		// PRE: This object is defined, words holds count words.
+		// POST: words are in memory from address 0 and decoded, memory
+		//		grows to hold them. Execution starts at entry.
+		void loadWords( const uint32_t *words, uint32_t count, uint32_t entry );
+
+		// PRE: This object is defined and a program is loaded.
+		// POST: The program runs until it halts or, when limit is not 0,
+		//		once it has run at least limit instructions. The RV is true
+		//		if it halted.
+		bool run( uint64_t limit, std::istream &in, std::ostream &out );
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of instructions run.
+		uint64_t getSteps() const { return mSteps; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the address of the next instruction, or of the
+		//		HALT that stopped the program.
+		uint32_t getPC() const { return mPC; }
+
+		// PRE: This object is defined and reg < NUM_REGISTERS.
+		// POST: The RV is the value of reg.
+		uint32_t getRegister( uint32_t reg ) const { return mRegisters[reg]; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the word at address.
+		uint32_t getWord( uint32_t address ) const { return mMemory[( address >> 2 ) & mMask]; }
+	private:
+		// Disallow copying, the object owns its memory.
+		Emulator( const Emulator & );
+		Emulator &operator=( const Emulator & );
+
+		// PRE: This object is defined and memoryWords is a power of two.
+		// POST: The memory holds memoryWords words, all 0.
+		void allocate( uint32_t memoryWords );
+
+		// PRE: This object is defined and index < the words of memory.
+		// POST: mDecoded[index] is the word at index decoded.
+		void decode( uint32_t index );
+
+		// PRE: This object and file are defined.
+		// POST: The hex words of file are loaded. The RV is false if file
+		//		could not be read, is empty or a line is not a word.
+		bool loadHex( const char *file );
+
+		uint32_t *mMemory;
+		Decoded *mDecoded;//One past the memory to wrap around.
+		uint32_t mMask;//Words of memory less 1.
+		uint32_t mRegisters[NUM_REGISTERS + 1];//The last takes writes to $zero.
+		uint32_t mPC;
+		uint64_t mSteps;
+};
+
+#ifdef TESTING
+// Tests a program that reads, adds and writes its variables.
+void testEmulatorVariables();
+// Tests a loop of BEQ, ADDI and NAND.
+void testEmulatorLoop();
+// Tests JALR and that $zero is never changed.
+void testEmulatorJalr();
+// Tests that a store into code changes what is run.
+void testEmulatorStoreCode();
+// Tests that a program that does not halt stops at the limit.
+void testEmulatorLimit();
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+#include "FlowGraph.h"
+#include "TokenStore.h"
+#include <string.h>
+
+//Code of $k0 in RegisterStrings, jalr <lable> loads the lable into it.
+#define K0_REGISTER 12
+
+// PRE: tokens is defined and holds the words of a program from address 0.
+// POST: This object holds the blocks of tokens and their edges.
+FlowGraph::FlowGraph( TokenStore &tokens )
+{
+	//Split the words into blocks, a block ends after a BEQ, JALR or
+	//HALT and before a lable.
+	uint32_t length = tokens.length();
+	bool ended = true;
+	for( uint32_t i = 0; i < length; i++ )
+	{
+		const char *lable = tokens.lable( i );
+		if( ended || lable != 0 )
+		{
+			BasicBlock block = { i, i, NO_BLOCK, NO_BLOCK, false };
+			mBlocks.add( block );
+		}
+		mBlocks[mBlocks.length() - 1].end = i + 1;
+
+		if( lable != 0 )
+		{
+			//A lable given twice means the last one, as in addSymbol.
+			ParseSymbol symbol;
+			strcpy( symbol.name, lable );
+			symbol.type = Symbols::LABLE;
+			symbol.address = mBlocks.length() - 1;
+			ParseSymbol *found = mLables.addUnique( symbol );
+			if( found != 0 )
+				found->address = symbol.address;
+		}
+
+		InstructionUnion instruct;
+		instruct.binary = tokens.word( i );
+		ended = instruct.op == BEQ || instruct.op == JALR || instruct.op == HALT;
+	}
+
+	bool knownCalls = true;
+	for( uint32_t b = 0; b < mBlocks.length(); b++ )
+	{
+		BasicBlock &block = mBlocks[b];
+		uint32_t last = block.end - 1;
+		InstructionUnion instruct;
+		instruct.binary = tokens.word( last );
+		if( instruct.op != HALT && b + 1 < mBlocks.length() )
+			block.next = b + 1;
+
+		if( instruct.op == BEQ )
+		{
+			const char *name = tokens.operand( last, 2 );
+			if( name != 0 )
+				block.target = blockOf( name );
+			//A register always equals itself, so the branch is taken.
+			if( instruct.x == instruct.y && block.target != NO_BLOCK )
+				block.next = NO_BLOCK;
+		}
+		else if( instruct.op == JALR )
+		{
+			//Only a JALR that can not be branched to past its LW is known.
+			InstructionUnion load;
+			load.binary = last > block.first ? tokens.word( last - 1 ) : 0;
+			const char *name = last > block.first ? tokens.operand( last - 1, 1 ) : 0;
+			if( instruct.x == K0_REGISTER && load.op == LW && load.x == K0_REGISTER && name != 0 )
+				block.target = blockOf( name );
+			if( block.target == NO_BLOCK )
+				knownCalls = false;
+			if( block.next != NO_BLOCK )
+				mBlocks[block.next].entered = true;
+		}
+	}
+
+	if( mBlocks.length() != 0 )
+		mBlocks[0].entered = true;
+	if( !knownCalls )
+		for( uint32_t b = 0; b < mBlocks.length(); b++ )
+			if( tokens.lable( mBlocks[b].first ) != 0 )
+				mBlocks[b].entered = true;
+}
+
+// PRE: This object and lable are defined.
+// POST: The RV is the block that starts at lable, NO_BLOCK if no word
+//		has it.
+uint32_t FlowGraph::blockOf( const char *lable )
+{
+	ParseSymbol *symbol = mLables.find( lable );
+	return symbol == 0 ? NO_BLOCK : symbol->address;
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+// PRE: lines holds count lines of source and tokens is empty.
+// POST: The expansions of the lines are in tokens from address 0.
+static void storeLines( TokenStore &tokens, const char **lines, int count )
+{
+	Parser p;
+	Array<InstructionToken> expanded;
+	for( int i = 0; i < count; i++ )
+		p.preprocessLine( expanded, lines[i] );
+	for( uint32_t i = 0; i < expanded.length(); i++ )
+	{
+		expanded[i].address = i * 4;
+		tokens.add( expanded[i] );
+	}
+}
+
+void testFlowGraphBlocks()
+{
+	const char *lines[] = { "addi $a0, $zero, 3",
+							"loop: addi $a0, $a0, -1",
+							"out x",
+							"beq $a0, $zero, done",
+							"beq $zero, $zero, loop",
+							"done: halt" };
+	TokenStore tokens;
+	storeLines( tokens, lines, 6 );
+	FlowGraph graph( tokens );
+
+	//addi | loop: addi, lw, out, beq | beq | done: halt
+	assert( graph.length() == 4 );
+	assert( graph[0].first == 0 && graph[0].end == 1 );
+	assert( graph[1].first == 1 && graph[1].end == 5 );
+	assert( graph[2].first == 5 && graph[2].end == 6 );
+	assert( graph[3].first == 6 && graph[3].end == 7 );
+	assert( graph.blockOf( "loop" ) == 1 && graph.blockOf( "done" ) == 3 );
+	assert( graph.blockOf( "x" ) == NO_BLOCK );
+}
+
+void testFlowGraphEdges()
+{
+	const char *lines[] = { "jalr sub",
+							"beq $a0, $zero, end",
+							"halt",
+							"sub: out $a0",
+							"end: halt" };
+	TokenStore tokens;
+	storeLines( tokens, lines, 5 );
+	FlowGraph graph( tokens );
+
+	//lw $k0, sub; jalr | beq | halt | sub: out | end: halt
+	assert( graph.length() == 5 );
+	assert( graph[0].target == 3 && graph[0].next == 1 );
+	assert( graph[1].target == 4 && graph[1].next == 2 );
+	assert( graph[2].next == NO_BLOCK && graph[2].target == NO_BLOCK );
+	assert( graph[3].next == 4 );
+	assert( graph[4].next == NO_BLOCK );
+	assert( graph[0].entered && graph[1].entered );
+
+	//beq $zero, $zero always branches.
+	const char *always[] = { "beq $zero, $zero, end", "out $a0", "end: halt" };
+	TokenStore jumps;
+	storeLines( jumps, always, 3 );
+	FlowGraph taken( jumps );
+	assert( taken.length() == 3 && taken[0].target == 2 && taken[0].next == NO_BLOCK );
+	assert( !graph[2].entered && !graph[3].entered && !graph[4].entered );
+
+	//A JALR through a register could go to any lable.
+	const char *unknown[] = { "jalr $a0, $ra", "sub: halt" };
+	TokenStore other;
+	storeLines( other, unknown, 2 );
+	FlowGraph calls( other );
+	assert( calls.length() == 2 && calls[0].target == NO_BLOCK );
+	assert( calls[1].entered );
+}
+#endif
@@ -0,0 +1,81 @@
+/*
+    FlowGraph: The basic blocks of the assembled words and the edges
+    between them.
+
+    A block starts at the first word, at a word with a lable and after a
+    BEQ, JALR or HALT, and runs up to the start of the next one. A block
+    that ends in a BEQ goes to the block of its lable and on to the next
+    block, unless it compares a register with itself and so always
+    branches. One that ends in a HALT goes nowhere and any other goes on to
+    the next block. A JALR through $k0 calls the lable that the LW into $k0
+    just before it loads, which is the pair the expansion of jalr <lable>
+    makes, and the routine returns to the next block.
+
+    Control can also come from where the graph can not see it. That is
+    into the first block, into the block after a JALR, which the routine
+    called returns to, and into every block with a lable when a JALR
+    goes to an address the graph does not know. These blocks are marked
+    entered, nothing can be assumed at their start.
+*/
+
+#ifndef __FLOWGRAPH__
+#define __FLOWGRAPH__
+
+#include <stdint.h>
+#include "Array.h"
+#include "SymbolTable.h"
+
+#define NO_BLOCK 0xFFFFFFFF
+
+class TokenStore;
+
+/*
+	BasicBlock is a run of words that control only enters at the first
+	and only leaves after the last.
+*/
+typedef struct __basicblock
+{
+	uint32_t first;//Index of the first word in the TokenStore.
+	uint32_t end;//One past the last word.
+	uint32_t next;//Block it falls or returns into, NO_BLOCK if none.
+	uint32_t target;//Block the BEQ or JALR at its end goes to, NO_BLOCK if none.
+	bool entered;//Control may come from where the graph does not show.
+}BasicBlock;
+
+class FlowGraph
+{
+	public:
+		// PRE: tokens is defined and holds the words of a program from
+		//		address 0.
+		// POST: This object holds the blocks of tokens and their edges.
+		FlowGraph( TokenStore &tokens );
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of blocks.
+		uint32_t length() const { return mBlocks.length(); }
+
+		// PRE: This object is defined and index < length().
+		// POST: The RV is the index'th block, in the order of the words.
+		const BasicBlock &operator[]( uint32_t index ) const { return mBlocks[index]; }
+
+		// PRE: This object and lable are defined.
+		// POST: The RV is the block that starts at lable, NO_BLOCK if no
+		//		word has it.
+		uint32_t blockOf( const char *lable );
+	private:
+		// Disallow copying, the graph owns its tables.
+		FlowGraph( const FlowGraph & );
+		FlowGraph &operator=( const FlowGraph & );
+
+		Array<BasicBlock> mBlocks;
+		SymbolTable mLables;//The address of each lable is its block.
+};
+
+#ifdef TESTING
+// Tests where the blocks start and end.
+void testFlowGraphBlocks();
+// Tests the edges of BEQ, JALR and HALT and which blocks are entered.
+void testFlowGraphEdges();
+#endif
+
+#endif
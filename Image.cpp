@@ -0,0 +1,152 @@
+#include "Image.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Words converted to little endian at a time.
+#define IMAGE_CHUNK 1024
+
+// PRE: emitter has a file, words holds count words of which the first
+//		codeWords are code.
+// POST: The image of the words is buffered in emitter.
+void writeImage( Emitter &emitter, const uint32_t *words, uint32_t count,
+				 uint32_t codeWords, uint32_t entry )
+{
+	uint32_t header[IMAGE_HEADER_WORDS] =
+	{
+		littleEndian( IMAGE_MAGIC ), littleEndian( IMAGE_VERSION ), littleEndian( count ),
+		littleEndian( entry ), littleEndian( codeWords )
+	};
+	emitter.writeBytes( header, sizeof( header ) );
+
+	uint32_t chunk[IMAGE_CHUNK];
+	for( uint32_t i = 0; i < count; i += IMAGE_CHUNK )
+	{
+		uint32_t length = count - i < IMAGE_CHUNK ? count - i : IMAGE_CHUNK;
+		for( uint32_t j = 0; j < length; j++ )
+			chunk[j] = littleEndian( words[i + j] );
+		emitter.writeBytes( chunk, length * 4 );
+	}
+}
+
+// PRE: This object is not defined.
+// POST: This object is defined and has no image.
+ImageFile::ImageFile(): mWords( 0 ), mMap( 0 ), mSize( 0 )
+{
+	mHeader.magic = mHeader.version = mHeader.words = 0;
+	mHeader.entry = mHeader.codeWords = 0;
+}
+
+// PRE: This object is defined.
+// POST: The image is unmapped.
+ImageFile::~ImageFile()
+{
+	close();
+}
+
+// PRE: This object and file are defined.
+// POST: The RV is true if file is a complete image of this
+//		version, then header() and words() can be used.
+bool ImageFile::open( const char *file )
+{
+	close();
+	int fd = ::open( file, O_RDONLY );
+	if( fd < 0 )
+		return false;
+
+	struct stat info;
+	if( fstat( fd, &info ) == 0 && (size_t)info.st_size >= sizeof( ImageHeader ) )
+	{
+		void *map = mmap( 0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( map != MAP_FAILED )
+		{
+			mMap = map;
+			mSize = info.st_size;
+		}
+	}
+	::close( fd );
+
+	if( mMap == 0 )
+		return false;
+
+	const uint32_t *raw = (const uint32_t *)mMap;
+	mHeader.magic = littleEndian( raw[0] );
+	mHeader.version = littleEndian( raw[1] );
+	mHeader.words = littleEndian( raw[2] );
+	mHeader.entry = littleEndian( raw[3] );
+	mHeader.codeWords = littleEndian( raw[4] );
+	mWords = raw + IMAGE_HEADER_WORDS;
+
+	if( mHeader.magic != IMAGE_MAGIC || mHeader.version != IMAGE_VERSION ||
+		mHeader.codeWords > mHeader.words ||
+		( mSize - sizeof( ImageHeader ) ) / 4 < mHeader.words )
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+// PRE: This object is defined.
+// POST: The image is unmapped.
+void ImageFile::close()
+{
+	if( mMap != 0 )
+		munmap( mMap, mSize );
+
+	mMap = 0;
+	mWords = 0;
+	mSize = 0;
+}
+
+#ifdef TESTING
+#include <assert.h>
+#include <stdio.h>
+
+void testImageRoundTrip()
+{
+	const char *name = "testImage.tmp";
+	uint32_t words[3000];
+	for( uint32_t i = 0; i < 3000; i++ )
+		words[i] = i * 0x01010101;
+
+	Emitter e;
+	assert( e.open( name ) );
+	writeImage( e, words, 3000, 2000, 0 );
+	assert( e.close() );
+
+	ImageFile image;
+	assert( image.open( name ) );
+	assert( image.header().words == 3000 );
+	assert( image.header().codeWords == 2000 );
+	assert( image.header().entry == 0 );
+	for( uint32_t i = 0; i < 3000; i++ )
+		assert( littleEndian( image.words()[i] ) == words[i] );
+	image.close();
+	remove( name );
+}
+
+void testImageReject()
+{
+	const char *name = "testImage.tmp";
+	uint32_t words[2] = { 1, 2 };
+
+	//A hex file is not an image.
+	Emitter e;
+	assert( e.open( name ) );
+	e.writeHex( words, 2 );
+	assert( e.close() );
+	ImageFile image;
+	assert( !image.open( name ) );
+
+	//Neither is one that was cut short.
+	assert( e.open( name ) );
+	writeImage( e, words, 2, 2, 0 );
+	assert( e.close() );
+	assert( truncate( name, sizeof( ImageHeader ) + 4 ) == 0 );
+	assert( !image.open( name ) );
+	remove( name );
+}
+#endif
@@ -0,0 +1,102 @@
+/*
+    Image: The packed binary form of an assembled program.
+
+    An image is a small header followed by every word of the program as a
+    little endian uint32, code first and then the data words. Everything
+    in the file is a multiple of four bytes, so a loader can map the file
+    and use the words where they lie without parsing anything.
+
+        offset  0  magic        IMAGE_MAGIC, "LC22"
+        offset  4  version      IMAGE_VERSION
+        offset  8  words        number of words after the header
+        offset 12  entry        byte address execution starts at
+        offset 16  codeWords    words of code, the rest are data
+        offset 20  the words
+*/
+
+#ifndef __IMAGE__
+#define __IMAGE__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Emitter.h"
+
+#define IMAGE_MAGIC 0x3232434C//'L' 'C' '2' '2' in file order.
+#define IMAGE_VERSION 1
+
+typedef struct __imageheader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t words;
+	uint32_t entry;
+	uint32_t codeWords;
+}ImageHeader;
+
+#define IMAGE_HEADER_WORDS ( sizeof( ImageHeader ) / 4 )
+
+// PRE: emitter has a file, words holds count words of which the first
+//		codeWords are code.
+// POST: The image of the words is buffered in emitter.
+void writeImage( Emitter &emitter, const uint32_t *words, uint32_t count,
+				 uint32_t codeWords, uint32_t entry );
+
+/*
+	ImageFile maps an image into memory for reading.
+*/
+class ImageFile
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined and has no image.
+		ImageFile();
+		// PRE: This object is defined.
+		// POST: The image is unmapped.
+		~ImageFile();
+
+		// PRE: This object and file are defined.
+		// POST: The RV is true if file is a complete image of this
+		//		version, then header() and words() can be used.
+		bool open( const char *file );
+
+		// PRE: This object is defined and open() was successful.
+		// POST: The RV is the header of the image in host order.
+		const ImageHeader &header() const { return mHeader; }
+
+		// PRE: This object is defined and open() was successful.
+		// POST: The RV is the words of the image, in little endian.
+		const uint32_t *words() const { return mWords; }
+
+		// PRE: This object is defined.
+		// POST: The image is unmapped.
+		void close();
+	private:
+		// Disallow copying, the object owns the mapping.
+		ImageFile( const ImageFile & );
+		ImageFile &operator=( const ImageFile & );
+
+		ImageHeader mHeader;
+		const uint32_t *mWords;
+		void *mMap;
+		size_t mSize;
+};
+
+// PRE: word is defined.
+// POST: The RV is word converted between host and little endian order.
+inline uint32_t littleEndian( uint32_t word )
+{
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return __builtin_bswap32( word );
+#else
+	return word;
+#endif
+}
+
+#ifdef TESTING
+// Tests that a written image maps back with the same header and words.
+void testImageRoundTrip();
+// Tests that files that are not images are refused.
+void testImageReject();
+#endif
+
+#endif
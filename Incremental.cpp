@@ -0,0 +1,274 @@
+#include "Incremental.h"
+#include "TokenStore.h"
+#include "SymbolTable.h"
+#include "Emitter.h"
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// PRE: line is defined.
+// POST: The RV is the FNV-1a hash of line, never 0.
+uint64_t hashLine( std::string_view line )
+{
+	uint64_t hash = 14695981039346656037ull;
+	for( size_t i = 0; i < line.length(); i++ )
+	{
+		hash ^= (unsigned char)line[i];
+		hash *= 1099511628211ull;
+	}
+	return hash != 0 ? hash : 1;
+}
+
+// PRE: This object is not defined.
+// POST: This object is defined, has no state file open and has
+//		recorded nothing.
+IncrementalState::IncrementalState(): mMap( 0 ), mSize( 0 ), mHeader( 0 ), mDeadBytes( 0 )
+{}
+
+// PRE: This object is defined.
+// POST: The state file is unmapped.
+IncrementalState::~IncrementalState()
+{
+	close();
+}
+
+// PRE: This object and file are defined.
+// POST: The RV is true if file is a complete state of this
+//		version, then the arrays below can be read.
+bool IncrementalState::open( const char *file )
+{
+	close();
+	int fd = ::open( file, O_RDONLY );
+	if( fd < 0 )
+		return false;
+
+	struct stat info;
+	if( fstat( fd, &info ) == 0 && (size_t)info.st_size >= sizeof( StateHeader ) )
+	{
+		void *map = mmap( 0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( map != MAP_FAILED )
+		{
+			mMap = map;
+			mSize = info.st_size;
+		}
+	}
+	::close( fd );
+
+	if( mMap == 0 )
+		return false;
+
+	mHeader = (const StateHeader *)mMap;
+	const StateHeader &h = *mHeader;
+	uint64_t size = sizeof( StateHeader ) + (uint64_t)h.lines * 12 +
+					(uint64_t)h.words * ( 2 + NUM_PARAMS ) * 4 + (uint64_t)h.symbols * 8 +
+					(uint64_t)h.lableDefs * sizeof( LableDef ) + (uint64_t)h.fixups * sizeof( Fixup ) +
+					h.stringBytes + h.nameBytes;
+	if( h.magic != STATE_MAGIC || h.version != STATE_VERSION || size != mSize )
+	{
+		close();
+		return false;
+	}
+
+	const char *walker = (const char *)mMap + sizeof( StateHeader );
+	mHashes = (const uint64_t *)walker;
+	walker += h.lines * 8;
+	mLineWords = (const uint32_t *)walker;
+	walker += h.lines * 4;
+	mWords = (const uint32_t *)walker;
+	walker += h.words * 4;
+	mLables = (const uint32_t *)walker;
+	walker += h.words * 4;
+	mOperands = (const uint32_t *)walker;
+	walker += h.words * NUM_PARAMS * 4;
+	mSymbolWords = (const uint32_t *)walker;
+	walker += h.symbols * 4;
+	mSymbolHashes = (const uint32_t *)walker;
+	walker += h.symbols * 4;
+	mLableDefs = (const LableDef *)walker;
+	walker += h.lableDefs * sizeof( LableDef );
+	mFixups = (const Fixup *)walker;
+	walker += h.fixups * sizeof( Fixup );
+	mStrings = walker;
+	mNames = walker + h.stringBytes;
+
+	//The words have to be the ones the lines were encoded to.
+	if( ( h.lines == 0 ? 0 : mLineWords[h.lines - 1] ) != h.words ||
+		( h.nameBytes != 0 && mNames[h.nameBytes - 1] != '\0' ) )
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+// PRE: This object is defined.
+// POST: The state file is unmapped.
+void IncrementalState::close()
+{
+	if( mMap != 0 )
+		munmap( mMap, mSize );
+
+	mMap = 0;
+	mSize = 0;
+	mHeader = 0;
+}
+
+// PRE: This object is defined.
+// POST: The line of this run is recorded, with the number of words
+//		encoded up to its end.
+void IncrementalState::addLine( uint64_t hash, uint32_t lineWords )
+{
+	mNewHashes.add( hash );
+	mNewLineWords.add( lineWords );
+}
+
+// PRE: This object is defined.
+// POST: The next symbol of the table is recorded as first seen at
+//		word.
+void IncrementalState::addSymbol( uint32_t word )
+{
+	mNewSymbolWords.add( word );
+}
+
+// PRE: This object is defined.
+// POST: word is recorded as giving symbol its address.
+void IncrementalState::addLableDef( uint32_t word, uint32_t symbol )
+{
+	LableDef def = { word, symbol };
+	mNewLableDefs.add( def );
+}
+
+// PRE: This object is defined and the lines, symbols and lable
+//		definitions of tokens, symbols and fixups are recorded.
+// POST: The state is written to a temporary file that is renamed
+//		to file, so a run that is stopped leaves the old state. The
+//		RV is false if it could not be written.
+bool IncrementalState::write( const char *file, const TokenStore &tokens, SymbolTable &symbols,
+							  const Array<Fixup> &fixups )
+{
+	uint32_t nameBytes = 0;
+	for( uint32_t i = 0; i < symbols.length(); i++ )
+		nameBytes += strlen( symbols[i].name ) + 1;
+
+	StateHeader header;
+	header.magic = STATE_MAGIC;
+	header.version = STATE_VERSION;
+	header.lines = mNewHashes.length();
+	header.words = tokens.length();
+	header.symbols = symbols.length();
+	header.lableDefs = mNewLableDefs.length();
+	header.fixups = fixups.length();
+	header.stringBytes = tokens.strings().length();
+	header.nameBytes = nameBytes;
+	header.deadBytes = mDeadBytes;
+
+	size_t length = strlen( file );
+	char *temp = new char[length + sizeof( ".tmp" )];
+	sprintf( temp, "%s.tmp", file );
+
+	Emitter emitter;
+	bool written = emitter.open( temp );
+	if( written )
+	{
+		emitter.writeBytes( &header, sizeof( header ) );
+		emitter.writeBytes( mNewHashes.data(), header.lines * 8 );
+		emitter.writeBytes( mNewLineWords.data(), header.lines * 4 );
+		emitter.writeBytes( tokens.words(), header.words * 4 );
+		emitter.writeBytes( tokens.lables(), header.words * 4 );
+		emitter.writeBytes( tokens.operands(), header.words * NUM_PARAMS * 4 );
+		emitter.writeBytes( mNewSymbolWords.data(), header.symbols * 4 );
+		for( uint32_t i = 0; i < header.symbols; i++ )
+		{
+			uint32_t hash = symbols.hash( i );
+			emitter.writeBytes( &hash, 4 );
+		}
+		emitter.writeBytes( mNewLableDefs.data(), header.lableDefs * sizeof( LableDef ) );
+		emitter.writeBytes( fixups.data(), header.fixups * sizeof( Fixup ) );
+		emitter.writeBytes( tokens.strings().data(), header.stringBytes );
+		for( uint32_t i = 0; i < header.symbols; i++ )
+			emitter.writeBytes( symbols[i].name, strlen( symbols[i].name ) + 1 );
+
+		written = emitter.close() && rename( temp, file ) == 0;
+		if( !written )
+			remove( temp );
+	}
+
+	delete [] temp;
+	return written;
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+void testIncrementalRoundTrip()
+{
+	const char *name = "testIncremental.tmp";
+	Parser p;
+	TokenStore tokens;
+	SymbolTable symbols;
+	Array<Fixup> fixups;
+	IncrementalState state;
+
+	tokens.add( p.parseLine( "loop: beq $a0, $a1, loop", 0 ) );
+	tokens.add( p.parseLine( "lw $a0, x", 4 ) );
+	ParseSymbol symbol;
+	symbol.type = Symbols::LABLE;
+	symbol.address = 0;
+	strcpy( symbol.name, "loop" );
+	symbols.addUnique( symbol );
+	strcpy( symbol.name, "x" );
+	symbols.addUnique( symbol );
+	Fixup fixup = { 1, 1, Fixups::MEMORY };
+	fixups.add( fixup );
+
+	state.addLine( hashLine( "loop: beq $a0, $a1, loop" ), 1 );
+	state.addLine( hashLine( "" ), 1 );
+	state.addLine( hashLine( "lw $a0, x" ), 2 );
+	state.addSymbol( 0 );
+	state.addSymbol( 1 );
+	state.addLableDef( 0, 0 );
+	state.addDeadBytes( 3 );
+	assert( state.write( name, tokens, symbols, fixups ) );
+
+	IncrementalState read;
+	assert( read.open( name ) );
+	const StateHeader &h = read.header();
+	assert( h.lines == 3 && h.words == 2 && h.symbols == 2 );
+	assert( h.lableDefs == 1 && h.fixups == 1 && h.deadBytes == 3 );
+	assert( read.hashes()[2] == hashLine( "lw $a0, x" ) );
+	assert( read.lineWords()[1] == 1 );
+	assert( read.words()[1] == tokens.word( 1 ) );
+	assert( strcmp( read.strings() + read.lables()[0], "loop" ) == 0 );
+	assert( strcmp( read.strings() + read.operands()[1 * NUM_PARAMS + 1], "x" ) == 0 );
+	assert( read.symbolWords()[1] == 1 );
+	assert( read.symbolHashes()[1] == hashSymbolName( "x" ) );
+	assert( read.lableDefs()[0].word == 0 && read.lableDefs()[0].symbol == 0 );
+	assert( read.fixups()[0].token == 1 && read.fixups()[0].kind == Fixups::MEMORY );
+	assert( strcmp( read.names(), "loop" ) == 0 && strcmp( read.names() + 5, "x" ) == 0 );
+	read.close();
+	remove( name );
+}
+
+void testIncrementalReject()
+{
+	const char *name = "testIncremental.tmp";
+	TokenStore tokens;
+	SymbolTable symbols;
+	Array<Fixup> fixups;
+	IncrementalState state;
+	tokens.addWord( 0x70000000, 0 );
+	state.addLine( hashLine( "halt" ), 1 );
+	assert( state.write( name, tokens, symbols, fixups ) );
+
+	IncrementalState read;
+	assert( read.open( name ) );
+	assert( truncate( name, sizeof( StateHeader ) + 8 ) == 0 );
+	assert( !read.open( name ) );
+	assert( !read.open( "testIncrementalMissing.tmp" ) );
+	remove( name );
+}
+#endif
@@ -0,0 +1,178 @@
+/*
+    Incremental: What is kept between runs to reassemble a file quickly.
+
+    With --incremental the parser writes <file>.state after collecting the
+    symbols. It holds a hash of every source line with the number of words
+    encoded up to the end of that line, the words themselves before any
+    fixups are applied, and every symbol, lable definition and fixup tagged
+    with the word it was found at.
+
+    The next run hashes its lines and compares them with the state. Lines
+    that match at the start and at the end of the file are not lexed again,
+    their words come straight from the state, so only the lines in between
+    are encoded. As the symbols are collected in word order, the symbols,
+    lable definitions and fixups found before the first changed word are
+    restored as they stood at that word and collecting carries on from it.
+
+    A line that reported a problem is stored with a hash of 0, which no line
+    has, so it is encoded and reported again on every run.
+
+    The file is written in the byte order of the machine, it is a cache for
+    the machine that made it and not something to pass around.
+
+        StateHeader
+        uint64_t hashes[lines]
+        uint32_t lineWords[lines]       words encoded up to the end of the line
+        uint32_t words[words]           before fixups
+        uint32_t lables[words]          offsets into strings, see TokenStore
+        uint32_t operands[words * NUM_PARAMS]
+        uint32_t symbolWords[symbols]   word the symbol was first seen at
+        uint32_t symbolHashes[symbols]
+        LableDef lableDefs[lableDefs]
+        Fixup fixups[fixups]
+        char strings[stringBytes]
+        char names[nameBytes]           symbol names, each ending in '\0'
+*/
+
+#ifndef __INCREMENTAL__
+#define __INCREMENTAL__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+#include "Parser.h"
+
+#define STATE_MAGIC 0x5332434C//'L' 'C' '2' 'S' in file order.
+#define STATE_VERSION 5
+
+class TokenStore;
+class SymbolTable;
+
+typedef struct __stateheader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t lines;
+	uint32_t words;
+	uint32_t symbols;
+	uint32_t lableDefs;
+	uint32_t fixups;
+	uint32_t stringBytes;
+	uint32_t nameBytes;
+	uint32_t deadBytes;//Bytes of strings that no word uses any more.
+}StateHeader;
+
+/*
+	LableDef is a word that gives a symbol its address.
+*/
+typedef struct __labledef
+{
+	uint32_t word;
+	uint32_t symbol;
+}LableDef;
+
+// PRE: line is defined.
+// POST: The RV is the FNV-1a hash of line, never 0.
+uint64_t hashLine( std::string_view line );
+
+class IncrementalState
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined, has no state file open and has
+		//		recorded nothing.
+		IncrementalState();
+		// PRE: This object is defined.
+		// POST: The state file is unmapped.
+		~IncrementalState();
+
+		// PRE: This object and file are defined.
+		// POST: The RV is true if file is a complete state of this
+		//		version, then the arrays below can be read.
+		bool open( const char *file );
+
+		// PRE: This object is defined.
+		// POST: The state file is unmapped.
+		void close();
+
+		// PRE: This object is defined.
+		// POST: The RV is true if a state file is open.
+		bool isOpen() const { return mMap != 0; }
+
+		// PRE: This object is defined and open() was successful.
+		// POST: The RV is the header or one of the arrays of the file.
+		const StateHeader &header() const { return *mHeader; }
+		const uint64_t *hashes() const { return mHashes; }
+		const uint32_t *lineWords() const { return mLineWords; }
+		const uint32_t *words() const { return mWords; }
+		const uint32_t *lables() const { return mLables; }
+		const uint32_t *operands() const { return mOperands; }
+		const uint32_t *symbolWords() const { return mSymbolWords; }
+		const uint32_t *symbolHashes() const { return mSymbolHashes; }
+		const LableDef *lableDefs() const { return mLableDefs; }
+		const Fixup *fixups() const { return mFixups; }
+		const char *strings() const { return mStrings; }
+		const char *names() const { return mNames; }
+
+		// PRE: This object is defined.
+		// POST: The line of this run is recorded, with the number of words
+		//		encoded up to its end.
+		void addLine( uint64_t hash, uint32_t lineWords );
+
+		// PRE: This object is defined.
+		// POST: The next symbol of the table is recorded as first seen at
+		//		word.
+		void addSymbol( uint32_t word );
+
+		// PRE: This object is defined.
+		// POST: word is recorded as giving symbol its address.
+		void addLableDef( uint32_t word, uint32_t symbol );
+
+		// PRE: This object is defined, dead bytes of the strings are no
+		//		longer used.
+		// POST: dead is added to the bytes the next state says are unused.
+		void addDeadBytes( uint32_t dead ) { mDeadBytes += dead; }
+
+		// PRE: This object is defined and the lines, symbols and lable
+		//		definitions of tokens, symbols and fixups are recorded.
+		// POST: The state is written to a temporary file that is renamed
+		//		to file, so a run that is stopped leaves the old state. The
+		//		RV is false if it could not be written.
+		bool write( const char *file, const TokenStore &tokens, SymbolTable &symbols,
+					const Array<Fixup> &fixups );
+	private:
+		// Disallow copying, the object owns the mapping.
+		IncrementalState( const IncrementalState & );
+		IncrementalState &operator=( const IncrementalState & );
+
+		void *mMap;
+		size_t mSize;
+		const StateHeader *mHeader;
+		const uint64_t *mHashes;
+		const uint32_t *mLineWords;
+		const uint32_t *mWords;
+		const uint32_t *mLables;
+		const uint32_t *mOperands;
+		const uint32_t *mSymbolWords;
+		const uint32_t *mSymbolHashes;
+		const LableDef *mLableDefs;
+		const Fixup *mFixups;
+		const char *mStrings;
+		const char *mNames;
+
+		//What this run records for the next state.
+		Array<uint64_t> mNewHashes;
+		Array<uint32_t> mNewLineWords;
+		Array<uint32_t> mNewSymbolWords;
+		Array<LableDef> mNewLableDefs;
+		uint32_t mDeadBytes;
+};
+
+#ifdef TESTING
+// Tests that a state is read back as it was written.
+void testIncrementalRoundTrip();
+// Tests that a state that was cut short is not used.
+void testIncrementalReject();
+#endif
+
+#endif
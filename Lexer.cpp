@@ -0,0 +1,233 @@
+#include "Lexer.h"
+
+/*
+    Lexer states -- This is in a namespace because the names overlap the
+    character classes.
+*/
+namespace LexStates
+{
+	typedef enum __lexstate
+	{
+		START,//Whitespace before anything.
+		WORD,//The first word, a lable or a mnemonic.
+		WORD_SPACE,//Whitespace after the first word.
+		MNEMONIC_START,//Whitespace after a lable.
+		MNEMONIC,//A mnemonic that came after a lable.
+		OPERAND_START,//Waiting for an operand.
+		OPERAND,//Inside an operand.
+		OPERAND_SPACE,//Whitespace or a ')' after an operand.
+		END,//The rest of the line is a comment.
+		COUNT
+	}LexState;
+}
+
+/*
+    Character classes -- Every byte of a line is one of these.
+*/
+namespace CharClasses
+{
+	typedef enum __charclass
+	{
+		SPACE,//' ' and '\t'
+		WORD,//Anything that can be part of a name, number or register.
+		COLON,
+		COMMA,
+		OPEN,//'('
+		CLOSE,//')'
+		END,//';', '\r' and the end of the line.
+		COUNT
+	}CharClass;
+}
+
+/*
+    Actions -- What is done with the text when a transition is taken. They
+    are done in the order they are listed.
+*/
+#define A_END_WORD		0x01//The first word ends here.
+#define A_LABLE			0x02//The first word was a lable.
+#define A_MNEMONIC		0x04//The first word was the mnemonic.
+#define A_END_OPERAND	0x08//The current operand ends here.
+#define A_ADVANCE		0x10//Move on to the next operand position.
+#define A_BEGIN			0x20//A word or operand starts here.
+
+typedef struct __transition
+{
+	unsigned char next;
+	unsigned char actions;
+}Transition;
+
+typedef struct __charclasstable
+{
+	unsigned char classes[256];
+}CharClassTable;
+
+// PRE: None.
+// POST: The RV maps every byte onto its CharClass.
+static constexpr CharClassTable makeCharClasses()
+{
+	CharClassTable table = {};
+	for( int c = 0; c < 256; c++ )
+	{
+		unsigned char charClass = CharClasses::WORD;
+		if( c == ' ' || c == '\t' )
+			charClass = CharClasses::SPACE;
+		else if( c == ':' )
+			charClass = CharClasses::COLON;
+		else if( c == ',' )
+			charClass = CharClasses::COMMA;
+		else if( c == '(' )
+			charClass = CharClasses::OPEN;
+		else if( c == ')' )
+			charClass = CharClasses::CLOSE;
+		else if( c == ';' || c == '\r' || c == '\n' )
+			charClass = CharClasses::END;
+		table.classes[c] = charClass;
+	}
+	return table;
+}
+
+static constexpr CharClassTable sCharClasses = makeCharClasses();
+
+#define T( state, actions ) { LexStates::state, actions }
+
+//Columns are SPACE, WORD, COLON, COMMA, OPEN, CLOSE, END.
+static const Transition sTransitions[LexStates::COUNT][CharClasses::COUNT] =
+{
+	//START
+	{ T( START, 0 ), T( WORD, A_BEGIN ), T( START, 0 ), T( START, 0 ),
+	  T( START, 0 ), T( START, 0 ), T( END, 0 ) },
+	//WORD
+	{ T( WORD_SPACE, A_END_WORD ), T( WORD, 0 ), T( MNEMONIC_START, A_END_WORD | A_LABLE ),
+	  T( OPERAND_START, A_END_WORD | A_MNEMONIC | A_ADVANCE ), T( OPERAND_START, A_END_WORD | A_MNEMONIC | A_ADVANCE ),
+	  T( OPERAND_START, A_END_WORD | A_MNEMONIC ), T( END, A_END_WORD | A_MNEMONIC ) },
+	//WORD_SPACE
+	{ T( WORD_SPACE, 0 ), T( OPERAND, A_MNEMONIC | A_BEGIN ), T( MNEMONIC_START, A_LABLE ),
+	  T( OPERAND_START, A_MNEMONIC | A_ADVANCE ), T( OPERAND_START, A_MNEMONIC | A_ADVANCE ),
+	  T( OPERAND_START, A_MNEMONIC ), T( END, A_MNEMONIC ) },
+	//MNEMONIC_START
+	{ T( MNEMONIC_START, 0 ), T( MNEMONIC, A_BEGIN ), T( MNEMONIC_START, 0 ), T( MNEMONIC_START, 0 ),
+	  T( MNEMONIC_START, 0 ), T( MNEMONIC_START, 0 ), T( END, 0 ) },
+	//MNEMONIC
+	{ T( OPERAND_START, A_END_WORD | A_MNEMONIC ), T( MNEMONIC, 0 ), T( MNEMONIC_START, A_END_WORD | A_LABLE ),
+	  T( OPERAND_START, A_END_WORD | A_MNEMONIC | A_ADVANCE ), T( OPERAND_START, A_END_WORD | A_MNEMONIC | A_ADVANCE ),
+	  T( OPERAND_START, A_END_WORD | A_MNEMONIC ), T( END, A_END_WORD | A_MNEMONIC ) },
+	//OPERAND_START
+	{ T( OPERAND_START, 0 ), T( OPERAND, A_BEGIN ), T( OPERAND_START, 0 ), T( OPERAND_START, A_ADVANCE ),
+	  T( OPERAND_START, A_ADVANCE ), T( OPERAND_START, 0 ), T( END, 0 ) },
+	//OPERAND
+	{ T( OPERAND_SPACE, A_END_OPERAND ), T( OPERAND, 0 ), T( OPERAND_SPACE, A_END_OPERAND ),
+	  T( OPERAND_START, A_END_OPERAND | A_ADVANCE ), T( OPERAND_START, A_END_OPERAND | A_ADVANCE ),
+	  T( OPERAND_SPACE, A_END_OPERAND ), T( END, A_END_OPERAND ) },
+	//OPERAND_SPACE
+	{ T( OPERAND_SPACE, 0 ), T( OPERAND, A_ADVANCE | A_BEGIN ), T( OPERAND_SPACE, 0 ), T( OPERAND_START, A_ADVANCE ),
+	  T( OPERAND_START, A_ADVANCE ), T( OPERAND_SPACE, 0 ), T( END, 0 ) },
+	//END
+	{ T( END, 0 ), T( END, 0 ), T( END, 0 ), T( END, 0 ),
+	  T( END, 0 ), T( END, 0 ), T( END, 0 ) }
+};
+
+#undef T
+
+// PRE: line and lexed are defined.
+// POST: lexed holds the lable, mnemonic and operands of line.
+void lexLine( std::string_view line, LexedLine &lexed )
+{
+	const char *text = line.data();
+	size_t length = line.length();
+	unsigned char state = LexStates::START;
+	size_t start = 0;
+	std::string_view word;
+	uint32_t index = 0;
+
+	lexed.lable = std::string_view();
+	lexed.mnemonic = std::string_view();
+	for( int i = 0; i < NUM_PARAMS; i++ )
+		lexed.operands[i] = std::string_view();
+	lexed.numOperands = 0;
+	lexed.hasLable = false;
+	lexed.tooManyOperands = false;
+
+	size_t pos = 0;
+	while( true )
+	{
+		unsigned char charClass = pos < length ? sCharClasses.classes[(unsigned char)text[pos]] : (unsigned char)CharClasses::END;
+		const Transition &transition = sTransitions[state][charClass];
+		unsigned char actions = transition.actions;
+
+		if( actions != 0 )
+		{
+			if( actions & A_END_WORD )
+				word = std::string_view( text + start, pos - start );
+			if( actions & A_LABLE )
+			{
+				lexed.lable = word;
+				lexed.hasLable = true;
+			}
+			if( actions & A_MNEMONIC )
+				lexed.mnemonic = word;
+			if( actions & A_END_OPERAND )
+			{
+				if( index < NUM_PARAMS )
+				{
+					lexed.operands[index] = std::string_view( text + start, pos - start );
+					lexed.numOperands = index + 1;
+				}
+				else
+					lexed.tooManyOperands = true;
+			}
+			if( actions & A_ADVANCE )
+				index++;
+			if( actions & A_BEGIN )
+				start = pos;
+		}
+
+		state = transition.next;
+		if( state == LexStates::END )
+			break;
+		pos++;
+	}
+
+	lexed.length = pos;
+	lexed.isComment = pos < length && text[pos] == ';' && !lexed.hasLable && lexed.mnemonic.empty();
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+void testLexerLine()
+{
+	LexedLine lexed;
+	lexLine( "  loop: add $t0,$t1 , x ; comment", lexed );
+	assert( lexed.hasLable && lexed.lable == "loop" );
+	assert( lexed.mnemonic == "add" );
+	assert( lexed.numOperands == 3 );
+	assert( lexed.operands[0] == "$t0" );
+	assert( lexed.operands[1] == "$t1" );
+	assert( lexed.operands[2] == "x" );
+	assert( !lexed.isComment && !lexed.tooManyOperands );
+
+	lexLine( "; only a comment", lexed );
+	assert( lexed.isComment && lexed.mnemonic.empty() );
+
+	lexLine( "halt", lexed );
+	assert( lexed.mnemonic == "halt" && lexed.numOperands == 0 );
+}
+
+void testLexerOffsetOperand()
+{
+	LexedLine lexed;
+	lexLine( "lw $a0, -20($a1)", lexed );
+	assert( lexed.numOperands == 3 );
+	assert( lexed.operands[0] == "$a0" );
+	assert( lexed.operands[1] == "-20" );
+	assert( lexed.operands[2] == "$a1" );
+
+	lexLine( "sw $a0, ($a1)", lexed );
+	assert( lexed.numOperands == 3 );
+	assert( lexed.operands[1].empty() );
+	assert( lexed.operands[2] == "$a1" );
+
+	lexLine( "add $a0, $a1, $a2, $t0", lexed );
+	assert( lexed.tooManyOperands );
+}
+#endif
@@ -0,0 +1,48 @@
+/*
+    Lexer: Splits one line of assembly into its lable, mnemonic and operands.
+
+    Every byte is looked up once in a table of character classes, and the
+    class together with the current state picks the next state and what to
+    do with the text seen so far out of a transition table. The lexer only
+    finds where each part of the line starts and ends, the parts are views
+    into the line and nothing is copied.
+
+    Operands are split on ',' and '(' so that "lw $a0, -20($a1)" gives the
+    three operands "$a0", "-20" and "$a1". A ')' and whitespace only end an
+    operand, and everything after a ';' is a comment.
+*/
+
+#ifndef __LEXER__
+#define __LEXER__
+
+#include <stdint.h>
+#include <string_view>
+#include "Parser.h"
+
+/*
+	LexedLine holds the parts of one line as views into that line.
+*/
+typedef struct __lexedline
+{
+	std::string_view lable;
+	std::string_view mnemonic;
+	std::string_view operands[NUM_PARAMS];
+	uint32_t numOperands;//Operand positions used, empty ones between separators count.
+	bool hasLable;
+	bool isComment;//There is a comment and nothing else on the line.
+	bool tooManyOperands;//There were more than NUM_PARAMS operands.
+	size_t length;//Length of the line up to the comment.
+}LexedLine;
+
+// PRE: line and lexed are defined.
+// POST: lexed holds the lable, mnemonic and operands of line.
+void lexLine( std::string_view line, LexedLine &lexed );
+
+#ifdef TESTING
+// Tests a line with a lable, a mnemonic, three operands and a comment.
+void testLexerLine();
+// Tests the offset and base register split of a LW/SW operand.
+void testLexerOffsetOperand();
+#endif
+
+#endif
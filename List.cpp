@@ -27,6 +27,9 @@ void testListGet()
 	assert( t[0]->getData() == 0 );
 	assert( t[1]->getData() == 1 );
 	assert( t[2]->getData() == 2 );
+
+	t[1]->getData() = 5;
+	assert( t[1]->getData() == 5 );
 }
 void testListReplace()
 {
@@ -64,4 +67,76 @@ void testListAddUnique()
 	assert( a.length() == 1 );
 }
 
+void testListArena()
+{
+	Arena arena;
+	List<char *> t( &arena );
+	t.add( arena.copyString( "a" ) );
+	t.add( arena.copyString( "b" ) );
+	t.replace( t[0], 2, arena.copyString( "c" ), arena.copyString( "d" ) );
+
+	assert( t.length() == 3 );
+	assert( strcmp( t[0]->getData(), "c" ) == 0 );
+	assert( strcmp( t[1]->getData(), "d" ) == 0 );
+	assert( strcmp( t[2]->getData(), "b" ) == 0 );
+	assert( t[2]->getPrev() == t[1] );
+}
+
+void testListIterator()
+{
+	List<int> a;
+	for( int i = 0; i < 5; i++ )
+		a.add( i );
+
+	int expected = 0;
+	for( List<int>::iterator it = a.begin(); it != a.end(); ++it )
+		assert( *it == expected++ );
+	assert( expected == 5 );
+
+	List<int>::iterator it = a.end();
+	while( it != a.begin() )
+	{
+		--it;
+		*it *= 10;
+	}
+	assert( a[4]->getData() == 40 );
+
+	it = a.begin();
+	it++;
+	a.replace( it.getLink(), 2, 7, 8 );
+	int after[] = { 0, 7, 8, 20, 30, 40 };
+	int count = 0;
+	for( it = a.begin(); it != a.end(); it++ )
+		assert( *it == after[count++] );
+	assert( count == 6 );
+
+	List<int> empty;
+	assert( empty.begin() == empty.end() );
+}
+
+void testListCursor()
+{
+	List<int> a;
+	for( int i = 0; i < 1000; i++ )
+		a.add( i );
+
+	for( int i = 0; i < 1000; i++ )
+		assert( a[i]->getData() == i );
+	for( int i = 999; i >= 0; i -= 7 )
+		assert( a[i]->getData() == i );
+	assert( a[-1] == 0 && a[1000] == 0 );
+
+	//Put the cursor past the link that is replaced, the indexes after it move.
+	assert( a[600]->getData() == 600 );
+	a.replace( a[500], 3, -1, -2, -3 );
+	assert( a.length() == 1002 );
+	assert( a[600]->getData() == 598 );
+	assert( a[501]->getData() == -2 );
+	assert( a[499]->getData() == 499 );
+
+	a.add( 1000 );
+	assert( a[1002]->getData() == 1000 );
+	assert( a[1001]->getData() == 999 );
+}
+
 #endif
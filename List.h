@@ -2,18 +2,24 @@
 #ifndef __LIST__
 #define __LIST__
 #include <cstdarg>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include "Arena.h"
+
+template <class T> class List;
+template <class T> class ListIterator;
 
 template<class T> class Link
 {
 	public:
 		Link();
-		Link( T obj );
+		Link( const T &obj );
 		// PRE: This object is defined.
-		// POST: The RV is the mData member.
-		T getData() { return mData; }
-		// PRE: This object is defined as is nData.
-		// POST: The mData will be set to nData.
-		void setData( T nData ) { mData = nData; }
+		// POST: The RV is the mData member itself, changing it changes
+		//		the link.
+		T &getData() { return mData; }
+		const T &getData() const { return mData; }
 		// PRE: This object is defined.
 		// POST: The RV is mPrev.
 		Link<T> *getPrev() { return mPrev; }
@@ -27,6 +33,8 @@ template<class T> class Link
 		// POST: mNext is set to nNext.
 		void setNext( Link *nNext ) { mNext = nNext; }
 	private:
+		friend class ListIterator<T>;
+
 		T mData;
 		Link<T> *mNext, *mPrev;
 };
@@ -37,49 +45,158 @@ template <class T> Link<T>::Link(): mNext( 0 ), mPrev( 0 ), mData( 0 )
 
 // PRE: This object is not defined.
 // POST: This object is defined.
-template <class T> Link<T>::Link( T obj ): mPrev( 0 ), mNext( 0 )
+template <class T> Link<T>::Link( const T &obj ): mData( obj ), mNext( 0 ), mPrev( 0 )
+{}
+
+/*
+	ListIterator walks the links of a List in either direction, end() is
+	one past the tail. Changing the data through it changes the link.
+*/
+template <class T> class ListIterator
 {
-	mData = obj;
-}
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T *pointer;
+		typedef T &reference;
+
+		// PRE: list is defined, link is one of its links or 0 for the end.
+		// POST: This object is defined and is at link.
+		ListIterator( List<T> *list, Link<T> *link ): mList( list ), mLink( link ) {}
+
+		// PRE: This object is not at the end.
+		// POST: The RV is the data of the link it is at.
+		T &operator*() const { return mLink->mData; }
+		T *operator->() const { return &mLink->mData; }
+
+		// PRE: This object is not at the end.
+		// POST: This object is at the next link.
+		ListIterator &operator++() { mLink = mLink->getNext(); return *this; }
+		ListIterator operator++( int ) { ListIterator t = *this; mLink = mLink->getNext(); return t; }
+
+		// PRE: This object is not at the head.
+		// POST: This object is at the link before, the end moves to the tail.
+		ListIterator &operator--() { mLink = mLink != 0 ? mLink->getPrev() : mList->mTail; return *this; }
+		ListIterator operator--( int ) { ListIterator t = *this; --*this; return t; }
+
+		bool operator==( const ListIterator &other ) const { return mLink == other.mLink; }
+		bool operator!=( const ListIterator &other ) const { return mLink != other.mLink; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the link it is at, or 0 at the end.
+		Link<T> *getLink() const { return mLink; }
+	private:
+		List<T> *mList;
+		Link<T> *mLink;
+};
 
 template <class T> class List
 {
 	public:
 		List();
 		List( int (*compare)(T a, T b) );
-		void add( T obj );
-		Link<T> *addUnique( T obj );
+		List( Arena *arena );
+		~List();
+		void add( const T &obj );
+		Link<T> *addUnique( const T &obj );
 		void replace( Link<T> *link, int numInsert, ... );
 		Link<T> *operator[]( int index );
 		int length() { return mLength; }
+
+		typedef ListIterator<T> iterator;
+		// PRE: This object is defined.
+		// POST: The RV is at the head, or is end() if the list is empty.
+		iterator begin() { return iterator( this, mHead ); }
+		// PRE: This object is defined.
+		// POST: The RV is one past the tail.
+		iterator end() { return iterator( this, 0 ); }
 	private:
+		friend class ListIterator<T>;
+
+		// Disallow copying, the list owns its links.
+		List( const List & );
+		List &operator=( const List & );
+
+		// PRE: This object is defined as is obj.
+		// POST: The RV is a new link holding obj, taken from mArena if
+		//		there is one.
+		Link<T> *newLink( const T &obj );
+		// PRE: This object and link are defined, link is not in the list.
+		// POST: link is released unless it lives in mArena.
+		void freeLink( Link<T> *link );
+
 		int mLength;
 		Link<T> *mHead, *mTail;
+		//The last link found by operator[], so walking the indexes in
+		//order only steps one link each time. 0 when it is not known.
+		Link<T> *mCursor;
+		int mCursorIndex;
 		int (*mCompare)( T a, T b );
+		Arena *mArena;//Where the links come from, 0 for the heap.
 };
 // PRE: This object is not defined.
 // POST: This object is defined.
-template <class T> List<T>::List(): mHead( 0 ),mTail( 0 ), mLength( 0 )
+template <class T> List<T>::List(): mLength( 0 ), mHead( 0 ), mTail( 0 ), mCursor( 0 ), mCursorIndex( 0 ),
+											   mCompare( 0 ), mArena( 0 )
 {}
 
 // PRE: This object is not defined.
 // POST: This object is defined.
-template <class T> List<T>::List( int (*compare)( T a, T b ) ) : mHead( 0 ), mTail( 0 ), mLength( 0 ), mCompare( compare )
+template <class T> List<T>::List( int (*compare)( T a, T b ) ) : mLength( 0 ), mHead( 0 ), mTail( 0 ), mCursor( 0 ), mCursorIndex( 0 ),
+																									 mCompare( compare ), mArena( 0 )
+{}
+
+// PRE: This object is not defined and arena is defined.
+// POST: This object is defined and its links are taken from arena,
+//		they are released with it. T must not need its destructor run.
+template <class T> List<T>::List( Arena *arena ) : mLength( 0 ), mHead( 0 ), mTail( 0 ), mCursor( 0 ), mCursorIndex( 0 ),
+																	mCompare( 0 ), mArena( arena )
 {}
 
+// PRE: This object is defined.
+// POST: The links of the list are released, the data they hold is not.
+template <class T> List<T>::~List()
+{
+	while( mHead != 0 )
+	{
+		Link<T> *next = mHead->getNext();
+		freeLink( mHead );
+		mHead = next;
+	}
+}
+
+// PRE: This object is defined as is obj.
+// POST: The RV is a new link holding obj, taken from mArena if
+//		there is one.
+template <class T> Link<T> *List<T>::newLink( const T &obj )
+{
+	if( mArena != 0 )
+		return new ( mArena->allocate( sizeof( Link<T> ), alignof( Link<T> ) ) ) Link<T>( obj );
+	return new Link<T>( obj );
+}
+
+// PRE: This object and link are defined, link is not in the list.
+// POST: link is released unless it lives in mArena.
+template <class T> void List<T>::freeLink( Link<T> *link )
+{
+	if( mArena == 0 )
+		delete link;
+}
+
 // PRE: This object is defined and as is obj.
 // POST: The list will contain obj encapsulated in a Link object
 //		added to the end of this list.
-template <class T> void List<T>::add( T obj )
+template <class T> void List<T>::add( const T &obj )
 {
 	if( mHead == 0 )
 	{
-		mHead = new Link<T>( obj );
+		mHead = newLink( obj );
 		mTail = mHead;
 	}
 	else if( mHead == mTail )
 	{
-		Link<T>* temp = new Link<T>( obj );
+		Link<T>* temp = newLink( obj );
 		mTail = temp;
 		mHead->setNext( mTail );
 		mTail->setPrev( mHead );
@@ -87,7 +204,7 @@ template <class T> void List<T>::add( T obj )
 	}
 	else
 	{
-		Link<T>* temp = new Link<T>( obj );
+		Link<T>* temp = newLink( obj );
 		mTail->setNext( temp );
 		temp->setPrev( mTail );
 		mTail = temp;
@@ -101,7 +218,7 @@ template <class T> void List<T>::add( T obj )
 //		encapsulated in a Link object and appened to the end
 //		of the list, else it is not added and the RV is
 //		the link that is of the same value as obj.
-template <class T> Link<T> *List<T>::addUnique( T obj )
+template <class T> Link<T> *List<T>::addUnique( const T &obj )
 {
 	Link<T> *ret = 0;
 	if( length() == 0 )
@@ -148,7 +265,7 @@ template <class T> void List<T>::replace( Link<T> *link, int numInsert, ... )
 	Link<T> *tListTail = 0;
 	for( int i = 0; i < numInsert; i++ )
 	{
-		Link<T> *temp = new Link<T>( va_arg ( arguments, T ) );
+		Link<T> *temp = newLink( va_arg ( arguments, T ) );
 		if( tListHead == 0 )
 		{
 			tListHead = temp;
@@ -171,6 +288,8 @@ template <class T> void List<T>::replace( Link<T> *link, int numInsert, ... )
 	}
 
 	tListTail->setNext( tNext );
+	if( tNext != 0 )
+		tNext->setPrev( tListTail );
 	
 	if( link->getPrev() == 0 )
 		mHead = tListHead;
@@ -180,23 +299,51 @@ template <class T> void List<T>::replace( Link<T> *link, int numInsert, ... )
 	if( link->getNext() == 0 )
 		mTail = tListTail;
 
-	delete link;
+	freeLink( link );
+	mLength += numInsert - 1;
+	mCursor = 0;//The links after link have moved.
+	va_end( arguments );
 }
 
 // PRE: This object is defined and index is a valid index into the list.
-// POST: The RV is the link at that position or 0.
+// POST: The RV is the link at that position or 0. The walk starts at
+//		whichever of the head, the tail and the cursor is closest, so
+//		walking the indexes in order is linear overall.
 template <class T> Link<T> *List<T>::operator[]( int index )
 {
+	if( index < 0 || index >= mLength )
+		return 0;
+
 	int position = 0;
 	Link<T> *walker = mHead;
-	
-	while( walker != 0 && position < index )
+	if( mLength - 1 - index < index )
+	{
+		position = mLength - 1;
+		walker = mTail;
+	}
+
+	int fromCursor = index > mCursorIndex ? index - mCursorIndex : mCursorIndex - index;
+	int fromWalker = index > position ? index - position : position - index;
+	if( mCursor != 0 && fromCursor < fromWalker )
+	{
+		position = mCursorIndex;
+		walker = mCursor;
+	}
+
+	while( position < index )
 	{
 		walker = walker->getNext();
 		position++;
 	}
+	while( position > index )
+	{
+		walker = walker->getPrev();
+		position--;
+	}
 
-	return walker;	
+	mCursor = walker;
+	mCursorIndex = index;
+	return walker;
 }
 
 #ifdef TESTING
@@ -210,6 +357,12 @@ void testListReplace();
 void testListCharPointer();
 // Tests the addUnique method.
 void testListAddUnique();
+// Tests a list whose links come from an arena.
+void testListArena();
+// Tests walking the list with iterators in both directions.
+void testListIterator();
+// Tests that indexing stays right as the cursor moves and the list changes.
+void testListCursor();
 #endif
 
 #endif
@@ -0,0 +1,134 @@
+#include "Lookup.h"
+
+//Slots in each table, powers of two with enough room that a seed is
+//found after a handful of tries.
+#define OPCODE_SLOTS 32
+#define REGISTER_SLOTS 64
+
+typedef struct __nameslot
+{
+	const char *name;//0 if the slot is empty.
+	uint32_t length;
+	uint32_t code;
+}NameSlot;
+
+template<uint32_t SLOTS>
+struct NameTable
+{
+	uint32_t seed;
+	NameSlot slots[SLOTS];
+};
+
+// PRE: name holds length chars.
+// POST: The RV is the FNV-1a hash of name started from seed.
+static constexpr uint32_t hashName( const char *name, size_t length, uint32_t seed )
+{
+	uint32_t hash = seed;
+	for( size_t i = 0; i < length; i++ )
+	{
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	return hash ^ ( hash >> 16 );
+}
+
+// PRE: str is a null terminated string.
+// POST: The RV is the length of str.
+static constexpr uint32_t nameLength( const char *str )
+{
+	uint32_t length = 0;
+	while( str[length] != '\0' )
+		length++;
+	return length;
+}
+
+// PRE: names holds COUNT distinct names, SLOTS is a power of two and
+//		larger than COUNT.
+// POST: The RV is a table where every name has a slot of its own, with
+//		the index of the name in names as its code.
+template<uint32_t SLOTS, size_t COUNT>
+static constexpr NameTable<SLOTS> makeNameTable( const char *const ( &names )[COUNT] )
+{
+	NameTable<SLOTS> table = {};
+	for( uint32_t seed = 2166136261u; ; seed++ )
+	{
+		for( uint32_t i = 0; i < SLOTS; i++ )
+			table.slots[i] = NameSlot{ 0, 0, 0 };
+
+		bool perfect = true;
+		for( uint32_t i = 0; i < COUNT && perfect; i++ )
+		{
+			uint32_t length = nameLength( names[i] );
+			NameSlot &slot = table.slots[hashName( names[i], length, seed ) & ( SLOTS - 1 )];
+			if( slot.name != 0 )
+				perfect = false;
+			else
+				slot = NameSlot{ names[i], length, i };
+		}
+
+		if( perfect )
+		{
+			table.seed = seed;
+			return table;
+		}
+	}
+}
+
+static constexpr NameTable<OPCODE_SLOTS> sOpcodes = makeNameTable<OPCODE_SLOTS>( OpcodeStrings );
+static constexpr NameTable<REGISTER_SLOTS> sRegisters = makeNameTable<REGISTER_SLOTS>( RegisterStrings );
+
+// PRE: table and name are defined.
+// POST: The RV is the slot that holds name, or 0 if name is not in table.
+template<uint32_t SLOTS>
+static inline const NameSlot *findName( const NameTable<SLOTS> &table, std::string_view name )
+{
+	const NameSlot &slot = table.slots[hashName( name.data(), name.length(), table.seed ) & ( SLOTS - 1 )];
+	if( slot.name == 0 || slot.length != name.length() || name.compare( 0, slot.length, slot.name, slot.length ) != 0 )
+		return 0;
+	return &slot;
+}
+
+// PRE: mnemonic is defined.
+// POST: The RV is the opcode that mnemonic names, or NONE if it is
+//       not one of OpcodeStrings.
+Opcode lookupOpcode( std::string_view mnemonic )
+{
+	const NameSlot *slot = findName( sOpcodes, mnemonic );
+	return slot != 0 ? (Opcode)slot->code : NONE;
+}
+
+// PRE: name is defined.
+// POST: The RV is the 4bit code of the register name, or NO_REGISTER
+//		if it is not one of RegisterStrings.
+uint32_t lookupRegister( std::string_view name )
+{
+	const NameSlot *slot = findName( sRegisters, name );
+	return slot != 0 ? slot->code : NO_REGISTER;
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+void testLookupOpcode()
+{
+	for( int i = ADD; i < NONE; i++ )
+		assert( lookupOpcode( OpcodeStrings[i] ) == i );
+
+	assert( lookupOpcode( "jarl" ) == NONE );
+	assert( lookupOpcode( "ad" ) == NONE );
+	assert( lookupOpcode( "addii" ) == NONE );
+	assert( lookupOpcode( "" ) == NONE );
+}
+
+void testLookupRegister()
+{
+	for( uint32_t i = 0; i < NUM_REGISTERS; i++ )
+		assert( lookupRegister( RegisterStrings[i] ) == i );
+
+	assert( lookupRegister( "$at" ) == 1 );
+	assert( lookupRegister( "$t3" ) == NO_REGISTER );
+	assert( lookupRegister( "$zer" ) == NO_REGISTER );
+	assert( lookupRegister( "t0" ) == NO_REGISTER );
+	assert( lookupRegister( "$" ) == NO_REGISTER );
+}
+#endif
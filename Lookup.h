@@ -0,0 +1,39 @@
+/*
+    Lookup: Turns mnemonics and register names into their codes.
+
+    Both sets of names are known when the assembler is compiled, so each
+    one gets a perfect hash table that is built by the compiler. The seed
+    of the hash is searched for at compile time until every name lands
+    in a slot of its own. A lookup is then one hash, one compare against
+    the name in that slot and the code stored next to it. Names that are
+    not in a table are rejected rather than given a default code.
+*/
+
+#ifndef __LOOKUP__
+#define __LOOKUP__
+
+#include <stdint.h>
+#include <string_view>
+#include "Parser.h"
+
+//Returned by lookupRegister for a name that is not a register.
+#define NO_REGISTER 0xFF
+
+// PRE: mnemonic is defined.
+// POST: The RV is the opcode that mnemonic names, or NONE if it is
+//       not one of OpcodeStrings.
+Opcode lookupOpcode( std::string_view mnemonic );
+
+// PRE: name is defined.
+// POST: The RV is the 4bit code of the register name, or NO_REGISTER
+//		if it is not one of RegisterStrings.
+uint32_t lookupRegister( std::string_view name );
+
+#ifdef TESTING
+// Tests that every mnemonic is found and unknown ones are rejected.
+void testLookupOpcode();
+// Tests that every register is found and unknown ones are rejected.
+void testLookupRegister();
+#endif
+
+#endif
@@ -0,0 +1,938 @@
+#include "Optimizer.h"
+#include "TokenStore.h"
+#include "FlowGraph.h"
+#include <string.h>
+#include <ctype.h>
+
+//Code of $fp in RegisterStrings, the variables are found off of it.
+#define FP_REGISTER 14
+//Code of $sp in RegisterStrings, what is found off of it is the stack.
+#define SP_REGISTER 13
+//Each loop a reference is in counts this many times more, up to
+//MAX_LOOP_DEPTH loops.
+#define LOOP_WEIGHT_SHIFT 3
+#define MAX_LOOP_DEPTH 8
+
+// PRE: values is defined.
+// POST: No register holds a variable.
+void clearValues( Values &values )
+{
+	for( int i = 0; i < NUM_REGISTERS; i++ )
+		values.holds[i] = NO_SYMBOL;
+}
+
+// PRE: values is defined and reg < NUM_REGISTERS.
+// POST: reg no longer holds a variable. Moving $fp moves every variable,
+//		so then no register does.
+static void writeRegister( Values &values, uint32_t reg )
+{
+	if( reg == FP_REGISTER )
+		clearValues( values );
+	else
+		values.holds[reg] = NO_SYMBOL;
+}
+
+// PRE: into and from are defined.
+// POST: into only holds what both held. The RV is true if into changed.
+static bool meetValues( Values &into, const Values &from )
+{
+	bool changed = false;
+	for( int i = 0; i < NUM_REGISTERS; i++ )
+	{
+		if( into.holds[i] != from.holds[i] && into.holds[i] != NO_SYMBOL )
+		{
+			into.holds[i] = NO_SYMBOL;
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+// PRE: values is defined, op and x are the fields of an instruction and
+//		variable is the symbol that its second param names, NO_SYMBOL if
+//		it names none.
+// POST: The RV is true if the instruction does nothing, a LW of the
+//		variable a register holds or a SW of it back. Otherwise values is
+//		moved past the instruction.
+bool stepValues( Values &values, uint32_t op, uint32_t x, uint32_t variable )
+{
+	bool named = variable != NO_SYMBOL;
+	switch( op )
+	{
+		case LW:
+			if( named && x != 0 && values.holds[x] == variable )
+				return true;
+			writeRegister( values, x );
+			if( named && x != 0 && x != FP_REGISTER )
+				values.holds[x] = variable;
+			break;
+		case SW:
+			if( !named )
+			{
+				//A store to an address may write any variable.
+				clearValues( values );
+				break;
+			}
+			if( x != 0 && values.holds[x] == variable )
+				return true;
+			for( int i = 0; i < NUM_REGISTERS; i++ )
+				if( values.holds[i] == variable )
+					values.holds[i] = NO_SYMBOL;
+			if( x != 0 )
+				values.holds[x] = variable;
+			break;
+		case ADD:
+		case NAND:
+		case ADDI:
+		case IN:
+			writeRegister( values, x );
+			break;
+		case JALR:
+			//The routine called may change anything.
+			clearValues( values );
+			break;
+	}
+	return false;
+}
+
+// PRE: names and name are defined.
+// POST: The RV is the index of name in names, it is added if it is new.
+static uint32_t internName( SymbolTable &names, const char *name )
+{
+	ParseSymbol symbol;
+	strcpy( symbol.name, name );
+	symbol.type = Symbols::VARIABLE;
+	symbol.address = 0;
+	ParseSymbol *found = names.addUnique( symbol );
+	return found == 0 ? names.length() - 1 : found - &names[0];
+}
+
+// PRE: op and name are the opcode and second param of an instruction.
+// POST: The RV is true if it is a LW/SW of a variable. A param that is a
+//		number is an address, the same test addFixup makes.
+static bool namesVariable( uint32_t op, const char *name )
+{
+	return ( op == LW || op == SW ) && name != 0 && name[0] != '\0' && !IS_CONSTANT( name );
+}
+
+// PRE: None.
+// POST: This object is defined and no register holds a variable.
+Peephole::Peephole(): mRemovedLoads( 0 ), mRemovedStores( 0 )
+{
+	clearValues( mValues );
+}
+
+// PRE: This object and token are defined, token is an encoded
+//		instruction that follows the ones given before.
+// POST: The RV is false if token does nothing with what the registers
+//		hold, so it can be left out. What the registers hold is moved
+//		past token.
+bool Peephole::keep( const InstructionToken &token )
+{
+	//A lable can be branched to from anywhere.
+	if( token.hasLable )
+		clearValues( mValues );
+
+	uint32_t op = token.instruct.instruct.op;
+	uint32_t variable = NO_SYMBOL;
+	if( namesVariable( op, token.params[1] ) )
+		variable = internName( mNames, token.params[1] );
+
+	if( stepValues( mValues, op, token.instruct.instruct.x, variable ) )
+	{
+		if( op == LW )
+			mRemovedLoads++;
+		else
+			mRemovedStores++;
+		return false;
+	}
+
+	//Straight line code ends at a branch.
+	if( op == BEQ || op == JALR || op == HALT )
+		clearValues( mValues );
+	return true;
+}
+
+// PRE: tokens holds the words of a program from address 0 whose symbols
+//		are not collected yet.
+// POST: This object is defined and no word is marked.
+Optimizer::Optimizer( TokenStore &tokens ): mTokens( tokens ), mRemovedLoads( 0 ), mRemovedStores( 0 ),
+											mPromoted( 0 ), mUnreachable( 0 )
+{
+	uint32_t length = tokens.length();
+	mVariables.resize( length );
+	mRemoved.resize( length );
+	mOrigins.resize( length );
+	for( uint32_t i = 0; i < length; i++ )
+	{
+		InstructionUnion instruct;
+		instruct.binary = tokens.word( i );
+		const char *name = tokens.operand( i, 1 );
+		mVariables[i] = namesVariable( instruct.op, name ) ? internName( mNames, name ) : NO_SYMBOL;
+		mRemoved[i] = false;
+		mOrigins[i] = i;
+	}
+}
+
+// PRE: This object is defined.
+// POST: The loads and stores that do nothing on every path to them are
+//		marked to be removed. The RV is the number marked.
+uint32_t Optimizer::forwardValues()
+{
+	FlowGraph graph( mTokens );
+	uint32_t blocks = graph.length();
+	Array<Values> in;//What holds at the start of each block.
+	Array<bool> reached;
+	Array<bool> queued;
+	Array<uint32_t> work;
+	in.resize( blocks );
+	reached.resize( blocks );
+	queued.resize( blocks );
+	for( uint32_t b = 0; b < blocks; b++ )
+	{
+		reached[b] = queued[b] = graph[b].entered;
+		clearValues( in[b] );
+		if( graph[b].entered )
+			work.add( b );
+	}
+
+	//A block is walked again whenever less holds at its start, as each
+	//register can only lose its variable this ends.
+	while( work.length() != 0 )
+	{
+		uint32_t b = work[work.length() - 1];
+		work.resize( work.length() - 1 );
+		queued[b] = false;
+
+		Values values = in[b];
+		for( uint32_t i = graph[b].first; i < graph[b].end; i++ )
+		{
+			InstructionUnion instruct;
+			instruct.binary = mTokens.word( i );
+			stepValues( values, instruct.op, instruct.x, mVariables[i] );
+		}
+
+		uint32_t edges[2] = { graph[b].next, graph[b].target };
+		for( int e = 0; e < 2; e++ )
+		{
+			uint32_t s = edges[e];
+			if( s == NO_BLOCK || graph[s].entered )
+				continue;
+
+			bool changed = !reached[s];
+			if( !reached[s] )
+			{
+				in[s] = values;
+				reached[s] = true;
+			}
+			else
+				changed = meetValues( in[s], values );
+
+			if( changed && !queued[s] )
+			{
+				queued[s] = true;
+				work.add( s );
+			}
+		}
+	}
+
+	//A block that is never reached keeps everything, its start is
+	//cleared. The first word of a block keeps its lable so it stays.
+	uint32_t marked = 0;
+	for( uint32_t b = 0; b < blocks; b++ )
+	{
+		Values values = in[b];
+		for( uint32_t i = graph[b].first; i < graph[b].end; i++ )
+		{
+			InstructionUnion instruct;
+			instruct.binary = mTokens.word( i );
+			if( stepValues( values, instruct.op, instruct.x, mVariables[i] ) && mTokens.lable( i ) == 0 )
+			{
+				mRemoved[i] = true;
+				if( instruct.op == LW )
+					mRemovedLoads++;
+				else
+					mRemovedStores++;
+				marked++;
+			}
+		}
+	}
+	return marked;
+}
+
+// PRE: This object is defined.
+// POST: The marked words are dropped from the store and the rest have
+//		the addresses 0, 4, ...
+void Optimizer::removeMarked()
+{
+	mTokens.compact( mRemoved );
+	uint32_t kept = 0;
+	for( uint32_t i = 0; i < mRemoved.length(); i++ )
+	{
+		if( mRemoved[i] )
+			continue;
+		mVariables[kept] = mVariables[i];
+		mOrigins[kept] = mOrigins[i];
+		kept++;
+	}
+	mVariables.resize( kept );
+	mRemoved.resize( kept );
+	mOrigins.resize( kept );
+	for( uint32_t i = 0; i < kept; i++ )
+		mRemoved[i] = false;
+}
+
+// PRE: reached holds a flag for each block, block is one of them or
+//		NO_BLOCK.
+// POST: block is marked reached and put on work if it was not already.
+static void reachBlock( uint32_t block, Array<bool> &reached, Array<uint32_t> &work )
+{
+	if( block == NO_BLOCK || reached[block] )
+		return;
+	reached[block] = true;
+	work.add( block );
+}
+
+// PRE: This object is defined, no word is marked and roots holds lables.
+// POST: The words of the blocks that can not be reached from the first
+//		word or a root are marked to be removed. A root that is not a
+//		lable is left out. The RV is the number marked.
+uint32_t Optimizer::markUnreachable( const Array<const char *> &roots )
+{
+	FlowGraph graph( mTokens );
+	uint32_t blocks = graph.length();
+	Array<bool> reached;
+	Array<uint32_t> work;
+	reached.resize( blocks );
+	for( uint32_t b = 0; b < blocks; b++ )
+		reached[b] = false;
+
+	if( blocks != 0 )
+		reachBlock( 0, reached, work );
+	for( uint32_t r = 0; r < roots.length(); r++ )
+		reachBlock( graph.blockOf( roots[r] ), reached, work );
+
+	while( work.length() != 0 )
+	{
+		uint32_t b = work[work.length() - 1];
+		work.resize( work.length() - 1 );
+		reachBlock( graph[b].next, reached, work );
+		reachBlock( graph[b].target, reached, work );
+
+		//A lable a word names may be loaded and jumped to.
+		for( uint32_t i = graph[b].first; i < graph[b].end; i++ )
+		{
+			for( int p = 0; p < NUM_PARAMS; p++ )
+			{
+				const char *name = mTokens.operand( i, p );
+				if( name != 0 )
+					reachBlock( graph.blockOf( name ), reached, work );
+			}
+		}
+	}
+
+	uint32_t marked = 0;
+	for( uint32_t b = 0; b < blocks; b++ )
+	{
+		if( reached[b] )
+			continue;
+		for( uint32_t i = graph[b].first; i < graph[b].end; i++ )
+			mRemoved[i] = true;
+		marked += graph[b].end - graph[b].first;
+	}
+	mUnreachable += marked;
+	return marked;
+}
+
+// PRE: array is defined and index <= its length.
+// POST: count copies of value are put in before index.
+template <class T> static void insertAt( Array<T> &array, uint32_t index, uint32_t count, const T &value )
+{
+	uint32_t length = array.length();
+	array.resize( length + count );
+	for( uint32_t i = length; i-- > index; )
+		array[i + count] = array[i];
+	for( uint32_t i = 0; i < count; i++ )
+		array[index + i] = value;
+}
+
+// PRE: x, y and z are registers.
+// POST: The RV is the word of add x, y, z.
+static uint32_t encodeAdd( uint32_t x, uint32_t y, uint32_t z )
+{
+	InstructionUnion instruct;
+	instruct.binary = 0;
+	instruct.op = ADD;
+	instruct.x = x;
+	instruct.y = y;
+	instruct.z = z;
+	return instruct.binary;
+}
+
+// PRE: This object is defined and no word is marked.
+// POST: The variables referenced most are moved into registers the program
+//		does not use, their LW/SWs become ADDs and the words that set the
+//		registers to 0 are put in at the start. The rest have the addresses
+//		0, 4, ... The RV is the number of variables promoted.
+uint32_t Optimizer::promoteVariables()
+{
+	//$zero can not hold anything, $at is kept for the assembler and the
+	//rest are what the calls and variables go through.
+	bool used[NUM_REGISTERS] = { false };
+	used[0] = used[1] = used[12] = used[SP_REGISTER] = used[FP_REGISTER] = used[15] = true;
+
+	uint32_t length = mTokens.length();
+	for( uint32_t i = 0; i < length; i++ )
+	{
+		InstructionUnion instruct;
+		instruct.binary = mTokens.word( i );
+		switch( instruct.op )
+		{
+			case ADD:
+			case NAND:
+				used[instruct.z] = true;
+				//Fall through.
+			case ADDI:
+			case BEQ:
+			case JALR:
+				used[instruct.y] = true;
+				used[instruct.x] = true;
+				break;
+			case LW:
+			case SW:
+				used[instruct.x] = true;
+				if( mVariables[i] != NO_SYMBOL )
+					break;
+				used[instruct.y] = true;
+				//An address may be any variable's slot.
+				if( instruct.y != SP_REGISTER &&
+					( instruct.y != 0 || instruct.value < 0 || (uint32_t)instruct.value >= length * 4 ) )
+					return 0;
+				break;
+			case IN:
+			case OUT:
+				used[instruct.x] = true;
+				break;
+		}
+	}
+
+	uint32_t free[NUM_REGISTERS];
+	uint32_t frees = 0;
+	for( uint32_t r = 0; r < NUM_REGISTERS; r++ )
+		if( !used[r] )
+			free[frees++] = r;
+	if( frees == 0 )
+		return 0;
+
+	//A word is in a loop when it is between a lable and a BEQ back to it.
+	FlowGraph graph( mTokens );
+	Array<int32_t> loops;
+	loops.resize( length + 1 );
+	for( uint32_t i = 0; i <= length; i++ )
+		loops[i] = 0;
+	for( uint32_t b = 0; b < graph.length(); b++ )
+	{
+		InstructionUnion instruct;
+		instruct.binary = mTokens.word( graph[b].end - 1 );
+		uint32_t target = graph[b].target;
+		if( instruct.op == BEQ && target != NO_BLOCK && target <= b )
+		{
+			loops[graph[target].first]++;
+			loops[graph[b].end]--;
+		}
+	}
+
+	//A variable that is also a lable or a branch target needs its slot,
+	//and an entry of the constant pool does not start at 0.
+	uint32_t names = mNames.length();
+	Array<uint64_t> weights;
+	Array<uint32_t> references;
+	weights.resize( names );
+	references.resize( names );
+	for( uint32_t v = 0; v < names; v++ )
+	{
+		weights[v] = 0;
+		bool kept = mNames[v].name[0] == POOL_PREFIX || graph.blockOf( mNames[v].name ) != NO_BLOCK;
+		references[v] = kept ? NO_SYMBOL : 0;
+	}
+
+	int32_t depth = 0;
+	for( uint32_t i = 0; i < length; i++ )
+	{
+		depth += loops[i];
+		uint32_t v = mVariables[i];
+		if( v != NO_SYMBOL && references[v] != NO_SYMBOL )
+		{
+			weights[v] += (uint64_t)1 << ( LOOP_WEIGHT_SHIFT * ( depth < MAX_LOOP_DEPTH ? depth : MAX_LOOP_DEPTH ) );
+			references[v]++;
+		}
+
+		for( int p = 0; p < NUM_PARAMS; p++ )
+		{
+			const char *name = mTokens.operand( i, p );
+			ParseSymbol *symbol = name == 0 || ( p == 1 && v != NO_SYMBOL ) ? 0 : mNames.find( name );
+			if( symbol != 0 )
+				references[symbol - &mNames[0]] = NO_SYMBOL;
+		}
+	}
+
+	//The heaviest variables get the free registers, one that is only
+	//referenced once would not save anything.
+	Array<uint32_t> registers;
+	registers.resize( names );
+	for( uint32_t v = 0; v < names; v++ )
+		registers[v] = NUM_REGISTERS;
+	uint32_t promoted = 0;
+	while( promoted < frees )
+	{
+		uint32_t best = NO_SYMBOL;
+		for( uint32_t v = 0; v < names; v++ )
+			if( references[v] != NO_SYMBOL && references[v] >= 2 && registers[v] == NUM_REGISTERS &&
+				( best == NO_SYMBOL || weights[v] > weights[best] ) )
+				best = v;
+		if( best == NO_SYMBOL )
+			break;
+		registers[best] = free[promoted++];
+	}
+	if( promoted == 0 )
+		return 0;
+
+	for( uint32_t i = 0; i < length; i++ )
+	{
+		uint32_t v = mVariables[i];
+		if( v == NO_SYMBOL || registers[v] == NUM_REGISTERS )
+			continue;
+
+		InstructionUnion instruct;
+		instruct.binary = mTokens.word( i );
+		if( instruct.op == LW )
+			mTokens.word( i ) = encodeAdd( instruct.x, registers[v], 0 );
+		else
+			mTokens.word( i ) = encodeAdd( registers[v], instruct.x, 0 );
+		mTokens.clearOperands( i );
+		mVariables[i] = NO_SYMBOL;
+		mOrigins[i] = NO_WORD;
+	}
+
+	//The registers start as the slots did.
+	uint32_t starts[NUM_REGISTERS];
+	for( uint32_t r = 0; r < promoted; r++ )
+		starts[r] = encodeAdd( free[r], 0, 0 );
+	mTokens.insertWords( 0, starts, promoted );
+	insertAt( mVariables, 0, promoted, (uint32_t)NO_SYMBOL );
+	insertAt( mRemoved, 0, promoted, false );
+	insertAt( mOrigins, 0, promoted, (uint32_t)NO_WORD );
+
+	mPromoted += promoted;
+	return promoted;
+}
+
+#ifdef TESTING
+#include <assert.h>
+#include <stdio.h>
+#include <sstream>
+#include <fstream>
+#include "Emulator.h"
+
+// PRE: lines holds count lines of source.
+// POST: Every line is expanded by p and given to peephole, the RV is the
+//		number of instructions kept.
+static uint32_t keepLines( Peephole &peephole, const char **lines, int count )
+{
+	Parser p;
+	Array<InstructionToken> tokens;
+	uint32_t kept = 0;
+	for( int i = 0; i < count; i++ )
+	{
+		tokens.clear();
+		p.preprocessLine( tokens, lines[i] );
+		for( uint32_t j = 0; j < tokens.length(); j++ )
+			if( peephole.keep( tokens[j] ) )
+				kept++;
+	}
+	return kept;
+}
+
+void testPeepholeRedundantLoads()
+{
+	//add x, x, y ends with sw $t0, x and add x, x, z starts with lw $t0, x.
+	const char *lines[] = { "add x, x, y", "add x, x, z", "out x" };
+	Peephole peephole;
+	assert( keepLines( peephole, lines, 3 ) == 5 + 5 + 2 - 2 );
+	assert( peephole.getRemovedLoads() == 2 && peephole.getRemovedStores() == 0 );
+
+	//The second load of y into $t0 goes, the load of y into $t1 does not.
+	const char *loads[] = { "out y", "out y", "beq y, y, done" };
+	Peephole second;
+	assert( keepLines( second, loads, 3 ) == 2 + 1 + 3 - 1 );
+}
+
+void testPeepholeBoundaries()
+{
+	//The lable is on the out, so the load before it is still left out.
+	const char *lable[] = { "out x", "loop: out x", "out x" };
+	Peephole peephole;
+	assert( keepLines( peephole, lable, 3 ) == 6 - 1 );
+
+	const char *branch[] = { "out x", "beq $a0, $a1, loop", "out x" };
+	Peephole afterBranch;
+	assert( keepLines( afterBranch, branch, 3 ) == 5 && afterBranch.getRemovedLoads() == 0 );
+
+	//$t0 is written, x is stored through an address and $fp is moved.
+	const char *writes[] = { "out x", "addi $t0, $t0, 1", "out x",
+							 "sw $a0, 8($sp)", "out x",
+							 "addi $fp, $fp, 4", "out x" };
+	Peephole written;
+	assert( keepLines( written, writes, 7 ) == 11 && written.getRemovedLoads() == 0 );
+}
+
+// PRE: source is an LC2200 program that reads three numbers.
+// POST: source is assembled at the optimize level, stripped if strip is
+//		true, and run on "4 5 6". The RV is what it wrote, words and
+//		dataWords are the size of the image and of its data.
+static std::string runProgram( const char *source, uint32_t level, bool strip, uint32_t &words,
+							   uint32_t &dataWords )
+{
+	char name[] = "testPeephole.s";
+	FILE *file = fopen( name, "w" );
+	fputs( source, file );
+	fclose( file );
+
+	std::ostringstream log;
+	Parser p( name );
+	p.setLog( &log );
+	p.setOptimize( level );
+	p.setStrip( strip );
+	p.preprocess();
+	p.parse();
+	assert( p.getErrors() == 0 );
+	words = p.getWordCount();
+	dataWords = words - p.getCodeWords();
+
+	Emulator emulator( 256 );
+	assert( emulator.load( "testPeephole.s.bin" ) );
+	std::istringstream in( "4 5 6" );
+	std::ostringstream out;
+	assert( emulator.run( 100000, in, out ) );
+	remove( name );
+	remove( "testPeephole.s.bin" );
+	return out.str();
+}
+
+void testPeepholeProgram()
+{
+	const char *source = "in x\nin y\nin z\n"
+						 "add x, x, y\nadd x, x, z\nout x\n"
+						 "addi $a0, $zero, 0\nloop: addi $a0, $a0, 1\nadd s, s, x\n"
+						 "lw $a1, y\nbeq $a0, $a1, done\nbeq $zero, $zero, loop\n"
+						 "done: lw $a2, s\nout $a2\nhalt\n";
+	uint32_t words, optimizedWords, dataWords;
+	std::string plain = runProgram( source, 0, false, words, dataWords );
+	std::string optimized = runProgram( source, 1, false, optimizedWords, dataWords );
+	assert( plain == "15\n75\n" );
+	assert( optimized == plain );
+	assert( optimizedWords < words );
+}
+
+// PRE: lines holds count lines of source and tokens is empty.
+// POST: The expansions of the lines are in tokens from address 0.
+static void storeLines( TokenStore &tokens, const char **lines, int count )
+{
+	Parser p;
+	Array<InstructionToken> expanded;
+	for( int i = 0; i < count; i++ )
+		p.preprocessLine( expanded, lines[i] );
+	for( uint32_t i = 0; i < expanded.length(); i++ )
+	{
+		expanded[i].address = i * 4;
+		tokens.add( expanded[i] );
+	}
+}
+
+void testOptimizerLoop()
+{
+	//The peephole forgets $a1 at the lable, but it holds x on both
+	//edges into the loop.
+	const char *lines[] = { "lw $a1, x",
+							"loop: out $a2",
+							"lw $a1, x",
+							"sw $a1, x",
+							"beq $a2, $zero, loop",
+							"halt" };
+	TokenStore tokens;
+	storeLines( tokens, lines, 6 );
+	Optimizer optimizer( tokens );
+	assert( optimizer.forwardValues() == 2 );
+	assert( optimizer.getRemovedLoads() == 1 && optimizer.getRemovedStores() == 1 );
+	assert( !optimizer.removes( 0 ) && optimizer.removes( 2 ) && optimizer.removes( 3 ) );
+
+	optimizer.removeMarked();
+	assert( tokens.length() == 4 );
+	assert( strcmp( tokens.lable( 1 ), "loop" ) == 0 );
+	assert( tokens.address( 3 ) == 12 );
+	assert( optimizer.forwardValues() == 0 );
+}
+
+void testOptimizerJoins()
+{
+	//$a1 holds x on one edge into join and y on the other.
+	const char *lines[] = { "lw $a1, x",
+							"beq $a0, $zero, join",
+							"lw $a1, y",
+							"join: out $a2",
+							"lw $a1, x",
+							"halt" };
+	TokenStore tokens;
+	storeLines( tokens, lines, 6 );
+	Optimizer optimizer( tokens );
+	assert( optimizer.forwardValues() == 0 );
+
+	//With x on both edges the load after the join goes, as does the
+	//second load of x before it.
+	lines[2] = "lw $a1, x";
+	TokenStore same;
+	storeLines( same, lines, 6 );
+	Optimizer both( same );
+	assert( both.forwardValues() == 2 && both.removes( 2 ) && both.removes( 4 ) );
+
+	//A JALR through a register could come back to the lable.
+	const char *call[] = { "lw $a1, x",
+						   "beq $a0, $zero, join",
+						   "jalr $a0, $ra",
+						   "join: out $a2",
+						   "lw $a1, x",
+						   "halt" };
+	TokenStore called;
+	storeLines( called, call, 6 );
+	Optimizer unknown( called );
+	assert( unknown.forwardValues() == 0 );
+}
+
+// PRE: file is an assembled .bin.
+// POST: words holds its words.
+static void readHex( const char *file, Array<uint32_t> &words )
+{
+	std::ifstream in( file );
+	std::string line;
+	while( std::getline( in, line ) )
+		words.add( (uint32_t)strtoul( line.c_str(), 0, 16 ) );
+}
+
+// PRE: source is an LC2200 program.
+// POST: source is assembled with and without -O. The optimized code is
+//		checked to be the plain code less only LW/SW words, the other
+//		words the same but for where a BEQ lands, a LW/SW finds its
+//		variable or the address an ADDI puts in a register, and the data
+//		is checked to be the same. The RV is the number of words that
+//		were removed.
+static uint32_t checkEquivalent( const char *source )
+{
+	char name[] = "testOptimizerEquivalence.s";
+	Array<uint32_t> words[2];
+	uint32_t codeWords[2];
+	uint32_t removed = 0;
+	for( int optimize = 0; optimize < 2; optimize++ )
+	{
+		FILE *file = fopen( name, "w" );
+		fputs( source, file );
+		fclose( file );
+
+		std::ostringstream log;
+		Parser p( name );
+		p.setLog( &log );
+		p.setOptimize( optimize != 0 );
+		p.preprocess();
+		p.parse();
+		readHex( "testOptimizerEquivalence.s.bin", words[optimize] );
+		codeWords[optimize] = p.getCodeWords();
+		if( optimize )
+			removed = p.getRemovedWords();
+		remove( name );
+		remove( "testOptimizerEquivalence.s.bin" );
+	}
+
+	assert( words[0].length() - codeWords[0] == words[1].length() - codeWords[1] );
+	uint32_t j = 0;
+	for( uint32_t i = 0; i < codeWords[0]; i++ )
+	{
+		InstructionUnion plain, optimized;
+		plain.binary = words[0][i];
+		optimized.binary = j < codeWords[1] ? words[1][j] : 0xFFFFFFFF;
+		bool moves = plain.op == BEQ || plain.op == LW || plain.op == SW || plain.op == ADDI;
+		bool same = moves ? plain.op == optimized.op && plain.x == optimized.x && plain.y == optimized.y :
+							plain.binary == optimized.binary;
+		if( same )
+			j++;
+		else
+			assert( plain.op == LW || plain.op == SW );
+	}
+	assert( j == codeWords[1] );
+	assert( codeWords[0] - codeWords[1] == removed );
+	for( uint32_t i = codeWords[0]; i < words[0].length(); i++ )
+		assert( words[0][i] == words[1][i - codeWords[0] + codeWords[1]] );
+	return removed;
+}
+
+void testOptimizerEquivalence()
+{
+	const char *programs[] = { "add_neg", "beq_ne", "beq_un", "jalr", "nand", "sw", "test" };
+	for( uint32_t i = 0; i < sizeof( programs ) / sizeof( programs[0] ); i++ )
+	{
+		std::string path = std::string( "tests/" ) + programs[i];
+		std::ifstream in( path.c_str() );
+		assert( in.is_open() );
+		std::ostringstream source;
+		source << in.rdbuf();
+		checkEquivalent( source.str().c_str() );
+	}
+
+	//And a program that does lose words, in a loop and across a call.
+	assert( checkEquivalent( "in x\nin y\nadd x, x, y\nadd x, x, y\n"
+							 "loop: out x\nadd x, x, y\nbeq x, y, done\n"
+							 "jalr sub\nbeq $zero, $zero, loop\n"
+							 "sub: out y\njalr $ra, $zero\ndone: halt\n" ) > 0 );
+}
+
+void testOptimizerPromote()
+{
+	//Only $s2 is free. x is referenced in the loop so it gets it over z.
+	const char *lines[] = { "add $v0, $a1, $t2",
+							"nand $a2, $s0, $s1",
+							"in x",
+							"out z", "out z", "out z", "out z",
+							"loop: add x, x, $a0",
+							"beq x, $v0, done",
+							"beq $zero, $zero, loop",
+							"done: halt" };
+	TokenStore tokens;
+	storeLines( tokens, lines, 11 );
+	uint32_t length = tokens.length();
+	Optimizer optimizer( tokens );
+	assert( optimizer.promoteVariables() == 1 && optimizer.getPromoted() == 1 );
+	assert( tokens.length() == length + 1 );
+
+	//add $s2, $zero, $zero, then lw $t0, x is add $t0, $s2, $zero and
+	//sw $t0, x is add $s2, $t0, $zero.
+	InstructionUnion instruct;
+	instruct.binary = tokens.word( 0 );
+	assert( instruct.op == ADD && instruct.x == 11 && instruct.y == 0 && instruct.z == 0 );
+	assert( optimizer.origin( 0 ) == NO_WORD && optimizer.origin( 3 ) == NO_WORD );
+	instruct.binary = tokens.word( 3 );
+	assert( instruct.op == ADD && instruct.x == 6 && instruct.y == 11 && tokens.operand( 3, 1 ) == 0 );
+	instruct.binary = tokens.word( 5 );
+	assert( instruct.op == ADD && instruct.x == 11 && instruct.y == 6 );
+	assert( optimizer.origin( 6 ) == 5 && strcmp( tokens.operand( 6, 1 ), "z" ) == 0 );
+	assert( strcmp( tokens.lable( 16 ), "loop" ) == 0 && tokens.address( 16 ) == 64 );
+	for( uint32_t i = 0; i < tokens.length(); i++ )
+		assert( tokens.operand( i, 1 ) == 0 || strcmp( tokens.operand( i, 1 ), "x" ) != 0 );
+
+	//Nothing is left to promote and no register is free.
+	assert( optimizer.promoteVariables() == 0 );
+
+	//w is branched to, so it keeps its slot.
+	const char *branched[] = { "out w", "out w", "beq $zero, $zero, w" };
+	TokenStore target;
+	storeLines( target, branched, 3 );
+	Optimizer keeps( target );
+	assert( keeps.promoteVariables() == 0 );
+
+	//A store off of $sp is the stack, one to an address could be w.
+	const char *stack[] = { "out w", "out w", "sw $a0, 8($sp)" };
+	TokenStore pushed;
+	storeLines( pushed, stack, 3 );
+	Optimizer promotes( pushed );
+	assert( promotes.promoteVariables() == 1 );
+
+	const char *address[] = { "out w", "out w", "sw $a0, 400" };
+	TokenStore stored;
+	storeLines( stored, address, 3 );
+	Optimizer aliased( stored );
+	assert( aliased.promoteVariables() == 0 );
+}
+
+void testOptimizerPromoteProgram()
+{
+	//x, y, z and s all go into $v0, $s0, $s1 and $s2.
+	const char *source = "in x\nin y\nin z\n"
+						 "add x, x, y\nadd x, x, z\nout x\n"
+						 "addi $a0, $zero, 0\nloop: addi $a0, $a0, 1\nadd s, s, x\n"
+						 "lw $a1, y\nbeq $a0, $a1, done\nbeq $zero, $zero, loop\n"
+						 "done: lw $a2, s\nout $a2\nhalt\n";
+	uint32_t words, dataWords, promotedWords, promotedData;
+	std::string plain = runProgram( source, 1, false, words, dataWords );
+	std::string promoted = runProgram( source, 2, false, promotedWords, promotedData );
+	assert( plain == "15\n75\n" );
+	assert( promoted == plain );
+	//Each slot that goes is a word that sets a register at the start.
+	assert( dataWords == 4 && promotedData == 0 );
+	assert( promotedWords == words );
+}
+
+void testOptimizerUnreachable()
+{
+	//unused is never named, other is only named by code that is not
+	//reached and used is called.
+	const char *lines[] = { "jalr used",
+							"halt",
+							"other: out z",
+							"halt",
+							"unused: out x",
+							"beq $zero, $zero, other",
+							"used: out y",
+							"jalr $ra, $zero" };
+	TokenStore tokens;
+	storeLines( tokens, lines, 8 );
+	Array<const char *> roots;
+	Optimizer optimizer( tokens );
+	//lw $k0, used; jalr | halt | lw | other: out, halt | lw | unused: out, beq | lw |
+	//used: out, jalr. A lable is on the out, so a call skips the lw
+	//before it and that is not reached either.
+	assert( optimizer.markUnreachable( roots ) == 3 + 3 + 1 );
+	assert( !optimizer.removes( 2 ) && optimizer.removes( 3 ) && optimizer.removes( 5 ) );
+	assert( optimizer.removes( 6 ) && optimizer.removes( 9 ) && !optimizer.removes( 10 ) );
+	optimizer.removeMarked();
+	assert( tokens.length() == 5 && strcmp( tokens.lable( 3 ), "used" ) == 0 );
+	assert( optimizer.getUnreachable() == 7 );
+
+	//A root keeps its code and the lables it names, only the lws before
+	//the three lables are left out.
+	TokenStore kept;
+	storeLines( kept, lines, 8 );
+	roots.add( "unused" );
+	roots.add( "missing" );
+	Optimizer rooted( kept );
+	assert( rooted.markUnreachable( roots ) == 3 && rooted.removes( 3 ) && rooted.removes( 6 ) && rooted.removes( 9 ) );
+}
+
+void testOptimizerStripProgram()
+{
+	//The words of unused are only reached by falling through the beq.
+	const char *source = "in x\nin y\nin z\nbeq $zero, $zero, sum\n"
+						 "unused: add t, x, x\nout t\nhalt\n"
+						 "sum: addi $a0, $zero, 0\nadd s, x, y\nadd s, s, z\nout s\nhalt\n";
+	uint32_t words, dataWords, strippedWords, strippedData;
+	std::string plain = runProgram( source, 0, false, words, dataWords );
+	std::string stripped = runProgram( source, 0, true, strippedWords, strippedData );
+	assert( plain == "15\n" );
+	assert( stripped == plain );
+	assert( dataWords == 5 && strippedData == 4 );
+	assert( strippedWords == words - 8 - 1 );
+}
+
+void testOptimizerCallProgram()
+{
+	//twice is only reached by the calls, which come back to the line
+	//after them. The second goes through a variable that holds it.
+	const char *source = "in x\nin y\nin z\nadd $a0, x, $zero\n"
+						 "addi $a1, $zero, twice\nsw $a1, fptr\n"
+						 "jalr twice\njalr fptr\nout $a0\n"
+						 "add s, x, y\nout s\nhalt\n"
+						 "twice: add $a0, $a0, $a0\njalr $ra, $zero\n";
+	uint32_t words, dataWords;
+	std::string plain = runProgram( source, 0, false, words, dataWords );
+	assert( plain == "16\n9\n" );
+	assert( runProgram( source, 1, false, words, dataWords ) == plain );
+	assert( runProgram( source, 2, false, words, dataWords ) == plain );
+	assert( runProgram( source, 0, true, words, dataWords ) == plain );
+}
+#endif
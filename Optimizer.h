@@ -0,0 +1,215 @@
+/*
+    Optimizer: Leaves out the loads and stores that the expansion of
+    variables makes more than once.
+
+    Every variable operand is expanded on its own, so a line that writes a
+    variable ends with a SW of it and the next line that reads it starts
+    with a LW of the same variable into the same register. Both passes
+    keep the Values, the variable that each register holds a copy of, as
+    they walk the instructions. A LW of a variable into a register that
+    already holds it does nothing, nor does a SW of a register back into
+    the variable it holds, and both are left out.
+
+    The Peephole is shown each expanded instruction in order, before it is
+    added to the token store, and only looks at straight line code. What
+    the registers hold is forgotten at an instruction with a lable, as it
+    can be reached from elsewhere, and after a BEQ, JALR or HALT.
+
+    The Optimizer then looks at the whole program in the token store. It
+    builds the FlowGraph and finds the Values at the start of every block,
+    those that hold on every edge into it, by walking the blocks until
+    nothing changes. A block that is entered from where the graph can not
+    see starts with nothing known. So a load at the top of a loop goes
+    when the loop body and the code before it both leave the variable in
+    the register.
+
+    In both a store that does not name a variable may write any of them,
+    and a write to $fp moves all of them, so both forget every register.
+
+    With -O2 the Optimizer also promotes variables into registers. A
+    variable is in memory for the whole run, so a register can only hold
+    it if no instruction of the program reads or writes that register.
+    $zero, $at, $k0, $sp, $fp and $ra are never used, the expansions and
+    calls need them. The free registers go to the variables referenced
+    most, each reference counting 8 times more for every loop it is in,
+    where a loop is the words from a lable up to a BEQ back to it. The
+    LW/SW of a promoted variable become an ADD to or from its register
+    and the variable loses its slot in the data. Its register is set to 0
+    at the start of the program, as the slot was. Nothing is promoted
+    when the program loads or stores through an address that could be a
+    variable, only $sp, taken to be the stack, and a constant address in
+    the code are known not to be.
+
+    With --strip the Optimizer first leaves out the code that can not be
+    reached. The blocks reached are the first one, those of the lables
+    given as roots, and from each block reached the blocks it goes to
+    and those of the lables its words name, as a lable loaded into a
+    register may be jumped to. A JALR through a register is taken to go
+    to one of those or back after a JALR. The variables only the code
+    left out named then get no slot.
+*/
+
+#ifndef __OPTIMIZER__
+#define __OPTIMIZER__
+
+#include <stdint.h>
+#include "Parser.h"
+#include "Array.h"
+#include "SymbolTable.h"
+
+//The origin of a word the optimizer made or changed.
+#define NO_WORD 0xFFFFFFFF
+
+class TokenStore;
+
+/*
+	Values holds the variable, as its index in a SymbolTable, that each
+	register holds a copy of, NO_SYMBOL for none.
+*/
+typedef struct __values
+{
+	uint32_t holds[NUM_REGISTERS];
+}Values;
+
+// PRE: values is defined.
+// POST: No register holds a variable.
+void clearValues( Values &values );
+
+// PRE: values is defined, op and x are the fields of an instruction and
+//		variable is the symbol that its second param names, NO_SYMBOL if
+//		it names none.
+// POST: The RV is true if the instruction does nothing, a LW of the
+//		variable a register holds or a SW of it back. Otherwise values is
+//		moved past the instruction.
+bool stepValues( Values &values, uint32_t op, uint32_t x, uint32_t variable );
+
+class Peephole
+{
+	public:
+		// PRE: None.
+		// POST: This object is defined and no register holds a variable.
+		Peephole();
+
+		// PRE: This object and token are defined, token is an encoded
+		//		instruction that follows the ones given before.
+		// POST: The RV is false if token does nothing with what the
+		//		registers hold, so it can be left out. What the registers
+		//		hold is moved past token.
+		bool keep( const InstructionToken &token );
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of LWs keep() left out.
+		uint32_t getRemovedLoads() const { return mRemovedLoads; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of SWs keep() left out.
+		uint32_t getRemovedStores() const { return mRemovedStores; }
+	private:
+		SymbolTable mNames;//The variables seen, the index is their Values.
+		Values mValues;
+		uint32_t mRemovedLoads;
+		uint32_t mRemovedStores;
+};
+
+class Optimizer
+{
+	public:
+		// PRE: tokens holds the words of a program from address 0 whose
+		//		symbols are not collected yet.
+		// POST: This object is defined and no word is marked.
+		Optimizer( TokenStore &tokens );
+
+		// PRE: This object is defined.
+		// POST: The loads and stores that do nothing on every path to them
+		//		are marked to be removed. The RV is the number marked.
+		uint32_t forwardValues();
+
+		// PRE: This object is defined and index < the words in the store.
+		// POST: The RV is true if the word at index is marked.
+		bool removes( uint32_t index ) const { return mRemoved[index]; }
+
+		// PRE: This object is defined.
+		// POST: The marked words are dropped from the store and the rest
+		//		have the addresses 0, 4, ...
+		void removeMarked();
+
+		// PRE: This object is defined, no word is marked and roots holds
+		//		lables.
+		// POST: The words of the blocks that can not be reached from the
+		//		first word or a root are marked to be removed. A root that
+		//		is not a lable is left out. The RV is the number marked.
+		uint32_t markUnreachable( const Array<const char *> &roots );
+
+		// PRE: This object is defined and no word is marked.
+		// POST: The variables referenced most are moved into registers the
+		//		program does not use, their LW/SWs become ADDs and the
+		//		words that set the registers to 0 are put in at the start.
+		//		The rest have the addresses 0, 4, ... The RV is the number
+		//		of variables promoted.
+		uint32_t promoteVariables();
+
+		// PRE: This object is defined and index < the words in the store.
+		// POST: The RV is the index the word had when this object was
+		//		made, NO_WORD if the optimizer made or changed it.
+		uint32_t origin( uint32_t index ) const { return mOrigins[index]; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of LWs marked.
+		uint32_t getRemovedLoads() const { return mRemovedLoads; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of SWs marked.
+		uint32_t getRemovedStores() const { return mRemovedStores; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of variables promoted.
+		uint32_t getPromoted() const { return mPromoted; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of words markUnreachable() marked.
+		uint32_t getUnreachable() const { return mUnreachable; }
+	private:
+		// Disallow copying, the optimizer owns its tables.
+		Optimizer( const Optimizer & );
+		Optimizer &operator=( const Optimizer & );
+
+		TokenStore &mTokens;
+		SymbolTable mNames;//The variables, the index is their Values.
+		Array<uint32_t> mVariables;//What the LW/SW at each word names.
+		Array<bool> mRemoved;
+		Array<uint32_t> mOrigins;//See origin().
+		uint32_t mRemovedLoads;
+		uint32_t mRemovedStores;
+		uint32_t mPromoted;
+		uint32_t mUnreachable;
+};
+
+#ifdef TESTING
+// Tests that a reload after a store and a second load are left out.
+void testPeepholeRedundantLoads();
+// Tests that lables, branches and writes stop what is known.
+void testPeepholeBoundaries();
+// Tests that a program runs the same with -O and has fewer words.
+void testPeepholeProgram();
+// Tests that loads are left out across the blocks of a loop.
+void testOptimizerLoop();
+// Tests that a block entered from elsewhere or by two paths that
+// disagree keeps its loads.
+void testOptimizerJoins();
+// Tests that the programs in tests/ come out the same with -O, less
+// only the loads and stores that were removed.
+void testOptimizerEquivalence();
+// Tests which registers are free and which variables get them.
+void testOptimizerPromote();
+// Tests that a program runs the same with -O2, with fewer loads and
+// stores and less data.
+void testOptimizerPromoteProgram();
+// Tests which blocks are reached from the first word, lables and roots.
+void testOptimizerUnreachable();
+// Tests that a program runs the same with --strip, with fewer words.
+void testOptimizerStripProgram();
+// Tests that a program that calls a routine runs the same at every level.
+void testOptimizerCallProgram();
+#endif
+
+#endif
@@ -1,604 +1,1339 @@
 #include "Parser.h"
+#include "SymbolTable.h"
+#include "TokenStore.h"
+#include "SourceReader.h"
+#include "Lexer.h"
+#include "Lookup.h"
+#include "Emitter.h"
+#include "Image.h"
+#include "ThreadPool.h"
+#include "Incremental.h"
+#include "Optimizer.h"
 #include "Utilities.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string.h>
 #include <ctype.h>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <sys/resource.h>
 
 using std::cout;
 using std::endl;
 using std::fstream;
 
-// PRE: address is defined.
-// POST: The RV is a InstructionToken where in the various parts are set to there default values.
-//	 And, the address is set to "address"
-InstructionToken emptyInstructionToken( unsigned int address )
+typedef std::chrono::steady_clock Clock;
+
+// PRE: start is defined.
+// POST: The RV is the seconds from start until now.
+static double secondsSince( Clock::time_point start )
 {
-	InstructionToken retVal;
+	return std::chrono::duration<double>( Clock::now() - start ).count();
+}
 
-	for( int i = 0; i < 128; i++ )
+// PRE: None.
+// POST: The RV is the CPU seconds used so far by every thread of the
+//		process.
+static double cpuSeconds()
+{
+	return (double)std::clock() / CLOCKS_PER_SEC;
+}
+
+// PRE: param is defined.
+// POST: The RV is false if param is not a well formed constant, an
+//		optional '-' and then decimal digits or 0x and hex digits. Else
+//		value is what it reads as. A value too wide for a word stays too
+//		wide rather than wrapping as strToInt's does.
+static bool readConstant( const char *param, int64_t &value )
+{
+	const char *walker = param;
+	bool negative = *walker == '-';
+	if( negative )
+		walker++;
+	int base = 10;
+	if( walker[0] == '0' && walker[1] == 'x' )
 	{
-		retVal.original[i]  = '\0';
-		retVal.lable[i]		= '\0';
+		base = 16;
+		walker += 2;
 	}
+	if( *walker == '\0' )
+		return false;
 
-	for( int i = 0; i < 3; i++ )
-		for( int j = 0; j < 128; j++ )
-			retVal.params[i][j] = '\0';
+	value = 0;
+	for( ; *walker != '\0'; walker++ )
+	{
+		int digit;
+		if( isdigit( *walker ) )
+			digit = *walker - '0';
+		else if( base == 16 && *walker >= 'a' && *walker <= 'f' )
+			digit = *walker - 'a' + 10;
+		else if( base == 16 && *walker >= 'A' && *walker <= 'F' )
+			digit = *walker - 'A' + 10;
+		else
+			return false;
+		//Past 40 bits it is too wide whatever follows.
+		if( value < ( (int64_t)1 << 40 ) )
+			value = value * base + digit;
+	}
+	if( negative )
+		value = -value;
+	return true;
+}
 
-	retVal.instruct.instruct.binary = 0;
-	retVal.address = address;
-	retVal.instruct.type = Types::NONE;
-	retVal.hasLable = false;
-	retVal.numParams = 0;
-	return retVal;
+// PRE: param is a well formed constant, see readConstant().
+// POST: The RV is its value.
+static int64_t constantValue( const char *param )
+{
+	int64_t value = 0;
+	readConstant( param, value );
+	return value;
 }
 
-// PRE: This function has 'a' and 'b' defined.
-// POST: This will return 0 if the two symbol names are equal and nonzero 
-//		if they are not.
-int compareSymbols( ParseSymbol a, ParseSymbol b )
+// PRE: token and address are defined.
+// POST: The various parts of token are set to there default values and
+//	 the address is set to "address". Only the first char of each string
+//	 is cleared, everything reads them up to the '\0'.
+static void clearInstructionToken( InstructionToken &token, unsigned int address )
 {
-	int ret = 0;
-	if( strcmp( a.name, b.name ) != 0 )
-		ret = 1;
-	return ret;
+	token.original[0] = '\0';
+	token.lable[0] = '\0';
+	for( int i = 0; i < NUM_PARAMS; i++ )
+		token.params[i][0] = '\0';
+
+	token.instruct.instruct.binary = 0;
+	token.address = address;
+	token.instruct.type = Types::NONE;
+	token.hasLable = false;
+	token.numParams = 0;
 }
 
-Parser::Parser( char *file )
+Parser::Parser(): mWritePreProcessed( false ), mPreprocessed( false ),
+				  mOutputFormat( Formats::HEX ), mCodeWords( 0 ), mThreads( 1 ),
+				  mCollected( false ), mWritten( false ), mStream( false ),
+				  mState( 0 ), mResumeWord( 0 ), mReusedLines( 0 ), mCache( 0 ),
+				  mCached( 0 ), mKeyed( false ), mWordCount( 0 ), mErrors( 0 ), mStats( false ), mLexSummed( false ),
+				  mEncodedLines( 0 ), mExpandedLines( 0 ), mOptimize( 0 ), mPeephole( 0 ),
+				  mRemovedLoads( 0 ), mRemovedStores( 0 ), mPromoted( 0 ), mStrip( false ),
+				  mUnreachable( 0 ),
+				  mLog( &cout )
 {
-	mSymbols = new List<ParseSymbol>( compareSymbols );
-	strcpy( mFileName, file );
+	mSymbols = new SymbolTable();
+	mTokens = new TokenStore();
+	for( int i = 0; i < Phases::NUM_PHASES; i++ )
+		mPhaseSeconds[i] = mPhaseCpuSeconds[i] = 0;
+	setFileName( "" );
+}
+
+Parser::Parser( char *file ): mWritePreProcessed( false ), mPreprocessed( false ),
+							 mOutputFormat( Formats::HEX ), mCodeWords( 0 ), mThreads( 1 ),
+							 mCollected( false ), mWritten( false ), mStream( false ),
+							 mState( 0 ), mResumeWord( 0 ), mReusedLines( 0 ), mCache( 0 ),
+							 mCached( 0 ), mKeyed( false ), mWordCount( 0 ), mErrors( 0 ), mStats( false ), mLexSummed( false ),
+				  mEncodedLines( 0 ), mExpandedLines( 0 ), mOptimize( 0 ), mPeephole( 0 ),
+				  mRemovedLoads( 0 ), mRemovedStores( 0 ), mPromoted( 0 ), mStrip( false ),
+				  mUnreachable( 0 ),
+				  mLog( &cout )
+{
+	mSymbols = new SymbolTable();
+	mTokens = new TokenStore();
+	for( int i = 0; i < Phases::NUM_PHASES; i++ )
+		mPhaseSeconds[i] = mPhaseCpuSeconds[i] = 0;
+	setFileName( file );
+}
+
+// PRE: This object is defined as is file.
+// POST: mFileName is file and the names of the files made from it are set,
+//		they are kept in mArena so a name of any length fits.
+void Parser::setFileName( const char *file )
+{
+	if( strcmp( file, STREAM_FILE ) == 0 )
+	{
+		mStream = true;
+		mFileName = mPreProcessedFile = mArena.copyString( "stdin" );
+		mOutputFile = mArena.copyString( "stdout" );
+		mStateFile = 0;
+		return;
+	}
+
+	size_t length = strlen( file ) + sizeof( ".state" );
+	mFileName = mArena.copyString( file );
+	mPreProcessedFile = (char *)mArena.allocate( length, 1 );
+	mOutputFile = (char *)mArena.allocate( length, 1 );
+	mStateFile = (char *)mArena.allocate( length, 1 );
 	sprintf( mPreProcessedFile, "%s.pre", mFileName );
 	sprintf( mOutputFile, "%s.bin", mFileName );
+	sprintf( mStateFile, "%s.state", mFileName );
 }
 
-#define IS_REG( C ) ( C == '$' )
+// PRE: This object and emitter are defined.
+// POST: emitter writes to mOutputFile, or to stdout when streaming.
+//		The RV is false if mOutputFile could not be opened.
+bool Parser::openOutput( Emitter &emitter )
+{
+	if( !mStream )
+		return emitter.open( mOutputFile );
+
+	emitter.attach( 1 );
+	return true;
+}
 
 // PRE: This object is defined.
-// POST: The file that is to be parsed will be parsed and the
-//       tokens from this file will be printed in the format as descripted by printInstruction.
-void Parser::parse()
+// POST: If incremental is true then parse() keeps what it found in
+//		<file>.state and the next preprocess() only encodes the lines
+//		that changed since, see Incremental.h. The output is the same
+//		as without it. Streaming ignores this, and so does a source
+//		that can not be mapped.
+void Parser::setIncremental( bool incremental )
+{
+	if( incremental && !mStream )
+	{
+		if( mState == 0 )
+			mState = new IncrementalState();
+	}
+	else
+	{
+		delete mState;
+		mState = 0;
+	}
+}
+
+// PRE: This object is defined.
+// POST: If level is 1 or more then preprocess() leaves out the loads and
+//		stores that the expansions repeat, and from 2 it also promotes
+//		variables into free registers, see Optimizer.h. A file is then
+//		always assembled in one piece and without the state.
+void Parser::setOptimize( uint32_t level )
+{
+	mOptimize = level;
+	delete mPeephole;
+	mPeephole = level != 0 ? new Peephole() : 0;
+}
+
+// PRE: This object is defined.
+// POST: If strip is true then preprocess() leaves out the code that can
+//		not be reached from the first word or a root, and the variables
+//		only it named, see Optimizer.h. A file is then always assembled
+//		in one piece and without the state.
+void Parser::setStrip( bool strip )
+{
+	mStrip = strip;
+}
+
+// PRE: This object is defined and lable lives as long as this object.
+// POST: The code from lable on is kept by setStrip() as if it were
+//		reached.
+void Parser::addRoot( const char *lable )
 {
-	fstream tFile;
-	tFile.open( mPreProcessedFile );
+	mRoots.add( lable );
+}
+
+// PRE: This object is defined.
+// POST: parse() will write its output in format, HEX is the default.
+void Parser::setOutputFormat( Formats::Format format )
+{
+	mOutputFormat = format;
+	if( !mStream )
+		sprintf( mOutputFile, format == Formats::IMAGE ? "%s.img" : "%s.bin", mFileName );
+}
 
-	if( tFile.is_open() )
+Parser::~Parser()
+{
+	delete mSymbols;
+	delete mTokens;
+	delete mState;
+	delete mCached;
+	delete mPeephole;
+}
+
+#define IS_REG( C ) ( C == '$' )
+
+// PRE: This object is defined and preprocess() has been called.
+// POST: The symbols and fixups of every instruction in mTokens are
+//		collected, the addresses are fixed and the .bin file is written.
+void Parser::parse()
+{
+	startPhase();
+	if( mPreprocessed && mCached != 0 )
 	{
-		unsigned int PC = 0;
-		char line[256];
-		while( !tFile.eof() )
+		printCachedToFile();
+		endPhase( Phases::PRINT );
+	}
+	else if( mPreprocessed )
+	{
+		if( !mCollected )
+			collectSymbols();
+		if( mState != 0 )
 		{
-			tFile.getline( line, 256 );
-			InstructionToken token = parseLine( line, PC );
-			if( strcmp( token.original, "" ) != 0 )
+			if( !mState->write( mStateFile, *mTokens, *mSymbols, mFixups ) )
 			{
-				PC += 4;
-				mTokens.add( token );
-				addSymbol( token, PC );
+				*mLog << mStateFile << " could not be written." << endl;
+				mErrors++;
 			}
+			mState->close();
 		}
-		tFile.close();
+		endPhase( Phases::COLLECT );
+
+		startPhase();
 		fixAddresses();
-		printHexToFile();
+		endPhase( Phases::FIX );
+
+		startPhase();
+		if( mOutputFormat == Formats::IMAGE )
+			printImageToFile();
+		else
+			printHexToFile();
+		endPhase( Phases::PRINT );
+
+		mWordCount = mTokens->length();
+		if( mKeyed && mErrors == 0 && mWritten )
+			mCache->store( mCacheKey, mOutputFile, mWritePreProcessed ? mPreProcessedFile : 0,
+						   mWordCount, mCodeWords );
 	}
-	else
+}
+
+// PRE: This object is defined.
+// POST: The clocks are read for the phase that starts now.
+void Parser::startPhase()
+{
+	mPhaseStart = Clock::now();
+	mPhaseCpuStart = cpuSeconds();
+}
+
+// PRE: This object is defined and startPhase() has been called.
+// POST: The time since startPhase() is kept as the time of phase.
+void Parser::endPhase( Phases::Phase phase )
+{
+	mPhaseSeconds[phase] = secondsSince( mPhaseStart );
+	mPhaseCpuSeconds[phase] = cpuSeconds() - mPhaseCpuStart;
+}
+
+// PRE: out and text are defined.
+// POST: text is written to out as a JSON string.
+static void writeJsonString( std::ostream &out, const char *text )
+{
+	out << '"';
+	for( const char *walker = text; *walker != '\0'; walker++ )
+	{
+		if( *walker == '"' || *walker == '\\' )
+			out << '\\' << *walker;
+		else if( (unsigned char)*walker < 0x20 )
+			out << "\\u" << std::hex << std::setw( 4 ) << std::setfill( '0' ) << (int)*walker
+				<< std::dec << std::setfill( ' ' );
+		else
+			out << *walker;
+	}
+	out << '"';
+}
+
+// PRE: This object is defined and parse() has been called.
+// POST: The time of each phase, the counts of what was assembled and
+//		the peak memory of the process are written to out, as one line
+//		of JSON if json is true.
+void Parser::printStats( std::ostream &out, bool json )
+{
+	uint32_t lables = 0;
+	uint32_t variables = 0;
+	uint32_t constants = 0;
+	for( uint32_t i = 0; i < mSymbols->length(); i++ )
+	{
+		if( (*mSymbols)[i].type == Symbols::LABLE )
+			lables++;
+		else if( (*mSymbols)[i].type == Symbols::CONSTANT )
+			constants++;
+		else
+			variables++;
+	}
+
+	struct rusage usage;
+	long peakKB = getrusage( RUSAGE_SELF, &usage ) == 0 ? usage.ru_maxrss : 0;
+	uint32_t lines = mEncodedLines + mReusedLines;
+
+	if( json )
+	{
+		out << "{\"file\": ";
+		writeJsonString( out, mFileName );
+		out << ", \"cached\": " << ( mCached != 0 ? "true" : "false" ) << ", \"phases\": {";
+		for( int i = 0; i < Phases::NUM_PHASES; i++ )
+		{
+			//The lexing only has the clock it was timed by.
+			out << ( i == 0 ? "" : ", " ) << '"' << PhaseStrings[i] << "\": {";
+			if( i != Phases::LEX || !mLexSummed )
+				out << "\"wall\": " << mPhaseSeconds[i];
+			if( i != Phases::LEX )
+				out << ", ";
+			if( i != Phases::LEX || mLexSummed )
+				out << "\"cpu\": " << mPhaseCpuSeconds[i];
+			out << "}";
+		}
+		out << "}, \"lines\": " << lines << ", \"reusedLines\": " << mReusedLines
+			<< ", \"expandedLines\": " << mExpandedLines << ", \"removedLoads\": " << mRemovedLoads
+			<< ", \"removedStores\": " << mRemovedStores << ", \"promotedVariables\": " << mPromoted
+			<< ", \"unreachableWords\": " << mUnreachable
+			<< ", \"symbols\": " << mSymbols->length()
+			<< ", \"lables\": " << lables << ", \"variables\": " << variables << ", \"constants\": " << constants
+			<< ", \"fixups\": " << mFixups.length() << ", \"words\": " << mWordCount
+			<< ", \"peakRssKB\": " << peakKB << "}" << endl;
+		return;
+	}
+
+	std::ios::fmtflags flags = out.flags();
+	out << "Stats for " << mFileName << ( mCached != 0 ? " (from cache)" : "" ) << endl;
+	out << std::left << std::setw( 16 ) << "Phase" << std::right << std::setw( 12 ) << "Wall ms"
+		<< std::setw( 12 ) << "CPU ms" << endl;
+	out << std::fixed << std::setprecision( 3 );
+	for( int i = 0; i < Phases::NUM_PHASES; i++ )
 	{
-		cout << mPreProcessedFile << " could not be opened." << endl;
+		//Lexing happens inside preprocessing, so it is indented under it.
+		out << std::left << std::setw( 16 ) << ( i == Phases::LEX ? "  lex" : PhaseStrings[i] ) << std::right;
+		if( i == Phases::LEX && mLexSummed )
+			out << std::setw( 12 ) << "-";
+		else
+			out << std::setw( 12 ) << mPhaseSeconds[i] * 1000;
+		if( i == Phases::LEX && !mLexSummed )
+			out << std::setw( 12 ) << "-";
+		else
+			out << std::setw( 12 ) << mPhaseCpuSeconds[i] * 1000;
+		out << endl;
 	}
+	out.flags( flags );
+
+	out << "Input lines:    " << lines;
+	if( mReusedLines != 0 )
+		out << " (" << mReusedLines << " reused)";
+	out << endl;
+	out << "Expanded lines: " << mExpandedLines << endl;
+	if( mPeephole != 0 )
+		out << "Removed words:  " << mRemovedLoads + mRemovedStores << " (" << mRemovedLoads << " loads, "
+			<< mRemovedStores << " stores)" << endl;
+	if( mOptimize >= 2 )
+		out << "Promoted:       " << mPromoted << " variables" << endl;
+	if( mStrip )
+		out << "Unreachable:    " << mUnreachable << " words" << endl;
+	out << "Symbols:        " << mSymbols->length() << " (" << lables << " lables, "
+		<< variables << " variables";
+	if( constants != 0 )
+		out << ", " << constants << " constants";
+	out << ")" << endl;
+	out << "Fixups applied: " << mFixups.length() << endl;
+	out << "Output words:   " << mWordCount << endl;
+	out << "Peak RSS:       " << peakKB << " KB" << endl;
 }
 
-// PRE: Ths object is defined as are token and PC.
-// POST: The specific symbol in token will be added to mSymbols.
+// PRE: This object is defined and preprocess() has been called.
+// POST: The symbols and fixups of every word in mTokens are collected.
+void Parser::collectSymbols()
+{
+	uint32_t start = 0;
+	if( mState != 0 && mState->isOpen() )
+	{
+		restoreSymbols();
+		start = mResumeWord;
+	}
+
+	for( uint32_t i = start; i < mTokens->length(); i++ )
+	{
+		addSymbol( i );
+		addFixup( i );
+	}
+	mCollected = true;
+}
+
+// PRE: Ths object is defined and index < mTokens->length().
+// POST: The specific symbol in the token will be added to mSymbols.
 //		If the symbols to be added was thought to be a label, but is
 //		in fact a variable this will be changed.
-void Parser::addSymbol( InstructionToken token, uint32_t PC )
+void Parser::addSymbol( uint32_t index )
 {
-	if( token.hasLable )
+	const char *lable = mTokens->lable( index );
+	if( lable != 0 )
 	{
 		ParseSymbol symbol;
 		symbol.type = Symbols::LABLE;
-		symbol.address = PC - 4;
-		sprintf( symbol.name, "%s", token.lable );
-		Link<ParseSymbol> *t = mSymbols->addUnique( symbol );
+		symbol.address = mTokens->address( index );
+		copyString( symbol.name, lable );
+		ParseSymbol *t = mSymbols->addUnique( symbol );
 
 		if( t != 0 )
-			t->setData( symbol );
+			*t = symbol;
+
+		if( mState != 0 )
+		{
+			if( t == 0 )
+				mState->addSymbol( index );
+			mState->addLableDef( index, t == 0 ? mSymbols->length() - 1 : t - &(*mSymbols)[0] );
+		}
 	}
 
-	if( token.params[0][0] != '\0' && !IS_REG( token.params[0][0] ) && !isdigit( token.params[0][0] ) )
+	//The store only keeps the params that are not registers.
+	for( int i = 0; i < NUM_PARAMS; i++ )
 	{
-		ParseSymbol symbol;
-		symbol.type = Symbols::VARIABLE;
-		symbol.address = 0;
-		sprintf( symbol.name, "%s", token.params[0] );
-		mSymbols->addUnique( symbol );
+		const char *param = mTokens->operand( index, i );
+		if( param != 0 && !IS_CONSTANT( param ) )
+		{
+			ParseSymbol symbol;
+			symbol.type = param[0] == POOL_PREFIX ? Symbols::CONSTANT : Symbols::VARIABLE;
+			symbol.address = 0;
+			copyString( symbol.name, param );
+			if( mSymbols->addUnique( symbol ) == 0 && mState != 0 )
+				mState->addSymbol( index );
+		}
 	}
+}
 
-	if( token.params[1][0] != '\0' && !IS_REG( token.params[1][0] ) && !isdigit( token.params[1][0] ) )
+// PRE: This object is defined, index < mTokens->length() and the
+//		symbols of the token have been added to mSymbols.
+// POST: If the token is a LW/SW/BEQ whose operand names a symbol then a
+//		fixup for it is added to mFixups, as is one for an ADDI whose
+//		value names a symbol.
+void Parser::addFixup( uint32_t index )
+{
+	//Only the second param of a LW/SW and the last param of a BEQ or
+	//ADDI can hold the name of a variable or lable.
+	InstructionUnion instruct;
+	instruct.binary = mTokens->word( index );
+	Fixup fixup;
+	const char *name = 0;
+	switch( instruct.op )
 	{
-		ParseSymbol symbol;
-		symbol.type = Symbols::VARIABLE;
-		symbol.address = 0;
-		sprintf( symbol.name, "%s", token.params[1] );
-		mSymbols->addUnique( symbol );
+		case LW:
+		case SW:
+			name = mTokens->operand( index, 1 );
+			fixup.kind = Fixups::MEMORY;
+			if( instruct.op == LW && instruct.x == getRegisterCode( "$k0" ) && index + 1 < mTokens->length() )
+			{
+				InstructionUnion next;
+				next.binary = mTokens->word( index + 1 );
+				if( next.op == JALR && next.x == instruct.x )
+					fixup.kind = Fixups::CALL;
+			}
+			break;
+		case BEQ:
+			name = mTokens->operand( index, 2 );
+			fixup.kind = Fixups::BRANCH;
+			break;
+		case ADDI:
+			name = mTokens->operand( index, 2 );
+			fixup.kind = Fixups::ADDRESS;
+			break;
 	}
 
-	if( token.params[2][0] != '\0' && !IS_REG( token.params[2][0] ) && !isdigit( token.params[2][0] ) )
+	if( name != 0 && !IS_CONSTANT( name ) )
 	{
-		ParseSymbol symbol;
-		symbol.type = Symbols::VARIABLE;
-		symbol.address = 0;
-		sprintf( symbol.name, "%s", token.params[2] );
-		mSymbols->addUnique( symbol );
+		fixup.token = index;
+		fixup.symbol = mSymbols->indexOf( name );
+		mFixups.add( fixup );
 	}
 }
 
 // PRE: This object is defined, this will only be called from parse().
-// POST: The addresses in the symbol table for variables will be adjusted.
-//		And, mTokens will be updated to reflect the actual memory locations.
+// POST: The constant pool and then the variables are given words after
+//		the code and their addresses in the symbol table. And, every
+//		fixup in mFixups is patched with the actual memory location of
+//		its symbol. The LW of a call to a lable becomes an ADDI of its
+//		address.
 void Parser::fixAddresses()
 {
 	//get length of program code in words.
 	//After this length we will add the variables
 	//As we come across them.
-	uint32_t length = mTokens.length() * 4;
-	for( int i = 0; i < mSymbols->length(); i++ )
+	mCodeWords = mTokens->length();
+	uint32_t length = mCodeWords * 4;
+
+	//The constant pool comes first, each entry holds its value.
+	for( uint32_t i = 0; i < mSymbols->length(); i++ )
+	{
+		ParseSymbol &symbol = (*mSymbols)[i];
+		if( symbol.type == Symbols::CONSTANT && symbol.address == 0 )
+		{
+			symbol.address = length;
+			mTokens->addWord( (uint32_t)constantValue( symbol.name + 1 ), length );
+			length += 4;
+		}
+	}
+
+	for( uint32_t i = 0; i < mSymbols->length(); i++ )
 	{
-		ParseSymbol symbol = (*mSymbols)[i]->getData();
+		ParseSymbol &symbol = (*mSymbols)[i];
 		if( symbol.type == Symbols::VARIABLE )
 		{
 			if( symbol.address == 0 )
 			{
 				symbol.address = length;
+				mTokens->addWord( 0, length );
 				length += 4;
-				(*mSymbols)[i]->setData( symbol );
-				InstructionToken zero;
-				zero.instruct.instruct.binary = 0;
-				mTokens.add( zero );
 			}
 		}
 	}
 	
-	for( int i = 0; i < mSymbols->length(); i++ )
+	for( uint32_t i = 0; i < mFixups.length(); i++ )
 	{
-		ParseSymbol symbol =  (*mSymbols)[i]->getData();
-		for( int j = 0; j < mTokens.length(); j++ )
-		{
-			//check if any of the params match the variable or lable and insert the address there
-			//if applicable, since the label/variable can only happen
-			//in the second or last portion of the instruction.
-			Link<InstructionToken> *token= mTokens[j];
-			InstructionToken tok = token->getData();
+		Fixup &fixup = mFixups[i];
+		ParseSymbol &symbol = (*mSymbols)[fixup.symbol];
+		InstructionUnion instruct;
+		instruct.binary = mTokens->word( fixup.token );
 
-			switch( token->getData().instruct.instruct.op )
-			{
-				case LW:
-				case SW:
-					if( strcmp( tok.params[1], symbol.name ) == 0 )
-					{
-						tok.instruct.instruct.y = getRegisterCode( "$fp" );
-						tok.instruct.instruct.value = symbol.address;
-					}
-					break;
-				case BEQ:
-					if( strcmp( tok.params[2], symbol.name ) == 0 )
-					{
-						int offset = symbol.address - tok.address - 4;
-						tok.instruct.instruct.value = offset;
-					}
+		switch( fixup.kind )
+		{
+			case Fixups::MEMORY:
+				instruct.y = getRegisterCode( "$fp" );
+				instruct.value = symbol.address;
+				break;
+			case Fixups::BRANCH:
+				instruct.value = symbol.address - mTokens->address( fixup.token ) - 4;
+				break;
+			case Fixups::CALL:
+				//A call to a variable jumps to the address it holds, one
+				//to a lable jumps to the lable, so its address is put in
+				//$k0 instead of the word there.
+				if( symbol.type != Symbols::LABLE )
+				{
+					instruct.y = getRegisterCode( "$fp" );
+					instruct.value = symbol.address;
 					break;
-			}
-
-			token->setData( tok );
+				}
+				instruct.op = ADDI;
+				instruct.y = getRegisterCode( "$zero" );
+				//Fall through.
+			case Fixups::ADDRESS:
+				if( symbol.address > MAX_IMMEDIATE )
+				{
+					*mLog << "The address of " << symbol.name << " does not fit in an addi." << endl;
+					mErrors++;
+				}
+				instruct.value = symbol.address;
+				break;
 		}
-	}
-
 
+		mTokens->word( fixup.token ) = instruct.binary;
+	}
 }
 
 // PRE: This object is defined.
 // POST: The file that was passed to the parser will have been
 //		preprocessed.  Which will mean that the nessecary 
 //		substitution and instruction expansions will have taken
-//		place and they will be output to a file with .pre
-//		appended to the original file name.
+//		place and the resulting instructions are encoded into mTokens.
+//		If the .pre output is turned on they are also written to a
+//		file with .pre appended to the original file name.
 void Parser::preprocess()
 {
+	startPhase();
 	fstream tFileOut;
-	fstream tFile;
-	tFile.open( mFileName );
-	tFileOut.open( mPreProcessedFile, fstream::out | fstream::trunc );
+	SourceReader tFile;
+	if( mWritePreProcessed && !mStream )
+	{
+		tFileOut.open( mPreProcessedFile, fstream::out | fstream::trunc );
+		if( !tFileOut.is_open() )
+		{
+			*mLog << mPreProcessedFile << " could not be opened." << endl;
+			mErrors++;
+		}
+	}
+
+	if( mStream )
+		tFile.attach( 0 );
 
-	if( tFile.is_open() && tFileOut.is_open() )
+	if( mStream || tFile.open( mFileName ) )
 	{
-		char line[256];
-		while( !tFile.eof() )
+		std::ostream *pre = tFileOut.is_open() ? &tFileOut : 0;
+		if( mState != 0 && ( !tFile.isMapped() || optimizing() ) )
 		{
-			tFile.getline( line, 256 );
-			List<char *> list;
-			preprocessLine( &list, line );
+			//Only a mapped source can be compared with the state, and
+			//what the optimizer leaves out of a line depends on the lines
+			//before it.
+			delete mState;
+			mState = 0;
+		}
 
-			for( int i = 0; i < list.length(); i++ )
-				tFileOut << list[i]->getData() << endl;
+		//The roots are not part of the key, so with them the cache is not
+		//used.
+		if( mCache != 0 && mRoots.length() == 0 && tFile.isMapped() && fetchCached( tFile.contents(), pre ) )
+		{
+			//parse() copies the output out of the cache.
+		}
+		else if( mState != 0 )
+		{
+			preprocessIncremental( tFile.contents(), pre );
+		}
+		else if( mThreads != 1 && !optimizing() && tFile.isMapped() && tFile.contents().length() >= 2 * PARALLEL_CHUNK )
+		{
+			preprocessParallel( tFile.contents(), pre );
 		}
+		else
+		{
+			Array<InstructionToken> tokens;
+			std::string_view line;
+			uint32_t PC = 0;
+			while( tFile.nextLine( line ) )
+				encodeLine( line, tokens, PC, pre );
+			if( optimizing() )
+				optimize( pre );
+		}
+		mPreprocessed = true;
+	}
+	else
+	{
+		*mLog << mFileName << " could not be opened." << endl;
+		mErrors++;
 	}
+	endPhase( Phases::PREPROCESS );
 }
 
-// PRE: This object is defined.
-// POST: The mTokens list will be printed in HEX to mFileOutput.
-//		Where each line contains one word.
-void Parser::printHexToFile()
+// PRE: This object is defined and fixAddresses() has been called.
+// POST: The mTokens words are written to mOutputFile as a packed
+//		image, see Image.h.
+void Parser::printImageToFile()
 {
-	fstream tFile;
-	tFile.open( mOutputFile, fstream::out | fstream::trunc );
-
-	if( tFile.is_open() )
+	Emitter tFile;
+	if( openOutput( tFile ) )
 	{
-		for( int i = 0; i < mTokens.length(); i++ )
+		writeImage( tFile, mTokens->words(), mTokens->length(), mCodeWords, 0 );
+		mWritten = tFile.close();
+		if( !mWritten )
 		{
-			char line[LINE];
+			*mLog << mOutputFile << " could not be written." << endl;
+			mErrors++;
+		}
+	}
+	else
+	{
+		*mLog << mOutputFile << " could not be opened." << endl;
+		mErrors++;
+	}
+}
+
+// PRE: This object is defined, tokens is scratch space and PC is the
+//		address of the next word.
+// POST: The instructions line expands to are encoded and added to
+//		mTokens and PC is moved past them, less the ones the optimizer
+//		leaves out. If pre is not 0 their text is written to it.
+void Parser::encodeLine( std::string_view line, Array<InstructionToken> &tokens,
+						 uint32_t &PC, std::ostream *pre )
+{
+	tokens.clear();
+	preprocessLine( tokens, line );
+	mEncodedLines++;
+	mExpandedLines += tokens.length();
 
-			sprintf( line, "%08X\n", mTokens[i]->getData().instruct.instruct.binary );
+	char text[FORMAT_LINE];
+	for( uint32_t i = 0; i < tokens.length(); i++ )
+	{
+		if( mPeephole != 0 && !mPeephole->keep( tokens[i] ) )
+			continue;
+
+		tokens[i].address = PC;
+		mTokens->add( tokens[i] );
+		PC += 4;
 
-			tFile << line;
+		if( pre != 0 )
+		{
+			formatToken( tokens[i], text );
+			//The optimizer may still remove the word.
+			if( optimizing() )
+				mPreLines.add( mArena.copyString( text ) );
+			else
+				*pre << text << '\n';
 		}
 	}
 }
 
-// PRE: This object and line is defined. 
-// POST: The instruction is returned. If there is an error then the parse sets the proper error messaage and enters a error state.
-//			This error state will halt parsing.
-InstructionToken Parser::parseLine( char *line, unsigned int address)
+// PRE: This object is defined, every line has been encoded into mTokens
+//		by encodeLine and optimizing() is true.
+// POST: With setStrip() the code that can not be reached is removed from
+//		mTokens, then the loads and stores that do nothing on every path
+//		to them are and at level 2 variables are promoted, see
+//		Optimizer.h. If pre is not 0 the text of the words that are left
+//		is written to it.
+void Parser::optimize( std::ostream *pre )
 {
-	ParseStates::ParseState state = ParseStates::START;
-	Opcode op = NONE;
-	unsigned int charPos = 0;
-	InstructionToken retVal = emptyInstructionToken( address );
+	Optimizer optimizer( *mTokens );
+	if( mStrip )
+	{
+		optimizer.markUnreachable( mRoots );
+		optimizer.removeMarked();
+	}
+	if( mPeephole != 0 )
+	{
+		optimizer.forwardValues();
+		optimizer.removeMarked();
+		mRemovedLoads = mPeephole->getRemovedLoads() + optimizer.getRemovedLoads();
+		mRemovedStores = mPeephole->getRemovedStores() + optimizer.getRemovedStores();
+	}
+	if( mOptimize >= 2 )
+		optimizer.promoteVariables();
+	mPromoted = optimizer.getPromoted();
+	mUnreachable = optimizer.getUnreachable();
 
-	while( state != ParseStates::HALT && charPos < strlen( line ) && ( line[charPos] != '\r' || line[charPos] == '\n' ) && line[charPos] != ';' )
+	if( pre != 0 )
 	{
-		char c = line[charPos];
-		retVal.original[charPos] = c;
-		switch( state )
+		char text[FORMAT_LINE];
+		for( uint32_t i = 0; i < mTokens->length(); i++ )
 		{
-			case ParseStates::START:
-				getState( c, state );
-				break;
-			case ParseStates::WHITESPACE:
-				if( iswhitespace( c ) )
-					charPos++;
-				else
-					state = ParseStates::START;
-				break;
-			case ParseStates::ALPHA:
-				if( iswhitespace( c ) )
-					state = ParseStates::PARAMS;
-				else
-					parseOpcodeLabel( c, op, state, retVal );
+			uint32_t origin = optimizer.origin( i );
+			if( origin != NO_WORD )
+				*pre << mPreLines[origin] << '\n';
+			else
+			{
+				formatWord( i, text );
+				*pre << text << '\n';
+			}
+		}
+	}
+	mPreLines.clear();
+}
 
-				charPos++;
-				break;
-			case ParseStates::COMMENT:
-				retVal.instruct.type = Types::COMMENT;
-				if( c == '\r' || c == '\n' )
-					state = ParseStates::HALT;
-				else
-					charPos++;
-				break;
-			case ParseStates::PARAMS:
-				parseParams( c, op, state, retVal );
-				charPos++;
-				break;
+// PRE: This object is defined, index < the words in mTokens and line
+//		holds FORMAT_LINE chars.
+// POST: line is the text of the word at index, from its fields as the
+//		optimizer made it.
+void Parser::formatWord( uint32_t index, char *line )
+{
+	char *walker = line;
+	const char *lable = mTokens->lable( index );
+	if( lable != 0 )
+		walker += sprintf( walker, "%s: ", lable );
+
+	InstructionUnion instruct;
+	instruct.binary = mTokens->word( index );
+	walker += sprintf( walker, "%s", GetOpCodeString( instruct.op ) );
+	switch( instruct.op )
+	{
+		case ADD:
+		case NAND:
+			sprintf( walker, " %s, %s, %s", RegisterStrings[instruct.x], RegisterStrings[instruct.y],
+					 RegisterStrings[instruct.z] );
+			break;
+		case ADDI:
+			sprintf( walker, " %s, %s, %d", RegisterStrings[instruct.x], RegisterStrings[instruct.y],
+					 (int)instruct.value );
+			break;
+		case LW:
+		case SW:
+			sprintf( walker, " %s, %d(%s)", RegisterStrings[instruct.x], (int)instruct.value,
+					 RegisterStrings[instruct.y] );
+			break;
+		case IN:
+		case OUT:
+			sprintf( walker, " %s", RegisterStrings[instruct.x] );
+			break;
+	}
+}
 
-		}
+// PRE: This object is defined and text holds whole lines.
+// POST: Every line of text is encoded into mTokens starting at
+//		address 0. If pre is not 0 their text is written to it.
+void Parser::preprocessText( std::string_view text, std::ostream *pre )
+{
+	Array<InstructionToken> tokens;
+	uint32_t PC = 0;
+	size_t position = 0;
+	while( position < text.length() )
+	{
+		size_t newline = text.find( '\n', position );
+		if( newline == std::string_view::npos )
+			newline = text.length();
+		encodeLine( text.substr( position, newline - position ), tokens, PC, pre );
+		position = newline + 1;
 	}
+}
 
-	retVal.instruct.instruct.op = op;
+// PRE: This object is defined, mCache is not 0 and text is the
+//		whole source.
+// POST: mCacheKey is the key of text. If it is in the cache then
+//		mCached holds the entry and the .pre is written to pre when
+//		it is not 0, the RV is true.
+bool Parser::fetchCached( std::string_view text, std::ostream *pre )
+{
+	mCacheKey = makeCacheKey( text, mOutputFormat | ( mWritePreProcessed ? 0x100 : 0 ) |
+							 ( mOptimize << 9 ) | ( mStrip ? 0x800 : 0 ) );
+	mKeyed = true;
 
-	finalizeToken( retVal );
+	CacheEntry *entry = new CacheEntry();
+	if( !mCache->fetch( mCacheKey, *entry ) )
+	{
+		delete entry;
+		return false;
+	}
 
-	return retVal;
+	mCached = entry;
+	mCodeWords = entry->header().codeWords;
+	mWordCount = entry->header().words;
+	if( pre != 0 )
+		pre->write( entry->preprocessed().data(), entry->preprocessed().length() );
+	return true;
 }
 
-// PRE: This object is defined. The current char c and the current state are both defined.
-// POST: The next parse state will be in state.
-void Parser::getState( char c, ParseStates::ParseState &state )
+// PRE: This object is defined and mCached holds an entry.
+// POST: The output file of the entry is written to mOutputFile.
+void Parser::printCachedToFile()
 {
-	if( iswhitespace( c ) )
-		state = ParseStates::WHITESPACE;
-	else if( isalpha( c ) )
-		state = ParseStates::ALPHA;
-	else if( c == ';' )
-		state = ParseStates::COMMENT;
+	Emitter tFile;
+	if( openOutput( tFile ) )
+	{
+		tFile.writeBytes( mCached->output().data(), mCached->output().length() );
+		mWritten = tFile.close();
+		if( !mWritten )
+		{
+			*mLog << mOutputFile << " could not be written." << endl;
+			mErrors++;
+		}
+	}
+	else
+	{
+		*mLog << mOutputFile << " could not be opened." << endl;
+		mErrors++;
+	}
 }
 
-// PRE: This object is defined and instruct is defined.
-// POST: The OS will have the contents of the instruction printed in the following format.
-//		If the type is a comment then just Comment is printed on a single line.
-//		If the type is Label then the following format is followed:
-//			<original line>
-//			Label: <label name> at address <address>
-//		If the type is a instruction then the following format is followed:
-//		R-type
-//			<original line>
-//			Opcode: <opcode in binary>, Reg. X: <binary of reg X>, Reg Y: <binary of reg Y>, Reg. Z: <binary of reg Z>
-//		L-type
-//			<original line>
-//			Opcode: <opcode in binary>, Reg. X: <binary of reg X>, Reg. Y: <binary of reg Y>, Offset: <decimal of value>
-//		J-type
-//			<original line>
-//			Opcode: <opcode in binary>, Reg. X: <binary of reg X>, Variable: <variable name>
-void Parser::printInstruction( InstructionToken token )
+// PRE: This object is defined, mState is not 0 and text is the
+//		whole source.
+// POST: The lines of text that match the start and end of the last
+//		state are taken from it and the rest are encoded, so mTokens
+//		is the same as after the sequential path. Every line is
+//		recorded in mState. If pre is not 0 the state is not used
+//		so that every line is written to it.
+void Parser::preprocessIncremental( std::string_view text, std::ostream *pre )
 {
-	if( token.instruct.type != Types::COMMENT )
+	IncrementalState &state = *mState;
+	if( pre != 0 || !state.open( mStateFile ) ||
+		state.header().deadBytes > state.header().stringBytes / 2 )
 	{
-		InstructionUnion instruct = token.instruct.instruct;
-		cout << token.original << endl;
-		if( token.hasLable )
-			cout << "Lable: " << token.lable << " at address " << token.address << endl;
-		cout << "Opcode: "; printBinary( instruct.op );
-		cout << ", Reg. X: "; printBinary( instruct.x );
-		switch( instruct.op )
+		//Start over when most of the strings kept are no longer used.
+		state.close();
+	}
+	uint32_t oldLines = state.isOpen() ? state.header().lines : 0;
+
+	//Hash every line and find the first one that is not in the state.
+	Array<uint64_t> hashes;
+	uint32_t first = 0;
+	size_t changed = text.length();//Where line first starts.
+	bool same = true;
+	size_t position = 0;
+	while( position < text.length() )
+	{
+		size_t newline = text.find( '\n', position );
+		if( newline == std::string_view::npos )
+			newline = text.length();
+		uint64_t hash = hashLine( text.substr( position, newline - position ) );
+		if( same && ( hashes.length() == oldLines || state.hashes()[hashes.length()] != hash ) )
 		{
-			case ADD: case NAND:
-				cout << ", Reg. Y: "; printBinary( instruct.y );
-				cout << ", Reg. Z: "; printBinary( instruct.z );
-				break;
-			case ADDI:
-				cout << ", Reg. Y: "; printBinary( instruct.y );
-				cout << ", Offset: "; printBinary( instruct.value );
-				break;
-			case BEQ:
-				cout << ", Reg. Y: "; printBinary( instruct.y );
-				cout << ", Offset";
-				if( isalpha( token.params[2][0] ) )
-					cout << " lable: " << token.params[2];
-				else
-					cout << ": "; printBinary( instruct.value );
-				break;
-			case LW: case SW:
-				if( token.numParams == 2 )
-				{
-					cout << ", Reg. Y: "; printBinary( instruct.y );
-					cout << ", Offset: " << instruct.value;
-				}
-				else
-					cout << ", Variable: " << token.params[1];
-				break;
-			case JALR:
-				cout << ", Reg. Y: "; printBinary( instruct.y );
-				break;
-			case HALT: break;
+			same = false;
+			first = hashes.length();
+			changed = position;
 		}
-		cout << endl;
+		hashes.add( hash );
+		position = newline + 1;
+	}
+	uint32_t lines = hashes.length();
+	if( same )
+		first = lines;
+
+	//Then the lines that match at the end.
+	uint32_t last = 0;
+	while( first + last < lines && first + last < oldLines &&
+		   hashes[lines - 1 - last] == state.hashes()[oldLines - 1 - last] )
+		last++;
+
+	uint32_t firstWord = first == 0 ? 0 : state.lineWords()[first - 1];
+	if( state.isOpen() )
+	{
+		mTokens->addStrings( state.strings(), state.header().stringBytes );
+		mTokens->appendWords( state.words(), state.lables(), state.operands(), firstWord, 0 );
+		for( uint32_t i = 0; i < first; i++ )
+			state.addLine( hashes[i], state.lineWords()[i] );
+	}
+
+	//A line that reports a problem is kept with a hash of 0 so that it is
+	//never taken from the state and is reported again next time.
+	Array<InstructionToken> tokens;
+	uint32_t PC = firstWord * 4;
+	position = changed;
+	for( uint32_t i = first; i < lines - last; i++ )
+	{
+		size_t newline = text.find( '\n', position );
+		if( newline == std::string_view::npos )
+			newline = text.length();
+		uint32_t errors = mErrors;
+		encodeLine( text.substr( position, newline - position ), tokens, PC, pre );
+		state.addLine( mErrors == errors ? hashes[i] : 0, PC / 4 );
+		position = newline + 1;
+	}
+
+	if( state.isOpen() )
+	{
+		const StateHeader &header = state.header();
+		uint32_t oldEnd = oldLines - last == 0 ? 0 : state.lineWords()[oldLines - last - 1];
+		uint32_t base = PC / 4;
+		mTokens->appendWords( state.words() + oldEnd, state.lables() + oldEnd,
+							  state.operands() + oldEnd * NUM_PARAMS, header.words - oldEnd, PC );
+		for( uint32_t i = oldLines - last; i < oldLines; i++ )
+			state.addLine( state.hashes()[i], state.lineWords()[i] - oldEnd + base );
+
+		//The strings of the words that were replaced stay in the store.
+		uint32_t dead = header.deadBytes;
+		for( uint32_t i = firstWord; i < oldEnd; i++ )
+		{
+			if( state.lables()[i] != NO_STRING )
+				dead += strlen( state.strings() + state.lables()[i] ) + 1;
+			for( int j = 0; j < NUM_PARAMS; j++ )
+			{
+				uint32_t offset = state.operands()[i * NUM_PARAMS + j];
+				if( offset != NO_STRING )
+					dead += strlen( state.strings() + offset ) + 1;
+			}
+		}
+		state.addDeadBytes( dead );
+		mReusedLines = first + last;
 	}
+	mResumeWord = firstWord;
 }
 
-// PRE: This object is defined and as is value.
-// POST: The OS will have the binary representation of value.
-void Parser::printBinary( unsigned int value )
+// PRE: This object is defined, mState has the last state open and
+//		its words up to mResumeWord are in mTokens.
+// POST: mSymbols, mFixups and mState hold what collecting the
+//		words before mResumeWord gives, without looking at them.
+void Parser::restoreSymbols()
 {
-	unsigned int i;
-	i = 1<<3;
+	IncrementalState &state = *mState;
+	const StateHeader &header = state.header();
+
+	//The symbols are in the order they were first seen, each starts out
+	//as a variable or constant until a lable before mResumeWord gives it
+	//an address.
+	const char *name = state.names();
+	ParseSymbol symbol;
+	symbol.address = 0;
+	for( uint32_t i = 0; i < header.symbols && state.symbolWords()[i] < mResumeWord; i++ )
+	{
+		symbol.type = name[0] == POOL_PREFIX ? Symbols::CONSTANT : Symbols::VARIABLE;
+		copyString( symbol.name, name );
+		name += strlen( name ) + 1;
+		mSymbols->addUnique( symbol, state.symbolHashes()[i] );
+		state.addSymbol( state.symbolWords()[i] );
+	}
 
-	while (i > 0) {
-		if (value & i)
-			cout << "1";
-		else
-			cout << "0";
-		i >>= 1;
+	for( uint32_t i = 0; i < header.lableDefs && state.lableDefs()[i].word < mResumeWord; i++ )
+	{
+		const LableDef &def = state.lableDefs()[i];
+		ParseSymbol &lable = (*mSymbols)[def.symbol];
+		lable.type = Symbols::LABLE;
+		lable.address = mTokens->address( def.word );
+		state.addLableDef( def.word, def.symbol );
 	}
+
+	for( uint32_t i = 0; i < header.fixups && state.fixups()[i].token < mResumeWord; i++ )
+		mFixups.add( state.fixups()[i] );
 }
 
-// PRE: This object is defined and c is defined as a alpha character.
-// POST: The RV is the Opcode value of the suspected op code.
-Opcode Parser::getOpcode( char c )
+/*
+	Chunk is one piece of the source when assembling in parallel, with the
+	parser that assembles it and what it would have printed.
+*/
+typedef struct __chunk
+{
+	std::string_view text;
+	Parser parser;
+	std::ostringstream log;
+	std::ostringstream pre;
+	bool writePre;
+}Chunk;
+
+// PRE: This object is defined and text is the whole source.
+// POST: text is split into chunks of whole lines that are encoded
+//		and have their symbols collected on a ThreadPool. The chunks
+//		are merged into this parser in order, so mTokens, mSymbols
+//		and mFixups are the same as after the sequential path.
+void Parser::preprocessParallel( std::string_view text, std::ostream *pre )
 {
-	Opcode op = NONE;
-	if( c == 'a' )
-		op = ADD;
-	else if( c == 'n' )
-		op = NAND;
-	else if( c == 'l' )
-		op = LW;
-	else if( c == 's' )
-		op = SW;
-	else if( c == 'b' )
-		op = BEQ;
-	else if( c == 'j' )
-		op = JALR;
-	else if( c == 'h' )
-		op = HALT;
-	else if( c == 'i' )
-		op = IN;
-	else if( c == 'o' )
-		op = OUT;
-	return op;
+	ThreadPool pool( mThreads );
+	uint32_t numChunks = pool.threads() * CHUNKS_PER_THREAD;
+	if( text.length() / numChunks < PARALLEL_CHUNK )
+		numChunks = text.length() / PARALLEL_CHUNK;
+	if( numChunks == 0 )
+		numChunks = 1;
+
+	Chunk *chunks = new Chunk[numChunks];
+	size_t start = 0;
+	for( uint32_t i = 0; i < numChunks; i++ )
+	{
+		//Each chunk ends on the first line break after its share.
+		size_t end = text.length();
+		if( i + 1 < numChunks )
+		{
+			end = text.length() / numChunks * ( i + 1 );
+			if( end < start )
+				end = start;
+			end = text.find( '\n', end );
+			end = end == std::string_view::npos ? text.length() : end + 1;
+		}
+
+		chunks[i].text = text.substr( start, end - start );
+		chunks[i].writePre = pre != 0;
+		chunks[i].parser.mStats = mStats;
+		start = end;
+	}
+
+	pool.run( numChunks, assembleChunk, chunks );
+	mLexSummed = true;
+
+	for( uint32_t i = 0; i < numChunks; i++ )
+	{
+		*mLog << chunks[i].log.str();
+		mErrors += chunks[i].parser.mErrors;
+		mEncodedLines += chunks[i].parser.mEncodedLines;
+		mExpandedLines += chunks[i].parser.mExpandedLines;
+		//The chunks lex at the same time, so their sum is only CPU time.
+		mPhaseCpuSeconds[Phases::LEX] += chunks[i].parser.mPhaseSeconds[Phases::LEX];
+		if( pre != 0 )
+			*pre << chunks[i].pre.str();
+		mergeChunk( chunks[i].parser );
+	}
+
+	delete [] chunks;
+	mCollected = true;
 }
 
-// PRE: This object is defined. This will parse out the opcode and if need also the label.
-// POST: The contents of token will be updated to reflect the opcode mnumonic and or if there is a lable also
-//		 update this value as well.
-void Parser::parseOpcodeLabel( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: context is the array of chunks given to preprocessParallel.
+// POST: The chunk at index is encoded and its symbols collected.
+void Parser::assembleChunk( uint32_t index, void *context )
 {
-	parseLable( c, op, state, token );
-	parseOpcode( c, op, state, token );
+	Chunk &chunk = ( (Chunk *)context )[index];
+	chunk.parser.mLog = &chunk.log;
+	chunk.parser.preprocessText( chunk.text, chunk.writePre ? &chunk.pre : 0 );
+	chunk.parser.collectSymbols();
 }
 
-// PRE: This object, c, op, state, and token are defined.
-// POST: The proper action based on the current op will be performed and state and token will have the
-//		 nesscary changes made to them.
-void Parser::parseOpcode( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: This object and chunk are defined, chunk has collected its
+//		symbols and follows the words already in mTokens.
+// POST: The words of chunk are appended with their addresses moved
+//		past the words already here. The symbols of chunk are added as
+//		addSymbol would have, and its fixups are moved onto the merged
+//		tokens and symbols.
+void Parser::mergeChunk( Parser &chunk )
 {
-	switch( op )
+	uint32_t tokenBase = mTokens->length();
+	mTokens->append( *chunk.mTokens, tokenBase * 4 );
+
+	//A chunk only holds the first sighting of each name, and a lable
+	//holds the last address it was given in the chunk, so adding them in
+	//chunk order keeps the discovery order and the lable overrides.
+	Array<uint32_t> remap;
+	remap.resize( chunk.mSymbols->length() );
+	for( uint32_t i = 0; i < chunk.mSymbols->length(); i++ )
 	{
-		case NONE:
-			op = getOpcode( c );
-			break;
-		case ADD:
-			parseADD( c, op, state, token );
-			break;
-		case ADDI:
-			//This state is handled by ADD automatically. It is here for completeness.
-			break;
-		case SW:
-		case LW:
-			parseLW( c, op, state, token );
-			break;
-		case BEQ:
-			parseBEQ( c, op, state, token );
-			break;
-		case IN:
-			parseIN( c, op, state, token );
-			break;
-		case OUT:
-			parseOUT( c, op, state, token );
+		ParseSymbol symbol = (*chunk.mSymbols)[i];
+		if( symbol.type == Symbols::LABLE )
+			symbol.address += tokenBase * 4;
+
+		ParseSymbol *t = mSymbols->addUnique( symbol );
+		if( t != 0 && symbol.type == Symbols::LABLE )
+			*t = symbol;
+		remap[i] = mSymbols->indexOf( symbol.name );
+	}
+
+	for( uint32_t i = 0; i < chunk.mFixups.length(); i++ )
+	{
+		Fixup fixup = chunk.mFixups[i];
+		fixup.token += tokenBase;
+		fixup.symbol = remap[fixup.symbol];
+		mFixups.add( fixup );
 	}
 }
 
-// PRE: this object, c, op, state, and token are defined.
-// POST: If c is a : then the proper values are changed in token and state to reflect this.  Token
-//		 also gets a copy of the lable value for later recall.
-void Parser::parseLable( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: This object is defined.
+// POST: The mTokens words will be printed in HEX to mFileOutput.
+//		Where each line contains one word.
+void Parser::printHexToFile()
 {
-	if( c == ':' )
+	Emitter tFile;
+	if( openOutput( tFile ) )
 	{
-		op = NONE;
-		state = ParseStates::LABLE;
-		token.hasLable = true;
-		int length = strlen( token.original );
-		int lablePos = 0;
-		for( int i = 0; i < length; i++ )
+		tFile.writeHex( mTokens->words(), mTokens->length() );
+		mWritten = tFile.close();
+		if( !mWritten )
 		{
-			if( iswhitespace( token.original[i] ) )
-				continue;
-			else
-				token.lable[lablePos++] = token.original[i];
+			*mLog << mOutputFile << " could not be written." << endl;
+			mErrors++;
 		}
-		token.lable[lablePos - 1] = '\0';
-		state = ParseStates::START;
+	}
+	else
+	{
+		*mLog << mOutputFile << " could not be opened." << endl;
+		mErrors++;
 	}
 }
 
-// PRE: This object is defined as are c, op, state, token. 
-// POST: Giving the op the proper parsing function is called to parse the correct params. There are four
-//		 different functions that can be called.
-//		 Three Register opcodes.
-//		 Two register and Value opcodes.
-//		 One register and a offset of a register opcode..
-//		 Two register opcodes.
-//		 No register or params and thus require no parsing.
-void Parser::parseParams( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: This object and line is defined. 
+// POST: The instruction is returned. If there is an error then the parse sets the proper error messaage and enters a error state.
+//			This error state will halt parsing.
+InstructionToken Parser::parseLine( std::string_view line, unsigned int address)
 {
-	switch( op )
-	{
-		case ADD: case NAND:
-			parseThreeRegisterParams( c, op, state, token );
-			break;
-		case ADDI: case BEQ:
-			parseTwoRegisterValueParams( c, op, state, token );
-			break;
-		case LW: case SW:
-			parseOneRegisterOffsetRegister( c, op, state, token );
-			break;
-		case JALR:
-			parseTwoRegisterParams( c, op, state, token );
-			break;
-		case IN:
-		case OUT:
-			parseSingleRegisterParams( c, op, state, token );
-		case HALT:
-			break;
-	}
+	InstructionToken retVal;
+	parseLine( line, address, retVal );
+	return retVal;
 }
 
-// PRE: This object is defined and c, op, state, and token are also defined.
-// POST: The continuation or starting of the parse iff op = ADD | NAND. The values in token and state 
-//		 will be reflected accordingly.
-void Parser::parseThreeRegisterParams( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: This object, line and token are defined.
+// POST: token is overwritten with line parsed at address, as
+//		parseLine() above returns it, without building a copy.
+void Parser::parseLine( std::string_view line, uint32_t address, InstructionToken &retVal )
 {
-	//counting starts at 0 and there is a max of 3 registers.
-	if( token.numParams > 2 )
+	clearInstructionToken( retVal, address );
+	LexedLine lexed;
+	if( mStats )
 	{
-		state = ParseStates::START;
-	}//first param
-	else if( c == ',' || c == '\r' || c == '\n' )
+		Clock::time_point start = Clock::now();
+		lexLine( line, lexed );
+		mPhaseSeconds[Phases::LEX] += secondsSince( start );
+	}
+	else
+		lexLine( line, lexed );
+
+	copyString( retVal.original, line.substr( 0, lexed.length ) );
+
+	//A name is kept in LINE chars, cutting it could make two names one.
+	for( int i = -1; i < NUM_PARAMS; i++ )
 	{
-		token.numParams++;
+		std::string_view name = i < 0 ? lexed.lable : lexed.operands[i];
+		if( name.length() >= LINE )
+		{
+			*mLog << "Name too long " << name << " in: " << retVal.original << endl;
+			mErrors++;
+			retVal.instruct.type = Types::NONE;
+			return;
+		}
 	}
-	else if( !iswhitespace( c ) )//lets just add each register string to there respective array.
-		token.params[token.numParams][strlen( token.params[token.numParams] )] = c;
-}
 
-// PRE: This object is defined and c, op, state, and token are also defined.
-// POST: The continuation or starting of the parse iff op = ADDI | BEQ.
-void Parser::parseTwoRegisterValueParams( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
-{
-	//counting starts at 0 and there is a max of 3 registers.
-	if( token.numParams > 2 )
+	if( lexed.hasLable )
 	{
-		state = ParseStates::START;
-	}//first param
-	else if( c == ',' || c == '\r' || c == '\n' )
+		retVal.hasLable = true;
+		copyString( retVal.lable, lexed.lable );
+	}
+
+	for( int i = 0; i < NUM_PARAMS; i++ )
+		copyString( retVal.params[i], lexed.operands[i] );
+	retVal.numParams = lexed.numOperands;
+
+	if( lexed.isComment )
+		retVal.instruct.type = Types::COMMENT;
+
+	retVal.instruct.instruct.op = lookupOpcode( lexed.mnemonic );
+	if( retVal.instruct.instruct.op == NONE && !lexed.mnemonic.empty() )
 	{
-		token.numParams++;
+		*mLog << "Unknown instruction " << lexed.mnemonic << " in: " << retVal.original << endl;
+		mErrors++;
+		retVal.instruct.type = Types::NONE;
+		return;
 	}
-	else if( !iswhitespace( c ) )//lets just add each register string to there respective array.
-		token.params[token.numParams][strlen( token.params[token.numParams] )] = c;
-}
 
-// PRE: This object is defined and c, op, state, and token are also defined.
-// POST: The continuation or starting of the parse iff op = LW | SW. The values in token and state 
-//		 will be reflected accordingly.
-void Parser::parseOneRegisterOffsetRegister( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( token.numParams > 2 )
+	if( lexed.tooManyOperands )
 	{
-		state = ParseStates::START;
+		*mLog << "Too many operands in: " << retVal.original << endl;
+		mErrors++;
+		retVal.instruct.type = Types::NONE;
+		return;
 	}
-	else if( c == ',' || c == '(' || c == '\r' || c == '\n' )
+
+	//A param that starts as a number has to be one all the way.
+	int64_t value;
+	for( int i = 0; i < NUM_PARAMS; i++ )
 	{
-		token.numParams++;
+		if( IS_CONSTANT( retVal.params[i] ) && !readConstant( retVal.params[i], value ) )
+		{
+			*mLog << "Bad constant " << retVal.params[i] << " in: " << retVal.original << endl;
+			mErrors++;
+			retVal.instruct.type = Types::NONE;
+			return;
+		}
 	}
-	else if( !iswhitespace( c ) && c != '(' && c != ')' )//lets just add each register string to there respective array.
-		token.params[token.numParams][strlen( token.params[token.numParams] )] = c;
+
+	finalizeToken( retVal );
 }
 
-// PRE: This object is defined and c, op, state, and token are also defined.
-// POST: The continuation or starting of the parse iff op = JALR. The values in token and state 
-//		 will be reflected accordingly.
-void Parser::parseTwoRegisterParams( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: This object is defined and instruct is defined.
+// POST: The OS will have the contents of the instruction printed in the following format.
+//		If the type is a comment then just Comment is printed on a single line.
+//		If the type is Label then the following format is followed:
+//			<original line>
+//			Label: <label name> at address <address>
+//		If the type is a instruction then the following format is followed:
+//		R-type
+//			<original line>
+//			Opcode: <opcode in binary>, Reg. X: <binary of reg X>, Reg Y: <binary of reg Y>, Reg. Z: <binary of reg Z>
+//		L-type
+//			<original line>
+//			Opcode: <opcode in binary>, Reg. X: <binary of reg X>, Reg. Y: <binary of reg Y>, Offset: <decimal of value>
+//		J-type
+//			<original line>
+//			Opcode: <opcode in binary>, Reg. X: <binary of reg X>, Variable: <variable name>
+void Parser::printInstruction( const InstructionToken &token )
 {
-	//counting starts at 0 and there is a max of 3 registers.
-	if( token.numParams > 1 )
-	{
-		state = ParseStates::START;
-	}//first param
-	else if( c == ',' || iswhitespace( c ) || c == '\r' || c == '\n' )
+	if( token.instruct.type != Types::COMMENT )
 	{
-		token.numParams++;
+		InstructionUnion instruct = token.instruct.instruct;
+		cout << token.original << endl;
+		if( token.hasLable )
+			cout << "Lable: " << token.lable << " at address " << token.address << endl;
+		cout << "Opcode: "; printBinary( instruct.op );
+		cout << ", Reg. X: "; printBinary( instruct.x );
+		switch( instruct.op )
+		{
+			case ADD: case NAND:
+				cout << ", Reg. Y: "; printBinary( instruct.y );
+				cout << ", Reg. Z: "; printBinary( instruct.z );
+				break;
+			case ADDI:
+				cout << ", Reg. Y: "; printBinary( instruct.y );
+				cout << ", Offset: "; printBinary( instruct.value );
+				break;
+			case BEQ:
+				cout << ", Reg. Y: "; printBinary( instruct.y );
+				cout << ", Offset";
+				if( isalpha( token.params[2][0] ) )
+					cout << " lable: " << token.params[2];
+				else
+					cout << ": "; printBinary( instruct.value );
+				break;
+			case LW: case SW:
+				if( token.numParams == 3 )
+				{
+					cout << ", Reg. Y: "; printBinary( instruct.y );
+					cout << ", Offset: " << instruct.value;
+				}
+				else
+					cout << ", Variable: " << token.params[1];
+				break;
+			case JALR:
+				cout << ", Reg. Y: "; printBinary( instruct.y );
+				break;
+			case HALT: break;
+		}
+		cout << endl;
 	}
-	else//lets just add each register string to there respective array.
-		token.params[token.numParams][strlen( token.params[token.numParams] )] = c;
 }
 
-void Parser::parseSingleRegisterParams( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: This object is defined and as is value.
+// POST: The OS will have the binary representation of value.
+void Parser::printBinary( unsigned int value )
 {
-	if( token.numParams >= 1 )
-	{
-		state = ParseStates::START;
-	}
-	else if( c == ',' || iswhitespace( c ) || c == '\r' || c == '\n' )
-	{
-		state = ParseStates::ALPHA;
+	unsigned int i;
+	i = 1<<3;
+
+	while (i > 0) {
+		if (value & i)
+			cout << "1";
+		else
+			cout << "0";
+		i >>= 1;
 	}
-	else
-		token.params[token.numParams][strlen( token.params[token.numParams ])] = c;
 }
 
 // PRE: This object is defined and token was gotten from parseLine.
 // POST: The token will have its Instruction structure filled in with the relavant information.
+//		If a param names a register that does not exist the token is
+//		reported and its type is set to NONE.
 void Parser::finalizeToken( InstructionToken &token )
 {
 	//get the proper register values.
@@ -606,31 +1341,50 @@ void Parser::finalizeToken( InstructionToken &token )
 #define GETINSTRUCT( t ) t.instruct.instruct
 	if( token.instruct.type != Types::COMMENT )
 	{
+		uint32_t codes[NUM_PARAMS];
+		for( int i = 0; i < NUM_PARAMS; i++ )
+		{
+			codes[i] = getRegisterCode( token.params[i] );
+			if( codes[i] == NO_REGISTER )
+			{
+				*mLog << "Unknown register " << token.params[i] << " in: " << token.original << endl;
+				mErrors++;
+				token.instruct.type = Types::NONE;
+				return;
+			}
+		}
+
 		token.instruct.type = Types::INSTRUCTION;
 		switch( GETINSTRUCT( token ).op )
 		{
 			case ADD: case NAND:
-				GETINSTRUCT( token ).x = getRegisterCode( token.params[0] );
-				GETINSTRUCT( token ).y = getRegisterCode( token.params[1] );
-				GETINSTRUCT( token ).z = getRegisterCode( token.params[2] );
+				GETINSTRUCT( token ).x = codes[0];
+				GETINSTRUCT( token ).y = codes[1];
+				GETINSTRUCT( token ).z = codes[2];
 				break;
 			case ADDI:
-				GETINSTRUCT( token ).x = getRegisterCode( token.params[0] );
-				GETINSTRUCT( token ).y = getRegisterCode( token.params[1] );
-				GETINSTRUCT( token ).value = strToInt( token.params[2] );
+				GETINSTRUCT( token ).x = codes[0];
+				GETINSTRUCT( token ).y = codes[1];
+				//A name is patched by its fixup, see fixAddresses().
+				if( IS_CONSTANT( token.params[2] ) )
+					GETINSTRUCT( token ).value = (int32_t)constantValue( token.params[2] );
 				break;
 			case BEQ:
-				GETINSTRUCT( token ).x = getRegisterCode( token.params[0] );
-				GETINSTRUCT( token ).y = getRegisterCode( token.params[1] );
+				GETINSTRUCT( token ).x = codes[0];
+				GETINSTRUCT( token ).y = codes[1];
 				break;
 			case LW: case SW:
-				GETINSTRUCT( token ).x = getRegisterCode( token.params[0] );
-				GETINSTRUCT( token ).y = getRegisterCode( token.params[2] );
-				GETINSTRUCT( token ).value = strToInt( token.params[1] );
+				GETINSTRUCT( token ).x = codes[0];
+				GETINSTRUCT( token ).y = codes[2];
+				if( IS_CONSTANT( token.params[1] ) )
+					GETINSTRUCT( token ).value = (int32_t)constantValue( token.params[1] );
 				break;
 			case IN: case OUT:
-				GETINSTRUCT( token ).x = getRegisterCode( token.params[0] );
+				GETINSTRUCT( token ).x = codes[0];
+				break;
 			case JALR:
+				GETINSTRUCT( token ).x = codes[0];
+				GETINSTRUCT( token ).y = codes[1];
 				break;
 			case HALT:
 				break;
@@ -638,149 +1392,29 @@ void Parser::finalizeToken( InstructionToken &token )
 	}
 }
 
-// PRE: This object is defined and the registerStr is defined as well.
-// POST: The RV is the 4bit code for the specific register.
-unsigned int Parser::getRegisterCode( const char *registername )
-{
-	unsigned int retVal = 0;
-	if( registername[0] == '$' )
-	{
-		switch( registername[1] )
-		{
-			case 'v':
-				if( registername[2] == '0' ) retVal = 0x02; break;
-			case 'a':
-				switch( registername[2] )
-				{
-					case 't': retVal = 0x02; break;	case '0': retVal = 0x03; break;
-					case '1': retVal = 0x04; break; case '2': retVal = 0x05; break;
-				}
-				break;
-			case 't':
-				switch( registername[2] )
-				{
-					case '0': retVal = 0x06; break;	case '1': retVal = 0x07; break;
-					case '2': retVal = 0x08; break;
-				}
-				break;
-			case 's':
-				switch( registername[2] )
-				{
-					case '0': retVal = 0x09; break;	case '1': retVal = 0x0A; break;
-					case '2': retVal = 0x0B; break; case 'p': retVal = 0x0D; break;
-				}
-				break;
-			case 'k':
-				switch( registername[2] )
-				{
-					case '0': retVal = 0x0C; break;
-				}
-				break;
-			case 'f':
-				switch( registername[2] )
-				{
-					case 'p': retVal = 0x0E; break;
-				}
-				break;
-			case 'r':
-				switch( registername[2] )
-				{
-					case 'a': retVal = 0x0F; break;
-				}
-				break;
-		}
-	}
-	return retVal;
-}
-
-
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then state remains in its current state and
-//		 op remains in ADD, and token is updated accordingly.
-void Parser::parseADD( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( c == 'i' )
-		op = ADDI;
-	else if( c != 'd' && (token.original[strlen( token.original ) - 1] == 'd' || token.original[strlen( token.original ) - 1]== 'a') )
-		state = ParseStates::ALPHA;
-}
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then state remains in its current state and
-//		 op remains in LW, and token is updated accordingly.
-void Parser::parseLW( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( c != 'w' )
-		state = ParseStates::ALPHA;
-}
-//This define just makes things easier to type for these functions.
-#define FOLLOWEDBY( a, b ) ( c == a && token.original[strlen( token.original ) - 2] == b )
-
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then state remains in its current state and
-//		 op remains in BEQ, and token is updated accordingly.
-void Parser::parseBEQ( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( !(FOLLOWEDBY( 'e', 'b' ) || FOLLOWEDBY( 'q', 'e' ) ) )
-		state = ParseStates::ALPHA;
-}
-
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then state remains in its current state and
-//		 op remains in NAND, and token is updated accordingly.
-void parseNAND( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( !(FOLLOWEDBY( 'a', 'n' ) && FOLLOWEDBY( 'n', 'a' ) && FOLLOWEDBY( 'd', 'n' ) ) )
-		state = ParseStates::ALPHA;
-}
-
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then state remains in its current state and
-//		 op remains in JALR, and token is updated accordingly.
-void Parser::parseJALR( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
+// PRE: This object is defined and the registername is defined as well.
+// POST: The RV is the 4bit code for the register. A param that is
+//		empty or not a register is 0, and a name that starts with a '$'
+//		but is not a register is NO_REGISTER.
+uint32_t Parser::getRegisterCode( const char *registername )
 {
-	if( !( FOLLOWEDBY( 'a', 'j' ) && FOLLOWEDBY( 'l', 'a' ) && FOLLOWEDBY( 'r', 'l' ) ) )
-		state = ParseStates::ALPHA;
+	if( registername[0] != '$' )
+		return 0;
+	return lookupRegister( registername );
 }
 
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then state remains in its current state and
-//		 op remains in HALT, and token is updated accordingly.
-void Parser::parseHALT( char c, Opcode &op, ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( !( FOLLOWEDBY( 'a', 'h' ) && FOLLOWEDBY( 'l', 'a' ) && FOLLOWEDBY( 't', 'l' ) ) )
-		state = ParseStates::ALPHA;
-}
-
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then
-//       state remains in its current state and
-//         op remains in IN, and token is updated accordingly.
-void Parser::parseIN( char c, Opcode &op,
-    ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( !( FOLLOWEDBY( 'n', 'i' ) ) )
-		state = ParseStates::ALPHA;
-}
-
-// PRE: This object is defined as are c, op, state, token.
-// POST: If the current c helps to complete the opcode mnumonic then
-//       state remains in its current state and
-//         op remains in OUT, and token is updated accordingly.
-void Parser::parseOUT( char c, Opcode &op,
-    ParseStates::ParseState &state, InstructionToken &token )
-{
-	if( !( FOLLOWEDBY( 'u', 'o' ) || FOLLOWEDBY( 't', 'u' ) ) )
-		state = ParseStates::ALPHA;
-}
 
 // PRE: This object and line are defined.  The line will be processed,
 //		and if needed will be expanded into the proper format, as we
 //		discussed in class.
-// POST: A List<char *> will be returned. This list will be merged into
-//		the remaining lines before the final pass and assembly happens.
-void Parser::preprocessLine( List<char *> *list, char *line )
+// POST: tokens will have the expanded instructions appended to it, each
+//		one already encoded and ready to be added to mTokens.
+void Parser::preprocessLine( Array<InstructionToken> &tokens, std::string_view line )
 {
-	InstructionToken token = parseLine( line, 0 );
+	//The line is parsed into mLine rather than a new token, the
+	//expansions read it while they are added to tokens.
+	InstructionToken &token = mLine;
+	parseLine( line, 0, token );
 
 	if( token.instruct.type == Types::INSTRUCTION )
 	{
@@ -788,257 +1422,345 @@ void Parser::preprocessLine( List<char *> *list, char *line )
 		{
 			case ADD:
 			case NAND:
-				preprocessThreeRegister( list, token );
+				preprocessThreeRegister( tokens, token );
 				break;
 			case ADDI:
-				preprocessTwoRegistersOffsetStore( list, token );
+				preprocessTwoRegistersOffsetStore( tokens, token );
 				break;
 			case BEQ:
-				preprocessTwoRegistersOffset( list, token );
+				preprocessTwoRegistersOffset( tokens, token );
 				break;
 			case LW:
 			case SW:
-				preprocessTwoRegister( list, token );
-				//preprocessTwoRegistersOffset( list, token );
+				preprocessTwoRegister( tokens, token );
 				break;
 			case IN:
 			case OUT:
-				preprocessSingleRegister( list, token );
+				preprocessSingleRegister( tokens, token );
 				break;
 			case JALR:
-				preprocessTwoRegister( list, token );
+				preprocessTwoRegister( tokens, token );
+				break;
+			case HALT:
+				tokens.add( token );
 				break;
 		}
 	}
 }
 
-#define IS_REG( C ) ( C == '$' )
-
-// PRE: This object is defined, list and token are defined.
-//		list is empty.
-// POST: The preprocessing is handled and list contains the new lines.
-//		these new lines contain the substitution's and expansions.
-void Parser::preprocessThreeRegister( List<char *> *list, InstructionToken token )
+// PRE: This object and line are defined.
+// POST: list will contain the text of the expanded lines, in the same
+//		format that is written to the .pre file. The text lives in the
+//		arena of this parser and is released with it.
+void Parser::preprocessLine( List<char *> *list, std::string_view line )
 {
-	//check which params are in fact not registers.
-	char *first_param = 0, *second_param = 0, *third_param = 0, *result = 0, *add_str;
+	Array<InstructionToken> tokens;
+	preprocessLine( tokens, line );
 
-	if( !IS_REG( token.params[2][0] ) )
+	char text[FORMAT_LINE];
+	for( uint32_t i = 0; i < tokens.length(); i++ )
 	{
-		third_param = new char[LINE];
-		sprintf( third_param, "lw $t2, %s", token.params[2] );
+		formatToken( tokens[i], text );
+		list->add( mArena.copyString( text ) );
 	}
+}
+
+// PRE: This object and token are defined, line can hold FORMAT_LINE chars.
+// POST: line holds the assembly text for token.
+void Parser::formatToken( const InstructionToken &token, char *line )
+{
+	char *walker = line;
+	if( token.hasLable )
+		walker += sprintf( walker, "%s: ", token.lable );
+
+	walker += sprintf( walker, "%s", GetOpCodeString( token.instruct.instruct.op ) );
 
-	if( !IS_REG( token.params[1][0] ) )
+	Opcode op = (Opcode)token.instruct.instruct.op;
+	if( ( op == LW || op == SW ) && token.params[2][0] != '\0' )
+	{
+		sprintf( walker, " %s, %s(%s)", token.params[0], token.params[1], token.params[2] );
+	}
+	else
 	{
-		second_param = new char[LINE];
-		sprintf( second_param, "lw $t1, %s", token.params[1] );
+		for( int i = 0; i < NUM_PARAMS && token.params[i][0] != '\0'; i++ )
+			walker += sprintf( walker, "%s%s", ( i == 0 ? " " : ", " ), token.params[i] );
 	}
+}
 
-	if( !IS_REG( token.params[0][0] ) )
+// PRE: This object is defined, tokens, op and the params are defined.
+//		lable is 0 if the instruction does not have one.
+// POST: A new instruction is encoded and appended to tokens.
+void Parser::addExpansion( Array<InstructionToken> &tokens, Opcode op, const char *lable,
+						   const char *first, const char *second, const char *third )
+{
+	tokens.resize( tokens.length() + 1 );
+	InstructionToken &token = tokens[tokens.length() - 1];
+	const char *params[NUM_PARAMS] = { first, second, third };
+
+	token.original[0] = '\0';
+	token.hasLable = lable != 0;
+	if( token.hasLable )
+		copyString( token.lable, lable );
+	else
+		token.lable[0] = '\0';
+
+	token.numParams = 0;
+	for( int i = 0; i < NUM_PARAMS; i++ )
 	{
-		first_param = new char[LINE];
-		sprintf( first_param, "lw $t0, %s", token.params[0] );
-		result = new char[LINE];
-		sprintf( result, "sw $t0, %s", token.params[0] );
+		copyString( token.params[i], params[i] );
+		if( params[i][0] != '\0' )
+			token.numParams = i + 1;
 	}
 
-	if( first_param != 0 )
-		list->add( first_param );
-	if( second_param != 0 )
-		list->add( second_param );
-	if( third_param != 0 )
-		list->add( third_param );
-	
-	add_str = new char[LINE];
+	token.address = 0;
+	token.instruct.type = Types::INSTRUCTION;
+	token.instruct.instruct.binary = 0;
+	token.instruct.instruct.op = op;
+	finalizeToken( token );
+}
+
+#define IS_REG( C ) ( C == '$' )
+#define LABLE_OF( token ) ( token.hasLable ? token.lable : 0 )
 
-	sprintf( add_str, "%s%s%s %s, %s, %s",( token.hasLable ? token.lable : "" ), ( token.hasLable ? ": " : "" ), 
-										   GetOpCodeString( token.instruct.instruct.op ), ( first_param != 0 ? "$t0":token.params[0] ),
-										   ( second_param != 0 ? "$t1":token.params[1] ),
-										   ( third_param != 0 ? "$t2":token.params[2] ) );
-	list->add( add_str );
+// PRE: None.
+// POST: The RV is true if a 32 bit word can hold value, signed or not.
+static bool fitsWord( int64_t value )
+{
+	return value >= INT32_MIN && value <= UINT32_MAX;
+}
+
+// PRE: None.
+// POST: The RV is true if the 20 bit signed value of an ADDI can hold
+//		value.
+static bool fitsImmediate( int64_t value )
+{
+	return value >= MIN_IMMEDIATE && value <= MAX_IMMEDIATE;
+}
 
-	if( result != 0 )
-		list->add( result );
+// PRE: scratch and spare are registers and other is the param of the
+//		source that is not loaded into scratch.
+// POST: The RV is scratch, or spare if other is that register, so a
+//		source that is loaded does not overwrite the other one.
+static const char *scratchFor( const char *scratch, const char *spare, const char *other )
+{
+	if( IS_REG( other[0] ) && lookupRegister( other ) == lookupRegister( scratch ) )
+		return spare;
+	return scratch;
 }
 
-// PRE: This object is defined, list and token are defined.
-//		list is empty.
-// POST: The preprocessing is handled and list contains the new lines.
-//		these new lines contain the substitution's and expansions.
-void Parser::preprocessTwoRegister( List<char *> *list, InstructionToken token )
+// PRE: This object is defined, tokens is defined, reg is a register and
+//		param is a param that is not one.
+// POST: The expansion that puts the value of param into reg is added to
+//		tokens. A constant that fits is added to $zero by an ADDI, one
+//		that does not is loaded from its entry in the constant pool and
+//		a variable is loaded from its slot.
+void Parser::addLoad( Array<InstructionToken> &tokens, const char *reg, const char *param )
 {
-	if( token.numParams < 1 )
+	if( !IS_CONSTANT( param ) )
 	{
-		char *lw_str = new char[LINE];
-		char *jalr_str = new char[LINE];
-		sprintf( lw_str, "lw $k0, %s", token.params[0] );
-		sprintf( jalr_str, "%s%sjalr $k0, $ra", ( token.hasLable ? token.lable : "" ), ( token.hasLable ? ":" : "" ) );
-		list->add( lw_str );
-		list->add( jalr_str );
+		addExpansion( tokens, LW, 0, reg, param, "" );
+		return;
 	}
-	else
-	{
-		char *instruct, *first_param = 0, *second_param = 0, *result_str;
 
-		if( token.instruct.instruct.op == LW )
-		{
-			if( !IS_REG( token.params[0][0] ) )
-			{
-				first_param = new char[LINE];
-				sprintf( first_param, "lw $t0, %s", token.params[0] );
-				result_str = new char[LINE];
-				sprintf( result_str, "sw $t0, %s", token.params[0] );
-				list->add( first_param );
-			}
-
-			if( !IS_REG( token.params[1][0] ) )
-			{
-				second_param = new char[LINE];
-				sprintf( second_param, "lw $t1, %s", token.params[1] );
-				list->add( second_param );
-			}
+	int64_t value = constantValue( param );
+	if( fitsImmediate( value ) )
+	{
+		addExpansion( tokens, ADDI, 0, reg, "$zero", param );
+		return;
+	}
 
-			instruct = new char[LINE];
+	if( !fitsWord( value ) )
+	{
+		*mLog << "Constant " << param << " does not fit in a word in: " << mLine.original << endl;
+		mErrors++;
+		return;
+	}
 
-			sprintf( instruct, "%s%s%s %s %s",( token.hasLable ? token.lable : "" ), ( token.hasLable ? ": " : "" ), 
-										   GetOpCodeString( token.instruct.instruct.op ), ( first_param != 0 ? "$t0":token.params[0] ),
-										   ( second_param != 0 ? "$t1":token.params[1] ) );
-			list->add( instruct );
+	//Every use of the same value names the same entry.
+	char entry[LINE];
+	sprintf( entry, "%c%d", POOL_PREFIX, (int32_t)value );
+	addExpansion( tokens, LW, 0, reg, entry, "" );
+}
 
-			if( result_str != 0 )
-				list->add( result_str );
+// PRE: This object is defined, tokens and token are defined.
+// POST: The preprocessing is handled and tokens contains the new
+//		instructions. These contain the substitution's and expansions.
+void Parser::preprocessThreeRegister( Array<InstructionToken> &tokens, const InstructionToken &token )
+{
+	//check which params are in fact not registers.
+	bool first_param = !IS_REG( token.params[0][0] );
+	bool second_param = !IS_REG( token.params[1][0] );
+	bool third_param = !IS_REG( token.params[2][0] );
+
+	//An ADD of a constant that an ADDI can hold is that ADDI.
+	const char *immediate = 0;
+	const char *other = 0;
+	char sum[LINE];
+	if( token.instruct.instruct.op == ADD )
+	{
+		bool second_constant = second_param && IS_CONSTANT( token.params[1] );
+		bool third_constant = third_param && IS_CONSTANT( token.params[2] );
+		if( second_constant && third_constant &&
+			fitsWord( constantValue( token.params[1] ) ) && fitsWord( constantValue( token.params[2] ) ) &&
+			fitsImmediate( constantValue( token.params[1] ) + constantValue( token.params[2] ) ) )
+		{
+			sprintf( sum, "%d", (int32_t)( constantValue( token.params[1] ) + constantValue( token.params[2] ) ) );
+			immediate = sum;
+			other = "$zero";
 		}
-		else if( token.instruct.instruct.op == SW )
+		else if( third_constant && fitsImmediate( constantValue( token.params[2] ) ) )
 		{
-			if( !IS_REG( token.params[0][0] ) )
-			{
-				first_param = new char[LINE];
-				sprintf( first_param, "lw $t0, %s", token.params[0] );
-				result_str = new char[LINE];
-				list->add( first_param );
-			}
+			immediate = token.params[2];
+			other = token.params[1];
+		}
+		else if( second_constant && fitsImmediate( constantValue( token.params[1] ) ) )
+		{
+			immediate = token.params[1];
+			other = token.params[2];
+		}
+	}
 
-			if( !IS_REG( token.params[1][0] ) )
-			{
-				second_param = new char[LINE];
-				sprintf( second_param, "lw $t1, %s", token.params[1] );
-				list->add( second_param );
-				sprintf( result_str, "sw $t1, %s", token.params[0] );
-			}
+	if( first_param )
+		addExpansion( tokens, LW, 0, "$t0", token.params[0], "" );
 
-			instruct = new char[LINE];
+	if( immediate != 0 )
+	{
+		bool load = !IS_REG( other[0] );
+		if( load )
+			addLoad( tokens, "$t1", other );
+		addExpansion( tokens, ADDI, LABLE_OF( token ), ( first_param ? "$t0" : token.params[0] ),
+					  ( load ? "$t1" : other ), immediate );
+		if( first_param )
+			addExpansion( tokens, SW, 0, "$t0", token.params[0], "" );
+		return;
+	}
 
-			sprintf( instruct, "%s%s%s %s %s",( token.hasLable ? token.lable : "" ), ( token.hasLable ? ": " : "" ), 
-										   GetOpCodeString( token.instruct.instruct.op ), ( first_param != 0 ? "$t0":token.params[0] ),
-										   ( second_param != 0 ? "$t1":token.params[1] ) );
+	//A source that is a register keeps it, the other is loaded into
+	//the scratch register it does not use.
+	const char *second = second_param ? scratchFor( "$t1", "$t2", token.params[2] ) : token.params[1];
+	const char *third = third_param ? scratchFor( "$t2", "$t1", token.params[1] ) : token.params[2];
+	if( second_param )
+		addLoad( tokens, second, token.params[1] );
+	if( third_param )
+		addLoad( tokens, third, token.params[2] );
 
-			list->add( instruct );
+	addExpansion( tokens, (Opcode)token.instruct.instruct.op, LABLE_OF( token ),
+				  ( first_param ? "$t0" : token.params[0] ), second, third );
 
-			if( result_str != 0 )
-				list->add( result_str );
-		}
-	}
+	if( first_param )
+		addExpansion( tokens, SW, 0, "$t0", token.params[0], "" );
 }
 
-// PRE: This object is defined, list and token are defined.
-//		list is empty.
-// POST: The preprocessing is handled and list contains the new lines.
-//		these new lines contain the substitution's and expansions.
-void Parser::preprocessTwoRegistersOffset( List<char *> *list, InstructionToken token )
+// PRE: This object is defined, tokens and token are defined.
+// POST: The preprocessing is handled and tokens contains the new
+//		instructions. These contain the substitution's and expansions.
+void Parser::preprocessTwoRegister( Array<InstructionToken> &tokens, const InstructionToken &token )
 {
-	char *second_param = 0, *first_param = 0;
-
-	if( !IS_REG( token.params[1][0] ) )
+	if( token.instruct.instruct.op == JALR )
 	{
-		second_param = new char[LINE];
-		sprintf( second_param, "lw $t2, %s", token.params[1] );
+		//A jalr to a variable or lable loads the address into $k0 and
+		//links through $ra. A lable's LW becomes an ADDI of its address
+		//once it is known, see fixAddresses().
+		if( token.numParams == 1 && !IS_REG( token.params[0][0] ) )
+		{
+			addExpansion( tokens, LW, 0, "$k0", token.params[0], "" );
+			addExpansion( tokens, JALR, LABLE_OF( token ), "$k0", "$ra", "" );
+		}
+		else
+			tokens.add( token );
 	}
-
-	if( !IS_REG( token.params[0][0] ) )
+	else if( IS_REG( token.params[0][0] ) )
 	{
-		first_param = new char[LINE];
-		sprintf( first_param, "lw $t1, %s", token.params[0] );
+		//The second param is already a memory operand, so a LW/SW on a
+		//register is left as it is.
+		tokens.add( token );
 	}
-
-	if( first_param != 0 )
-		list->add( first_param );
-	if( second_param != 0 )
-		list->add( second_param );
-	
-	char *add_str = new char[LINE];
-	sprintf( add_str, "%s%s%s %s, %s, %s",( token.hasLable ? token.lable : "" ), ( token.hasLable ? ": " : "" ), 
-										   GetOpCodeString( token.instruct.instruct.op ), ( first_param != 0 ? "$t0":token.params[0] ),
-										   ( second_param != 0 ? "$t1":token.params[1] ),
-										   token.params[2] );
-	list->add( add_str );
-}
-
-// PRE: This object is defined, list and token are defined.
-//		list is empty.
-// POST: The preprocessing is handled and list contains the new lines.
-//		these new lines contain the substitution's and expansions.
-void Parser::preprocessTwoRegistersOffsetStore( List<char *> *list, InstructionToken token )
-{
-	char *second_param = 0, *first_param = 0, *result_str = 0;
-
-	if( !IS_REG( token.params[1][0] ) )
+	else if( token.instruct.instruct.op == LW )
 	{
-		second_param = new char[LINE];
-		sprintf( second_param, "lw $t1, %s", token.params[1] );
+		addExpansion( tokens, LW, LABLE_OF( token ), "$t0", token.params[1], token.params[2] );
+		addExpansion( tokens, SW, 0, "$t0", token.params[0], "" );
 	}
-
-	if( !IS_REG( token.params[0][0] ) )
+	else if( token.instruct.instruct.op == SW )
 	{
-		first_param = new char[LINE];
-		sprintf( first_param, "lw $t0, %s", token.params[0] );
-		result_str = new char[LINE];
-		sprintf( result_str, "sw $t0, %s", token.params[0] );
+		addLoad( tokens, "$t0", token.params[0] );
+		addExpansion( tokens, SW, LABLE_OF( token ), "$t0", token.params[1], token.params[2] );
 	}
+}
 
-	if( first_param != 0 )
-		list->add( first_param );
-	if( second_param != 0 )
-		list->add( second_param );
-	
-	char *add_str = new char[LINE];
-	sprintf( add_str, "%s%s%s %s, %s, %s",( token.hasLable ? token.lable : "" ), ( token.hasLable ? ": " : "" ), 
-										   GetOpCodeString( token.instruct.instruct.op ), ( first_param != 0 ? "$t0":token.params[0] ),
-										   ( second_param != 0 ? "$t1":token.params[1] ),
-										   token.params[2] );
-	list->add( add_str );
+// PRE: This object is defined, tokens and token are defined.
+// POST: The preprocessing is handled and tokens contains the new
+//		instructions. These contain the substitution's and expansions.
+void Parser::preprocessTwoRegistersOffset( Array<InstructionToken> &tokens, const InstructionToken &token )
+{
+	bool first_param = !IS_REG( token.params[0][0] );
+	bool second_param = !IS_REG( token.params[1][0] );
+	const char *first = first_param ? scratchFor( "$t0", "$t1", token.params[1] ) : token.params[0];
+	const char *second = second_param ? scratchFor( "$t1", "$t0", token.params[0] ) : token.params[1];
+
+	if( first_param )
+		addLoad( tokens, first, token.params[0] );
+	if( second_param )
+		addLoad( tokens, second, token.params[1] );
+
+	addExpansion( tokens, (Opcode)token.instruct.instruct.op, LABLE_OF( token ), first, second,
+				  token.params[2] );
+}
 
-	if( result_str != 0 )
-		list->add( result_str );
+// PRE: This object is defined, tokens and token are defined.
+// POST: The preprocessing is handled and tokens contains the new
+//		instructions. These contain the substitution's and expansions.
+void Parser::preprocessTwoRegistersOffsetStore( Array<InstructionToken> &tokens, const InstructionToken &token )
+{
+	bool first_param = !IS_REG( token.params[0][0] );
+	bool second_param = !IS_REG( token.params[1][0] );
+	//A value too wide for the ADDI is added from the constant pool.
+	bool wide = IS_CONSTANT( token.params[2] ) && !fitsImmediate( constantValue( token.params[2] ) );
+
+	if( first_param )
+		addExpansion( tokens, LW, 0, "$t0", token.params[0], "" );
+	if( second_param )
+		addLoad( tokens, "$t1", token.params[1] );
+	//$t1 only holds a source that is not a register.
+	const char *scratch = scratchFor( "$t2", "$t1", token.params[1] );
+	if( wide )
+		addLoad( tokens, scratch, token.params[2] );
+
+	addExpansion( tokens, wide ? ADD : (Opcode)token.instruct.instruct.op, LABLE_OF( token ),
+				  ( first_param ? "$t0" : token.params[0] ),
+				  ( second_param ? "$t1" : token.params[1] ),
+				  ( wide ? scratch : token.params[2] ) );
+
+	if( first_param )
+		addExpansion( tokens, SW, 0, "$t0", token.params[0], "" );
 }
 
-// PRE: This object is defined, list and token are defined.
-//		list is empty.
-// POST: The preprocessing is handled and list contains the new lines.
-//		these new lines contain the substitution's and expansions.
-void Parser::preprocessSingleRegister( List<char *> *list, InstructionToken token )
+// PRE: This object is defined, tokens and token are defined.
+// POST: The preprocessing is handled and tokens contains the new
+//		instructions. These contain the substitution's and expansions.
+void Parser::preprocessSingleRegister( Array<InstructionToken> &tokens, const InstructionToken &token )
 {
 	if( !IS_REG( token.params[0][0] ) )
 	{
-		char *lw_str = new char[LINE];
-		char *inout_str = new char[LINE];
-		sprintf( lw_str, "lw $t0, %s", token.params[0] );
-		sprintf( inout_str, "%s%s%s $t0",( token.hasLable ? token.lable : "" ), ( token.hasLable ? ":" : "" ), GetOpCodeString( token.instruct.instruct.op ) );
-		list->add( lw_str );
-		list->add( inout_str );
+		//IN writes its param, so a constant is an address as with LW/SW.
+		if( token.instruct.instruct.op == OUT )
+			addLoad( tokens, "$t0", token.params[0] );
+		else
+			addExpansion( tokens, LW, 0, "$t0", token.params[0], "" );
+		addExpansion( tokens, (Opcode)token.instruct.instruct.op, LABLE_OF( token ), "$t0", "", "" );
 
 		if( token.instruct.instruct.op == IN )
-		{
-			char *sw_str = new char[LINE];
-			sprintf( sw_str, "sw $t0, %s", token.params[0] );
-			list->add( sw_str );
-		}
+			addExpansion( tokens, SW, 0, "$t0", token.params[0], "" );
 	}
+	else
+		tokens.add( token );
 }
 
 
 #ifdef TESTING
+#include "Emulator.h"
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 void testParserIN()
 {
@@ -1063,6 +1785,46 @@ void testParserBEQ()
 	assert( token.instruct.instruct.op == BEQ );
 }
 
+void testParserUnknownNames()
+{
+	Parser p;
+	InstructionToken token = p.parseLine( "jarl $a0, $ra", 0 );
+	assert( token.instruct.type == Types::NONE );
+
+	token = p.parseLine( "add $a0, $t3, $a2", 0 );
+	assert( token.instruct.type == Types::NONE );
+
+	token = p.parseLine( "add $at, $zero, $ra", 0 );
+	assert( token.instruct.type == Types::INSTRUCTION );
+	assert( token.instruct.instruct.x == 1 );
+	assert( token.instruct.instruct.y == 0 );
+	assert( token.instruct.instruct.z == 15 );
+
+	List<char *> lines;
+	p.preprocessLine( &lines, "nand $a0, $a1, $s7" );
+	assert( lines.length() == 0 );
+
+	//A name can not be cut to fit, two long ones would become one.
+	std::string name( LINE, 'v' );
+	std::string line = "lw $a0, " + name;
+	token = p.parseLine( line, 0 );
+	assert( token.instruct.type == Types::NONE );
+	line = name + ": halt";
+	token = p.parseLine( line, 0 );
+	assert( token.instruct.type == Types::NONE );
+	token = p.parseLine( "lw $a0, " + name.substr( 1 ), 0 );
+	assert( token.instruct.type == Types::INSTRUCTION );
+
+	//An operand past the last is not dropped.
+	uint32_t errors = p.getErrors();
+	token = p.parseLine( "add $t0, $t1, $t2, $t3", 0 );
+	assert( token.instruct.type == Types::NONE );
+	token = p.parseLine( "beq $a0, $a1, x, y", 0 );
+	assert( token.instruct.type == Types::NONE && p.getErrors() == errors + 2 );
+	token = p.parseLine( "lw $a0, 4($fp)", 0 );
+	assert( token.instruct.type == Types::INSTRUCTION );
+}
+
 void testParserLabel()
 {
 	Parser p;
@@ -1071,10 +1833,24 @@ void testParserLabel()
 	assert( token.instruct.instruct.op == ADD );
 }
 
+void testParserInPlace()
+{
+	Parser p;
+	InstructionToken token;
+	p.parseLine( "addlabel: add $a1, $a1, $t0", 0, token );
+	p.parseLine( "in $a2", 8, token );
+	assert( !token.hasLable && token.lable[0] == '\0' );
+	assert( strcmp( token.original, "in $a2" ) == 0 );
+	assert( strcmp( token.params[0], "$a2" ) == 0 && token.params[1][0] == '\0' );
+	assert( token.numParams == 1 && token.address == 8 );
+	assert( token.instruct.instruct.op == IN );
+	assert( token.instruct.instruct.binary == p.parseLine( "in $a2", 8 ).instruct.instruct.binary );
+}
+
 void testParserSingleRegisterReplacementOUTX()
 {
 	Parser p;
-	List<char *> lines;
+	List<char *> lines( p.getArena() );
 	p.preprocessLine( &lines, "out x" );
 
 	assert( strcmp( lines[0]->getData(), "lw $t0, x" ) == 0 );
@@ -1143,4 +1919,447 @@ void testParserVariableRegisterReplacementXYZ()
 	assert( strcmp( lines[4]->getData(), "sw $t0, x" ) == 0 );
 }
 
-#endif
\ No newline at end of file
+// PRE: a and b are defined.
+// POST: The RV is true if the files a and b hold the same bytes.
+static bool sameFile( const char *a, const char *b )
+{
+	FILE *fileA = fopen( a, "rb" );
+	FILE *fileB = fopen( b, "rb" );
+	bool same = fileA != 0 && fileB != 0;
+	int c;
+	while( same && ( c = fgetc( fileA ) ) != EOF )
+		same = c == fgetc( fileB );
+	same = same && fgetc( fileB ) == EOF;
+
+	if( fileA != 0 )
+		fclose( fileA );
+	if( fileB != 0 )
+		fclose( fileB );
+	return same;
+}
+
+void testParserParallel()
+{
+	//Big enough to be split, with lables that are used before and after
+	//they are defined, defined twice and also used as variables.
+	char name[] = "testParallel.tmp";
+	FILE *file = fopen( name, "w" );
+	for( int i = 0; i < 40000; i++ )
+	{
+		if( i % 50 == 0 )
+			fprintf( file, "L%d: add x%d, $t0, v%d\n", i / 50 % 700, i % 97, i % 13 );
+		else if( i % 7 == 0 )
+			fprintf( file, "beq $a0, $a1, L%d\n", i * 7 % 800 );
+		else if( i % 5 == 0 )
+			fprintf( file, "lw $a0, -%d\n", i % 5 + 1 );
+		else if( i % 3 == 0 )
+			fprintf( file, "sw $a1, L%d ; a lable used as a variable\n", i % 800 );
+		else
+			fprintf( file, "in v%d\n", i % 13 );
+	}
+	fclose( file );
+
+	Parser sequential( name );
+	sequential.setWritePreProcessed( true );
+	sequential.preprocess();
+	sequential.parse();
+	rename( "testParallel.tmp.bin", "testParallel.seq.bin" );
+	rename( "testParallel.tmp.pre", "testParallel.seq.pre" );
+
+	Parser parallel( name );
+	parallel.setWritePreProcessed( true );
+	parallel.setThreads( 4 );
+	parallel.setStats( true );
+	parallel.preprocess();
+	parallel.parse();
+
+	//The chunks lex at the same time, so that is only CPU time.
+	assert( parallel.getPhaseSeconds( Phases::LEX ) == 0 && parallel.getPhaseCpuSeconds( Phases::LEX ) > 0 );
+	assert( sameFile( "testParallel.tmp.bin", "testParallel.seq.bin" ) );
+	assert( sameFile( "testParallel.tmp.pre", "testParallel.seq.pre" ) );
+
+	remove( name );
+	remove( "testParallel.tmp.bin" );
+	remove( "testParallel.tmp.pre" );
+	remove( "testParallel.seq.bin" );
+	remove( "testParallel.seq.pre" );
+}
+
+void testParserStream()
+{
+	char name[] = "testStream.tmp";
+	FILE *file = fopen( name, "w" );
+	fputs( "lw $a0, x\nbeq $a0, $zero, end\nout $a0\nend: halt\n", file );
+	fclose( file );
+
+	Parser parser( name );
+	parser.preprocess();
+	parser.parse();
+
+	//Run the same source through stdin and stdout.
+	int in = dup( 0 );
+	int out = dup( 1 );
+	int source = open( name, O_RDONLY );
+	int result = open( "testStream.out", O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	dup2( source, 0 );
+	dup2( result, 1 );
+	close( source );
+	close( result );
+
+	char stream[] = STREAM_FILE;
+	Parser streamed( stream );
+	streamed.setWritePreProcessed( true );
+	streamed.preprocess();
+	streamed.parse();
+
+	dup2( in, 0 );
+	dup2( out, 1 );
+	close( in );
+	close( out );
+
+	assert( streamed.wasWritten() );
+	assert( sameFile( "testStream.tmp.bin", "testStream.out" ) );
+	assert( access( "-.pre", F_OK ) != 0 && access( "-.bin", F_OK ) != 0 );
+
+	remove( name );
+	remove( "testStream.tmp.bin" );
+	remove( "testStream.out" );
+}
+
+// PRE: lines holds count lines of source.
+// POST: The lines are written to file, one per line.
+static void writeLines( const char *file, const char **lines, int count )
+{
+	FILE *out = fopen( file, "w" );
+	for( int i = 0; i < count; i++ )
+		fprintf( out, "%s\n", lines[i] );
+	fclose( out );
+}
+
+// PRE: lines holds count lines of source.
+// POST: The lines are assembled incrementally as testIncremental.tmp and
+//		from scratch as testIncremental.ref, the RV is the incremental
+//		parser's reused lines after checking both made the same words.
+static uint32_t assembleBoth( const char **lines, int count, uint32_t errors )
+{
+	char name[] = "testIncremental.tmp";
+	char reference[] = "testIncremental.ref";
+	writeLines( name, lines, count );
+	writeLines( reference, lines, count );
+
+	std::ostringstream log;
+	Parser incremental( name );
+	incremental.setLog( &log );
+	incremental.setIncremental( true );
+	incremental.preprocess();
+	incremental.parse();
+
+	Parser scratch( reference );
+	scratch.setLog( &log );
+	scratch.preprocess();
+	scratch.parse();
+
+	assert( incremental.getErrors() == errors && scratch.getErrors() == errors );
+	assert( sameFile( "testIncremental.tmp.bin", "testIncremental.ref.bin" ) );
+	return incremental.getReusedLines();
+}
+
+void testParserIncremental()
+{
+	const char *lines[400];
+	char text[400][LINE];
+	for( int i = 0; i < 400; i++ )
+	{
+		if( i % 40 == 0 )
+			sprintf( text[i], "L%d: add x%d, $t0, v%d", i / 40 % 7, i % 9, i % 5 );
+		else if( i % 7 == 0 )
+			sprintf( text[i], "beq $a0, $a1, L%d", i % 9 );
+		else if( i % 5 == 0 )
+			sprintf( text[i], "sw $a1, L%d ; a lable used as a variable", i % 8 );
+		else if( i % 3 == 0 )
+			sprintf( text[i], "lw $a0, y%d", i % 11 );
+		else
+			sprintf( text[i], "in v%d", i % 13 );
+		lines[i] = text[i];
+	}
+
+	//No state yet, then nothing changed.
+	remove( "testIncremental.tmp.state" );
+	assert( assembleBoth( lines, 400, 0 ) == 0 );
+	assert( assembleBoth( lines, 400, 0 ) == 400 );
+
+	//A line in the middle changes its words and a lable moves.
+	lines[200] = "add n, n, n";
+	assert( assembleBoth( lines, 400, 0 ) == 399 );
+	lines[200] = "L3: halt";
+	assert( assembleBoth( lines, 400, 0 ) == 399 );
+
+	//A line added at the start, then lines taken off the end.
+	const char *moved[401];
+	moved[0] = "L9: lw $a0, first";
+	for( int i = 0; i < 400; i++ )
+		moved[i + 1] = lines[i];
+	assert( assembleBoth( moved, 401, 0 ) == 400 );
+	assert( assembleBoth( moved, 381, 0 ) == 381 );
+
+	//A line with a problem is reported again even when nothing changed.
+	moved[100] = "add $a0, $t9, $a1";
+	assert( assembleBoth( moved, 381, 1 ) == 380 );
+	assert( assembleBoth( moved, 381, 1 ) == 380 );
+	moved[100] = lines[99];
+	assert( assembleBoth( moved, 381, 0 ) == 380 );
+
+	remove( "testIncremental.tmp" );
+	remove( "testIncremental.ref" );
+	remove( "testIncremental.tmp.bin" );
+	remove( "testIncremental.ref.bin" );
+	remove( "testIncremental.tmp.state" );
+}
+
+void testParserCache()
+{
+	const char *directory = "testParserCache.tmp";
+	const char *source = "lw $a0, x\nbeq $a0, $zero, end\nout $a0\nend: halt\n";
+	char name[] = "testParserCache.s";
+	FILE *file = fopen( name, "w" );
+	fputs( source, file );
+	fclose( file );
+
+	Cache cache( directory, CACHE_LIMIT );
+	Parser first( name );
+	first.setCache( &cache );
+	first.preprocess();
+	first.parse();
+	assert( !first.wasCached() );
+	rename( "testParserCache.s.bin", "testParserCache.first.bin" );
+
+	Parser second( name );
+	second.setCache( &cache );
+	second.preprocess();
+	second.parse();
+	assert( second.wasCached() && second.wasWritten() );
+	assert( second.getWordCount() == first.getWordCount() );
+	assert( second.getCodeWords() == first.getCodeWords() );
+	assert( sameFile( "testParserCache.s.bin", "testParserCache.first.bin" ) );
+
+	//Other options are a different entry.
+	Parser image( name );
+	image.setCache( &cache );
+	image.setOutputFormat( Formats::IMAGE );
+	image.preprocess();
+	image.parse();
+	assert( !image.wasCached() );
+
+	char entry[128];
+	CacheKey keys[2] = { makeCacheKey( source, Formats::HEX ), makeCacheKey( source, Formats::IMAGE ) };
+	for( int i = 0; i < 2; i++ )
+	{
+		sprintf( entry, "%s/%016llx%016llx", directory, (unsigned long long)keys[i].high,
+				 (unsigned long long)keys[i].low );
+		assert( remove( entry ) == 0 );
+	}
+	rmdir( directory );
+	remove( name );
+	remove( "testParserCache.s.bin" );
+	remove( "testParserCache.s.img" );
+	remove( "testParserCache.first.bin" );
+}
+
+void testParserStats()
+{
+	char name[] = "testParserStats.s";
+	FILE *file = fopen( name, "w" );
+	fputs( "; counts\nadd x, $a0, y\nloop: beq $a0, $zero, loop\nhalt\n", file );
+	fclose( file );
+
+	Parser p( name );
+	p.setStats( true );
+	p.preprocess();
+	p.parse();
+	assert( p.getPhaseSeconds( Phases::PREPROCESS ) >= p.getPhaseSeconds( Phases::LEX ) );
+
+	std::ostringstream json;
+	p.printStats( json, true );
+	std::string text = json.str();
+	assert( text.find( "{\"file\": \"testParserStats.s\", \"cached\": false" ) == 0 );
+	assert( text.find( "\"lex\": {\"wall\": " ) != std::string::npos );
+	assert( text.find( "\"lines\": 4, \"reusedLines\": 0, \"expandedLines\": 6" ) != std::string::npos );
+	assert( text.find( "\"symbols\": 3, \"lables\": 1, \"variables\": 2, \"constants\": 0, \"fixups\": 4, \"words\": 8" ) != std::string::npos );
+
+	std::ostringstream table;
+	p.printStats( table, false );
+	assert( table.str().find( "Symbols:        3 (1 lables, 2 variables)" ) != std::string::npos );
+	assert( table.str().find( "fixAddresses" ) != std::string::npos );
+
+	remove( name );
+	remove( "testParserStats.s.bin" );
+}
+
+void testParserConstantFolding()
+{
+	const char *lines[][5] =
+	{
+		{ "add $a0, $zero, 1", "addi $a0, $zero, 1" },
+		{ "add $a0, 2, $a1", "addi $a0, $a1, 2" },
+		{ "add $a0, 2, -5", "addi $a0, $zero, -3" },
+		{ "add x, y, 3", "lw $t0, x", "lw $t1, y", "addi $t0, $t1, 3", "sw $t0, x" },
+		{ "nand $a0, $a1, 7", "addi $t2, $zero, 7", "nand $a0, $a1, $t2" },
+		{ "beq x, 11, done", "lw $t0, x", "addi $t1, $zero, 11", "beq $t0, $t1, done" },
+		{ "out -7", "addi $t0, $zero, -7", "out $t0" },
+		//A wide ADDI adds from the pool through a register that is not
+		//its source.
+		{ "addi $t0, $a1, 1000000", "lw $t2, =1000000", "add $t0, $a1, $t2" },
+		{ "addi $t0, $t2, 1000000", "lw $t1, =1000000", "add $t0, $t2, $t1" },
+		{ "addi $t2, $t2, 1000000", "lw $t1, =1000000", "add $t2, $t2, $t1" },
+		//Nor is a source of an ADD, NAND or BEQ loaded over.
+		{ "nand $a0, $t2, 3", "addi $t1, $zero, 3", "nand $a0, $t2, $t1" },
+		{ "add $a1, 1000000, $t1", "lw $t2, =1000000", "add $a1, $t2, $t1" },
+		{ "beq 5, $t0, done", "addi $t1, $zero, 5", "beq $t1, $t0, done" },
+		{ "beq $t1, x, done", "lw $t0, x", "beq $t1, $t0, done" },
+		{ "add $a0, $zero, 0x7fffFF", "lw $t2, =8388607", "add $a0, $zero, $t2" },
+		//An explicit LW/SW still takes a number as the address.
+		{ "lw $a0, 8", "lw $a0, 8" }
+	};
+	for( uint32_t i = 0; i < sizeof( lines ) / sizeof( lines[0] ); i++ )
+	{
+		Parser p;
+		List<char *> expanded;
+		p.preprocessLine( &expanded, lines[i][0] );
+		int count = 1;
+		while( count < 5 && lines[i][count] != 0 )
+			count++;
+		assert( expanded.length() == count - 1 );
+		for( int j = 1; j < count; j++ )
+			assert( strcmp( expanded[j - 1]->getData(), lines[i][j] ) == 0 );
+	}
+}
+
+void testParserConstantPool()
+{
+	const char *lines[] = { "add $a0, $zero, 1000000",
+							"out 1000000",
+							"addi $a1, $a0, -600000",
+							"out x",
+							"halt" };
+	char name[] = "testParserPool.s";
+	writeLines( name, lines, 5 );
+
+	std::ostringstream log;
+	Parser p( name );
+	p.setLog( &log );
+	p.preprocess();
+	p.parse();
+	assert( p.getErrors() == 0 );
+
+	//Each value is in the pool once, right after the code and before x.
+	std::ifstream in( "testParserPool.s.bin" );
+	std::string line;
+	Array<uint32_t> words;
+	while( std::getline( in, line ) )
+		words.add( (uint32_t)strtoul( line.c_str(), 0, 16 ) );
+	uint32_t code = p.getCodeWords();
+	assert( words.length() == code + 3 );
+	assert( words[code] == 1000000 && words[code + 1] == (uint32_t)-600000 && words[code + 2] == 0 );
+
+	//lw $t2, =1000000 is found off of $fp like a variable.
+	InstructionUnion instruct;
+	instruct.binary = words[0];
+	assert( instruct.op == LW && instruct.y == 14 && instruct.value == (int32_t)code * 4 );
+	instruct.binary = words[2];
+	assert( instruct.op == LW && instruct.value == (int32_t)code * 4 );
+
+	remove( name );
+	remove( "testParserPool.s.bin" );
+
+	//A constant a word can not hold is reported, not wrapped.
+	std::ostringstream wide;
+	Parser q;
+	q.setLog( &wide );
+	Array<InstructionToken> expanded;
+	q.preprocessLine( expanded, "add $t0, $t1, 99999999999" );
+	q.preprocessLine( expanded, "add $t0, $t1, 4294967295" );
+	assert( q.getErrors() == 1 );
+	assert( wide.str().find( "Constant 99999999999 does not fit in a word" ) == 0 );
+
+	//Nor is one that is not all digits read as a wrong value.
+	std::ostringstream bad;
+	Parser r;
+	r.setLog( &bad );
+	Array<InstructionToken> none;
+	r.preprocessLine( none, "add $a0, $zero, 12abc" );
+	r.preprocessLine( none, "addi $a0, $zero, 0x" );
+	r.preprocessLine( none, "lw $a0, 0x1g($fp)" );
+	assert( r.getErrors() == 3 && none.length() == 0 );
+	assert( bad.str().find( "Bad constant 12abc in: " ) == 0 );
+}
+
+void testParserConstantScratch()
+{
+	//The constant is loaded into a scratch register the other source
+	//is not in.
+	const char *lines[] = { "addi $t2, $zero, 6",
+							"nand $a0, $t2, 3",
+							"out $a0",
+							"addi $t1, $zero, 6",
+							"add $a1, 1000000, $t1",
+							"out $a1",
+							"beq 6, $t1, same",
+							"halt",
+							"same: out $t1",
+							"halt" };
+	char name[] = "testParserScratch.s";
+	writeLines( name, lines, 10 );
+
+	std::ostringstream log;
+	Parser p( name );
+	p.setLog( &log );
+	p.preprocess();
+	p.parse();
+	assert( p.getErrors() == 0 );
+
+	Emulator emulator( 256 );
+	assert( emulator.load( "testParserScratch.s.bin" ) );
+	std::istringstream in;
+	std::ostringstream out;
+	assert( emulator.run( 1000, in, out ) );
+	assert( out.str() == "-3\n1000006\n6\n" );
+
+	remove( name );
+	remove( "testParserScratch.s.bin" );
+}
+
+void testParserCallFixup()
+{
+	const char *lines[] = { "jalr sub", "jalr x", "halt", "sub: jalr $ra, $zero" };
+	char name[] = "testParserCall.s";
+	writeLines( name, lines, 4 );
+
+	std::ostringstream log;
+	Parser p( name );
+	p.setLog( &log );
+	p.preprocess();
+	p.parse();
+	assert( p.getErrors() == 0 );
+
+	std::ifstream in( "testParserCall.s.bin" );
+	std::string line;
+	Array<uint32_t> words;
+	while( std::getline( in, line ) )
+		words.add( (uint32_t)strtoul( line.c_str(), 0, 16 ) );
+	assert( words.length() == 7 );
+
+	//A lable is called at its address, sub is the sixth word.
+	InstructionUnion instruct;
+	instruct.binary = words[0];
+	assert( instruct.op == ADDI && instruct.x == 12 && instruct.y == 0 && instruct.value == 20 );
+	instruct.binary = words[1];
+	assert( instruct.op == JALR && instruct.x == 12 && instruct.y == 15 );
+	//A variable is called at the address it holds, x is after the code.
+	instruct.binary = words[2];
+	assert( instruct.op == LW && instruct.x == 12 && instruct.y == 14 && instruct.value == 24 );
+
+	remove( name );
+	remove( "testParserCall.s.bin" );
+}
+
+#endif
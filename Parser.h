@@ -19,14 +19,38 @@
 #define __PARSER__
 
 #include <stdint.h>
+#include <string_view>
+#include <iosfwd>
+#include <chrono>
 #include "List.h"
+#include "Array.h"
+#include "Arena.h"
+#include "Cache.h"
 
 #define LINE 128
 #define NUM_PARAMS 3
+//Enough room for a lable, an opcode and every param of a token as text.
+#define FORMAT_LINE ( LINE * ( NUM_PARAMS + 2 ) )
+//Fewest bytes of source given to each chunk when assembling in parallel.
+#define PARALLEL_CHUNK ( 256 * 1024 )
+//Chunks made for each thread, so a slow chunk does not hold up the rest.
+#define CHUNKS_PER_THREAD 4
+//File name that reads the source from stdin and writes the output to stdout.
+#define STREAM_FILE "-"
+//Changed whenever the same source and options give different output, so
+//that files cached by an older assembler are not used.
+#define ASSEMBLER_VERSION 5
+//The values an ADDI can hold in its 20 bit signed field.
+#define MIN_IMMEDIATE -524288
+#define MAX_IMMEDIATE 524287
+//Starts the name of an entry in the constant pool, see fixAddresses().
+#define POOL_PREFIX '='
+//A param that is a number, negative or not, rather than a name.
+#define IS_CONSTANT( S ) ( isdigit( (S)[0] ) || ( (S)[0] == '-' && isdigit( (S)[1] ) ) )
 
 /*
     Instruction Types -- This is in a namespace because the names overlap the 
-    ParseStates
+    Symbols
 */
 namespace Types
 {
@@ -39,35 +63,45 @@ namespace Types
     }Type;
 }
 
+/*
+    Output Formats -- What parse() writes the assembled words as.
+*/
+namespace Formats
+{
+	typedef enum __format
+	{
+		HEX,//<file>.bin, a line of hex per word.
+		IMAGE//<file>.img, a packed binary image.
+	}Format;
+}
+
+/*
+    Phases -- The parts of a run that are timed, see getPhaseSeconds().
+*/
+namespace Phases
+{
+	typedef enum __phase
+	{
+		PREPROCESS,//preprocess(), reading and encoding the source.
+		LEX,//Lexing the lines, part of PREPROCESS, only timed for --stats.
+		COLLECT,//Collecting the symbols and fixups, writing the state.
+		FIX,//fixAddresses().
+		PRINT,//Writing the output file.
+		NUM_PHASES
+	}Phase;
+}
+
 namespace Symbols
 {
 	typedef enum __symbol
 	{
 		LABLE,
 		VARIABLE,
+		CONSTANT,//An entry in the constant pool, its name is POOL_PREFIX and the value.
 		UNKNOWN
 	}Symbol;
 }
 
-/*
-    Parser States enum -- This is in a namespace because the names overlap the
-    Types
-*/
-namespace ParseStates
-{
-    typedef enum __parsestate
-    {
-        START,
-        WHITESPACE,
-        ALPHA,
-        LABLE,
-        COMMENT,
-        INSTRUCT,
-        PARAMS,
-        HALT
-    }ParseState;
-}
-
 /*
     Opcode values - prevents coder error and enforces that these are the only
     valid opcode values. ADD = 0 ... HALT = 7
@@ -87,7 +121,7 @@ typedef enum
     NONE
 }Opcode;
 
-static char *OpcodeStrings[] = 
+static constexpr const char *OpcodeStrings[] = 
 {
 	"add", 
 	"nand", 
@@ -101,6 +135,24 @@ static char *OpcodeStrings[] =
 	"out"
 };
 
+//Register names in the order of their 4bit codes.
+#define NUM_REGISTERS 16
+static constexpr const char *RegisterStrings[NUM_REGISTERS] =
+{
+	"$zero", "$at", "$v0", "$a0", "$a1", "$a2", "$t0", "$t1",
+	"$t2", "$s0", "$s1", "$s2", "$k0", "$sp", "$fp", "$ra"
+};
+
+//Names of the phases as --stats prints them.
+static constexpr const char *PhaseStrings[] =
+{
+	"preprocess",
+	"lex",
+	"collectSymbols",
+	"fixAddresses",
+	"print"
+};
+
 #define GetOpCodeString( op ) ( op <= 9 ? OpcodeStrings[op]: "Invalid" )
 
 /*
@@ -115,10 +167,32 @@ typedef struct __symbol
 	uint32_t address;
 }ParseSymbol;
 
-// PRE: This function has 'a' and 'b' defined.
-// POST: This will return 0 if the two symbol names are equal and nonzero 
-//		if they are not.
-int compareSymbols( ParseSymbol a, ParseSymbol b );
+/*
+	Fixup kinds -- Which field of the instruction a symbol operand lands in.
+*/
+namespace Fixups
+{
+	typedef enum __fixupkind
+	{
+		MEMORY,//LW/SW, the value is the address of the symbol off of $fp.
+		BRANCH,//BEQ, the value is the offset from the next instruction.
+		ADDRESS,//ADDI, the value is the address of the symbol.
+		CALL//The LW into $k0 of jalr <name>, see fixAddresses().
+	}FixupKind;
+}
+
+/*
+
+	Fixup holds one operand that names a symbol, it is patched once all
+	of the symbol addresses are known.
+
+*/
+typedef struct __fixup
+{
+	uint32_t token;//Index of the instruction in mTokens.
+	uint32_t symbol;//Index of the symbol in mSymbols.
+	Fixups::FixupKind kind;
+}Fixup;
 
 /*
 
@@ -175,19 +249,30 @@ typedef struct __instructtoken
     Instruction instruct;//Binary representation of this instruction.
 }InstructionToken;
 
+class SymbolTable;
+class TokenStore;
+class Emitter;
+class IncrementalState;
+class Peephole;
+
 class Parser
 {
     public:
 		// PRE: Default constructor
 		// POST: This object will be defined.
-		Parser(){};
+		Parser();
         // PRE: file is defined.
-        // POST: A file handle of "file" will be opened.
+        // POST: A file handle of "file" will be opened. If file is
+        //		STREAM_FILE the source is read from stdin and the output
+        //		is written to stdout, no .pre is written.
         Parser( char *file );
+		// PRE: This object is defined.
+		// POST: The symbol table and token store are released.
+		~Parser();
 
         // PRE: This object is defined. 
 		// POST: This happens after the file is preprocess'ed.
-		//		It will take the preprocessed file and output a
+		//		It will take the preprocessed instructions and output a
 		//		.bin file that will contain the hex results of the
 		//		program.
         void parse();
@@ -196,12 +281,142 @@ class Parser
 		// POST: The file that was passed to the parser will have been
 		//		preprocessed.  Which will mean that the nessecary 
 		//		substitution and instruction expansions will have taken
-		//		place and they will be output to a file with .pre
-		//		appended to the original file name.
+		//		place and the resulting instructions are encoded into
+		//		mTokens. If the .pre output is turned on they are also
+		//		written to a file with .pre appended to the original file
+		//		name.
 		void preprocess();
 
 		// PRE: This object is defined.
-		// POST: The mTokens list will be printed in HEX to mFileOutput.
+		// POST: If write is true then preprocess() will also write the
+		//		expanded assembly to the .pre file, this is off by default
+		//		as it is only needed for debugging.
+		void setWritePreProcessed( bool write ) { mWritePreProcessed = write; }
+
+		// PRE: This object is defined.
+		// POST: parse() will write its output in format, HEX is the default.
+		void setOutputFormat( Formats::Format format );
+
+		// PRE: This object is defined.
+		// POST: preprocess() will split a large file into chunks that are
+		//		assembled on threads threads, 0 means one per core. The
+		//		output is the same as with the default of 1.
+		void setThreads( uint32_t threads ) { mThreads = threads; }
+
+		// PRE: This object is defined.
+		// POST: If incremental is true then parse() keeps what it found in
+		//		<file>.state and the next preprocess() only encodes the lines
+		//		that changed since, see Incremental.h. The output is the same
+		//		as without it. Streaming ignores this, and so does a source
+		//		that can not be mapped.
+		void setIncremental( bool incremental );
+
+		// PRE: This object is defined.
+		// POST: If level is 1 or more then preprocess() leaves out the
+		//		loads and stores that the expansions repeat, and from 2 it
+		//		also promotes variables into free registers, see
+		//		Optimizer.h. A file is then always assembled in one piece
+		//		and without the state.
+		void setOptimize( uint32_t level );
+
+		// PRE: This object is defined.
+		// POST: If strip is true then preprocess() leaves out the code that
+		//		can not be reached from the first word or a root, and the
+		//		variables only it named, see Optimizer.h. A file is then
+		//		always assembled in one piece and without the state.
+		void setStrip( bool strip );
+
+		// PRE: This object is defined and lable lives as long as this
+		//		object.
+		// POST: The code from lable on is kept by setStrip() as if it were
+		//		reached.
+		void addRoot( const char *lable );
+
+		// PRE: This object is defined and preprocess() has been called.
+		// POST: The RV is the number of loads and stores the optimizer
+		//		left out.
+		uint32_t getRemovedWords() const { return mRemovedLoads + mRemovedStores; }
+
+		// PRE: This object is defined and preprocess() has been called.
+		// POST: The RV is the number of variables the optimizer promoted
+		//		into registers.
+		uint32_t getPromoted() const { return mPromoted; }
+
+		// PRE: This object is defined and preprocess() has been called.
+		// POST: The RV is the number of words setStrip() left out.
+		uint32_t getUnreachable() const { return mUnreachable; }
+
+		// PRE: This object is defined and preprocess() has been called.
+		// POST: The RV is the number of lines taken from the state rather
+		//		than encoded.
+		uint32_t getReusedLines() const { return mReusedLines; }
+
+		// PRE: This object is defined, cache is 0 or lives as long as this
+		//		object.
+		// POST: preprocess() looks for the source in cache and when it is
+		//		there parse() copies the files out of it. A source that is
+		//		assembled without problems is stored in it, see Cache.h.
+		//		Streaming ignores this, and so does a source that can not
+		//		be mapped.
+		void setCache( const Cache *cache ) { mCache = cache; }
+
+		// PRE: This object is defined and preprocess() has been called.
+		// POST: The RV is true if the files came out of the cache.
+		bool wasCached() const { return mCached != 0; }
+
+		// PRE: This object is defined as is log.
+		// POST: Problems with the source and files are reported to log
+		//		rather than cout.
+		void setLog( std::ostream *log ) { mLog = log; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of problems reported so far.
+		uint32_t getErrors() const { return mErrors; }
+
+		// PRE: This object is defined.
+		// POST: The RV is true if parse() wrote the whole output file.
+		bool wasWritten() const { return mWritten; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the name of the output file.
+		const char *getOutputFile() const { return mOutputFile; }
+
+		// PRE: This object is defined and parse() has been called.
+		// POST: The RV is the number of words of code, the rest are data.
+		uint32_t getCodeWords() const { return mCodeWords; }
+
+		// PRE: This object is defined and parse() has been called.
+		// POST: The RV is the number of words in the image.
+		uint32_t getWordCount() const { return mWordCount; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the wall clock seconds the last preprocess() or
+		//		parse() spent in phase, 0 if it has not run.
+		double getPhaseSeconds( Phases::Phase phase ) const { return mPhaseSeconds[phase]; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the CPU seconds the process, all of its threads,
+		//		spent in phase. LEX is only timed by the wall clock.
+		double getPhaseCpuSeconds( Phases::Phase phase ) const { return mPhaseCpuSeconds[phase]; }
+
+		// PRE: This object is defined.
+		// POST: If stats is true the lexing of each line is timed as well,
+		//		for printStats().
+		void setStats( bool stats ) { mStats = stats; }
+
+		// PRE: This object is defined and parse() has been called.
+		// POST: The time of each phase, the counts of what was assembled
+		//		and the peak memory of the process are written to out, as
+		//		one line of JSON if json is true.
+		void printStats( std::ostream &out, bool json );
+
+		// PRE: This object is defined and fixAddresses() has been called.
+		// POST: The mTokens words are written to mOutputFile as a packed
+		//		image, see Image.h.
+		void printImageToFile();
+
+		// PRE: This object is defined.
+		// POST: The mTokens words will be printed in HEX to mFileOutput.
 		//		Where each line contains one word.
 		void printHexToFile();
 
@@ -212,14 +427,35 @@ class Parser
         //         the parse sets the proper error messaage and enters a error 
         //         state.
         //            This error state will halt parsing.
-        InstructionToken parseLine( char *line, uint32_t lastAddress );
+        InstructionToken parseLine( std::string_view line, uint32_t lastAddress );
+
+		// PRE: This object, line and token are defined.
+		// POST: token is overwritten with line parsed at address, as
+		//		parseLine() above returns it, without building a copy.
+		void parseLine( std::string_view line, uint32_t address, InstructionToken &token );
 
 		// PRE: This object and line are defined.  The line will be processed,
 		//		and if needed will be expanded into the proper format, as we
 		//		discussed in class.
-		// POST: list will contain the expanded lines if any expansion needs to
-		//		happen.  Else it will contain the original line.
-		void preprocessLine( List<char *> *list, char *line );
+		// POST: tokens will have the expanded instructions appended to it,
+		//		each one already encoded and ready to be added to mTokens.
+		void preprocessLine( Array<InstructionToken> &tokens, std::string_view line );
+
+		// PRE: This object and line are defined.
+		// POST: list will contain the text of the expanded lines, in the same
+		//		format that is written to the .pre file. The text lives in the
+		//		arena of this parser and is released with it.
+		void preprocessLine( List<char *> *list, std::string_view line );
+
+		// PRE: This object is defined.
+		// POST: The RV is the arena that holds the memory of this run, a
+		//		List given it for its links is released with the parser.
+		Arena *getArena() { return &mArena; }
+
+		// PRE: This object and token are defined, line can hold FORMAT_LINE
+		//		chars.
+		// POST: line holds the assembly text for token.
+		void formatToken( const InstructionToken &token, char *line );
 
         // PRE: This object is defined and mTokens is defined.
         // POST: The vector<Instruction> mTokens is returned that 
@@ -252,213 +488,232 @@ class Parser
         //        J-type
         //<original line>
         //Opcode: <opcode binary>, Reg. X: <binary X>, Variable: <var name>
-        void printInstruction( InstructionToken token );
+        void printInstruction( const InstructionToken &token );
 
     private:
         // PRE: This object is defined and as is value.
         // POST: The OS will have the binary representation of value.
         void printBinary( uint32_t value );
 
-        // PRE: This object is defined and c is defined.
-        // POST: Based on the char c the proper opcode is returned, this is a 
-        //       base guess on what
-        //         the final opcode will be for this instruction.
-        Opcode getOpcode( char c );
-
-        // PRE: This object is defined. This will parse out the opcode and if 
-        //      need also the label.
-        // POST: The contents of token will be updated to reflect the opcode
-        //       mnumonic and or if there is a lable also
-        //         update this value as well.
-        void parseOpcodeLabel( char c, Opcode &op, 
-            ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined. The current char c and the current 
-        //      state are both defined.
-        // POST: The next parse state will be in state.
-        void getState( char c, ParseStates::ParseState &state );
-
-        // PRE: This object, c, op, state, and token are defined.
-        // POST: The proper action based on the current op will be performed
-        //       and state and token    will have the
-        //         nesscary changes made to them.
-        void parseOpcode( char c, Opcode &op, 
-            ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined as are c, op, state, token. 
-        // POST: Giving the op the proper parsing function is called to parse
-        //       the correct params. There are four
-        //         different functions that can be called.
-        //         Three Register opcodes.
-        //         Two register and Value opcodes.
-        //         One register and a offset of a register opcode..
-        //         Two register opcodes.
-        //         No register or params and thus require no parsing.
-        void parseParams( char c, Opcode &op, 
-            ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: this object, c, op, state, and token are defined.
-        // POST: If c is a : then the proper values are changed in token and
-        //       state to reflect this.  Token
-        //         also gets a copy of the lable value for later recall.
-        void parseLable( char c, Opcode &op,
-             ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined and c, op, state, and token are also 
-        //      defined.
-        // POST: The continuation or starting of the parse iff op = ADD | NAND.
-        //       The values in token and state 
-        //         will be reflected accordingly.
-        void parseThreeRegisterParams( char c, Opcode &op,
-             ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined and c, op, state, and token are also 
-        //      defined.
-        // POST: The continuation or starting of the parse iff op = ADDI | BEQ.
-        void parseTwoRegisterValueParams( char c, Opcode &op,
-             ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined and c, op, state, and token are also 
-        //      defined.
-        // POST: The continuation or starting of the parse iff op = LW | SW. 
-        //       The values in token and state 
-        //         will be reflected accordingly.
-        void parseOneRegisterOffsetRegister( char c, Opcode &op,
-             ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined and c, op, state, and token are also 
-        //      defined.
-        // POST: The continuation or starting of the parse iff op = JALR. 
-        //       The values in token and state 
-        //         will be reflected accordingly.
-        void parseTwoRegisterParams( char c, Opcode &op,
-             ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined and c, op, state, and token are also 
-        //      defined.
-        // POST: The continuation or starting of the parse iff op = IN|OUT. 
-        //       The values in token and state 
-        //         will be reflected accordingly.
-		void parseSingleRegisterParams( char c, Opcode &op, 
-			 ParseStates::ParseState &state, InstructionToken &token );
-
         // PRE: This object is defined and token was gotten from parseLine.
         // POST: The token will have its Instruction structure filled in with 
-        //       the relavant information.
+        //       the relavant information. If a param names a register that
+        //       does not exist the token is reported and its type is NONE.
         void finalizeToken( InstructionToken &token );
 
-        // PRE: This object is defined and the registerStr is defined as well.
-        // POST: The RV is the 4bit code for the specific register.
+        // PRE: This object is defined and the registername is defined as well.
+        // POST: The RV is the 4bit code for the register. A param that is
+        //       empty or not a register is 0, and a name that starts with a
+        //       '$' but is not a register is NO_REGISTER.
         uint32_t getRegisterCode( const char *registername );
 
-        /*
-            Opcode specific parsing functions.
-        */
-        // PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete teh opcode mnumonic then 
-        //       state remains in its current state and
-        //       op remains in ADD, and token is updated accordingly. The 
-        //       values in token and state 
-        //         will be reflected accordingly.
-        void parseADD( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete the opcode mnumonic then 
-        //       state remains in its current state and
-        //         op remains in LW, and token is updated accordingly.
-        void parseLW( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete the opcode mnumonic then 
-        //       state remains in its current state and
-        //         op remains in BEQ, and token is updated accordingly.
-        void parseBEQ( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete the opcode mnumonic then 
-        //       state remains in its current state and
-        //         op remains in NAND, and token is updated accordingly.
-        void parseNAND( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete the opcode mnumonic then 
-        //       state remains in its current state and
-        //         op remains in JALR, and token is updated accordingly.
-        void parseJALR( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-        // PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete the opcode mnumonic then
-        //       state remains in its current state and
-        //         op remains in HALT, and token is updated accordingly.
-        void parseHALT( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-		// PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete the opcode mnumonic then
-        //       state remains in its current state and
-        //         op remains in IN, and token is updated accordingly.
-        void parseIN( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-		// PRE: This object is defined as are c, op, state, token.
-        // POST: If the current c helps to complete the opcode mnumonic then
-        //       state remains in its current state and
-        //         op remains in OUT, and token is updated accordingly.
-        void parseOUT( char c, Opcode &op,
-         ParseStates::ParseState &state, InstructionToken &token );
-
-		// PRE: This object is defined, list and token are defined.
-		//		list is empty.
-		// POST: The preprocessing is handled and list contains the new lines.
-		//		these new lines contain the substitution's and expansions.
-		void preprocessThreeRegister( List<char *> *list, InstructionToken token );
-
-		// PRE: This object is defined, list and token are defined.
-		//		list is empty.
-		// POST: The preprocessing is handled and list contains the new lines.
-		//		these new lines contain the substitution's and expansions.
-		void preprocessTwoRegister( List<char *> *list, InstructionToken token );
-
-		// PRE: This object is defined, list and token are defined.
-		//		list is empty.
-		// POST: The preprocessing is handled and list contains the new lines.
-		//		these new lines contain the substitution's and expansions.
-		void preprocessTwoRegistersOffset( List<char *> *list, InstructionToken token );
-
-		// PRE: This object is defined, list and token are defined.
-		//		list is empty.
-		// POST: The preprocessing is handled and list contains the new lines.
-		//		these new lines contain the substitution's and expansions.
-		void preprocessTwoRegistersOffsetStore( List<char *> *list, InstructionToken token );
-
-		// PRE: This object is defined, list and token are defined.
-		//		list is empty.
-		// POST: The preprocessing is handled and list contains the new lines.
-		//		these new lines contain the substitution's and expansions.
-		void preprocessSingleRegister( List<char *> *list, InstructionToken token );
-
-		// PRE: Ths object is defined as are token and PC.
-		// POST: The specific symbol in token will be added to mSymbols.
+		// PRE: This object is defined, tokens and token are defined.
+		// POST: The preprocessing is handled and tokens contains the new
+		//		instructions. These contain the substitution's and expansions.
+		void preprocessThreeRegister( Array<InstructionToken> &tokens, const InstructionToken &token );
+
+		// PRE: This object is defined, tokens and token are defined.
+		// POST: The preprocessing is handled and tokens contains the new
+		//		instructions. These contain the substitution's and expansions.
+		void preprocessTwoRegister( Array<InstructionToken> &tokens, const InstructionToken &token );
+
+		// PRE: This object is defined, tokens and token are defined.
+		// POST: The preprocessing is handled and tokens contains the new
+		//		instructions. These contain the substitution's and expansions.
+		void preprocessTwoRegistersOffset( Array<InstructionToken> &tokens, const InstructionToken &token );
+
+		// PRE: This object is defined, tokens and token are defined.
+		// POST: The preprocessing is handled and tokens contains the new
+		//		instructions. These contain the substitution's and expansions.
+		void preprocessTwoRegistersOffsetStore( Array<InstructionToken> &tokens, const InstructionToken &token );
+
+		// PRE: This object is defined, tokens and token are defined.
+		// POST: The preprocessing is handled and tokens contains the new
+		//		instructions. These contain the substitution's and expansions.
+		void preprocessSingleRegister( Array<InstructionToken> &tokens, const InstructionToken &token );
+
+		// PRE: This object is defined, tokens is defined, reg is a
+		//		register and param is a param that is not one.
+		// POST: The expansion that puts the value of param into reg is
+		//		added to tokens. A constant that fits is added to $zero by
+		//		an ADDI, one that does not is loaded from its entry in the
+		//		constant pool and a variable is loaded from its slot.
+		void addLoad( Array<InstructionToken> &tokens, const char *reg, const char *param );
+
+		// PRE: This object is defined, tokens, op and the params are defined.
+		//		lable is 0 if the instruction does not have one.
+		// POST: A new instruction is encoded and appended to tokens.
+		void addExpansion( Array<InstructionToken> &tokens, Opcode op, const char *lable,
+						   const char *first, const char *second, const char *third );
+
+		// PRE: Ths object is defined and index < mTokens->length().
+		// POST: The specific symbol in the token will be added to mSymbols.
 		//		If the symbols to be added was thought to be a label, but is
 		//		in fact a variable this will be changed.
-		void addSymbol( InstructionToken token, uint32_t PC );
+		void addSymbol( uint32_t index );
+
+		// PRE: This object is defined, index < mTokens->length() and the
+		//		symbols of the token have been added to mSymbols.
+		// POST: If the token is a LW/SW/BEQ whose operand names a symbol then
+		//		a fixup for it is added to mFixups, as is one for an ADDI whose
+		//		value names a symbol.
+		void addFixup( uint32_t index );
+
+		// PRE: This object is defined, tokens is scratch space and PC is the
+		//		address of the next word.
+		// POST: The instructions line expands to are encoded and added to
+		//		mTokens and PC is moved past them, less the ones the
+		//		optimizer leaves out. If pre is not 0 their text is written
+		//		to it.
+		void encodeLine( std::string_view line, Array<InstructionToken> &tokens,
+						 uint32_t &PC, std::ostream *pre );
+
+		// PRE: This object is defined, every line has been encoded into
+		//		mTokens by encodeLine and optimizing() is true.
+		// POST: With setStrip() the code that can not be reached is removed
+		//		from mTokens, then the loads and stores that do nothing on
+		//		every path to them are and at level 2 variables are
+		//		promoted, see Optimizer.h. If pre is not 0 the text of the
+		//		words that are left is written to it.
+		void optimize( std::ostream *pre );
+
+		// PRE: This object is defined.
+		// POST: The RV is true if optimize() runs after the lines are
+		//		encoded.
+		bool optimizing() const { return mPeephole != 0 || mStrip; }
+
+		// PRE: This object is defined, index < the words in mTokens and
+		//		line holds FORMAT_LINE chars.
+		// POST: line is the text of the word at index, from its fields as
+		//		the optimizer made it.
+		void formatWord( uint32_t index, char *line );
+
+		// PRE: This object is defined and text holds whole lines.
+		// POST: Every line of text is encoded into mTokens starting at
+		//		address 0. If pre is not 0 their text is written to it.
+		void preprocessText( std::string_view text, std::ostream *pre );
+
+		// PRE: This object is defined and text is the whole source.
+		// POST: text is split into chunks of whole lines that are encoded
+		//		and have their symbols collected on a ThreadPool. The chunks
+		//		are merged into this parser in order, so mTokens, mSymbols
+		//		and mFixups are the same as after the sequential path.
+		void preprocessParallel( std::string_view text, std::ostream *pre );
+
+		// PRE: This object is defined, mState is not 0 and text is the
+		//		whole source.
+		// POST: The lines of text that match the start and end of the last
+		//		state are taken from it and the rest are encoded, so mTokens
+		//		is the same as after the sequential path. Every line is
+		//		recorded in mState. If pre is not 0 the state is not used
+		//		so that every line is written to it.
+		void preprocessIncremental( std::string_view text, std::ostream *pre );
+
+		// PRE: This object is defined, mCache is not 0 and text is the
+		//		whole source.
+		// POST: mCacheKey is the key of text. If it is in the cache then
+		//		mCached holds the entry and the .pre is written to pre when
+		//		it is not 0, the RV is true.
+		bool fetchCached( std::string_view text, std::ostream *pre );
+
+		// PRE: This object is defined and mCached holds an entry.
+		// POST: The output file of the entry is written to mOutputFile.
+		void printCachedToFile();
+
+		// PRE: This object is defined, mState has the last state open and
+		//		its words up to mResumeWord are in mTokens.
+		// POST: mSymbols, mFixups and mState hold what collecting the
+		//		words before mResumeWord gives, without looking at them.
+		void restoreSymbols();
+
+		// PRE: context is the array of chunks given to preprocessParallel.
+		// POST: The chunk at index is encoded and its symbols collected.
+		static void assembleChunk( uint32_t index, void *context );
+
+		// PRE: This object and chunk are defined, chunk has collected its
+		//		symbols and follows the words already in mTokens.
+		// POST: The words of chunk are appended with their addresses moved
+		//		past the words already here. The symbols of chunk are added as
+		//		addSymbol would have, and its fixups are moved onto the merged
+		//		tokens and symbols.
+		void mergeChunk( Parser &chunk );
+
+		// PRE: This object is defined and preprocess() has been called.
+		// POST: The symbols and fixups of every word in mTokens are collected.
+		void collectSymbols();
 
 		// PRE: This object is defined, this will only be called from parse().
-		// POST: The addresses in the symbol table for variables will be adjusted.
-		//		And, mTokens will be updated to reflect the actual memory locations.
+		// POST: The constant pool and then the variables are given words
+		//		after the code and their addresses in the symbol table. And,
+		//		every fixup in mFixups is patched with the actual memory
+		//		location of its symbol. The LW of a call to a lable becomes
+		//		an ADDI of its address.
 		void fixAddresses();
 
-        char mFileName[256];
-		char mPreProcessedFile[256];
-		char mOutputFile[256];
-
-		List<ParseSymbol> *mSymbols;
-		List<InstructionToken> mTokens;
+		// PRE: This object is defined.
+		// POST: The clocks are read for the phase that starts now.
+		void startPhase();
+
+		// PRE: This object is defined and startPhase() has been called.
+		// POST: The time since startPhase() is kept as the time of phase.
+		void endPhase( Phases::Phase phase );
+
+		// PRE: This object is defined as is file.
+		// POST: mFileName is file and the names of the files made from it are
+		//		set, they are kept in mArena so a name of any length fits.
+		void setFileName( const char *file );
+
+		// PRE: This object and emitter are defined.
+		// POST: emitter writes to mOutputFile, or to stdout when streaming.
+		//		The RV is false if mOutputFile could not be opened.
+		bool openOutput( Emitter &emitter );
+
+		char *mFileName;
+		char *mPreProcessedFile;
+		char *mOutputFile;
+
+		SymbolTable *mSymbols;
+		bool mWritePreProcessed;//Write the .pre file while preprocessing.
+		bool mPreprocessed;//preprocess() was able to read the file.
+		Formats::Format mOutputFormat;
+		uint32_t mCodeWords;//Words of code before the variables.
+		uint32_t mThreads;
+		bool mCollected;//The symbols and fixups are already collected.
+		bool mWritten;//parse() wrote the whole output file.
+		bool mStream;//Read stdin and write stdout, see STREAM_FILE.
+		char *mStateFile;
+		IncrementalState *mState;//0 unless assembling incrementally.
+		uint32_t mResumeWord;//First word whose symbols are collected again.
+		uint32_t mReusedLines;
+		const Cache *mCache;
+		CacheEntry *mCached;//The entry the files come from, or 0.
+		CacheKey mCacheKey;
+		bool mKeyed;//mCacheKey is the key of the source.
+		uint32_t mWordCount;
+		uint32_t mErrors;//Problems reported to mLog.
+		InstructionToken mLine;//The line preprocessLine() is expanding.
+		double mPhaseSeconds[Phases::NUM_PHASES];
+		double mPhaseCpuSeconds[Phases::NUM_PHASES];
+		std::chrono::steady_clock::time_point mPhaseStart;//Clocks read by startPhase().
+		double mPhaseCpuStart;
+		bool mStats;//Time the lexer too, see setStats().
+		bool mLexSummed;//The lexing was timed on several threads at once.
+		uint32_t mEncodedLines;//Lines lexed and encoded, not reused.
+		uint32_t mExpandedLines;//Instructions preprocessLine() gave for them.
+		uint32_t mOptimize;//The level, see setOptimize().
+		Peephole *mPeephole;//0 unless optimizing.
+		uint32_t mRemovedLoads;//LWs the optimizer left out.
+		uint32_t mRemovedStores;//SWs the optimizer left out.
+		uint32_t mPromoted;//Variables the optimizer put in registers.
+		bool mStrip;//See setStrip().
+		uint32_t mUnreachable;//Words setStrip() left out.
+		Array<const char *> mRoots;//Lables setStrip() keeps, see addRoot().
+		Array<char *> mPreLines;//The .pre text of each word while optimizing.
+		std::ostream *mLog;//Where problems with the source are reported.
+
+		TokenStore *mTokens;
+		Array<Fixup> mFixups;
+		Arena mArena;//Text handed out by preprocessLine, freed in one go.
 };
 
 /*
@@ -477,6 +732,11 @@ void testParserOUT();
 void testParserBEQ();
 // Tests if the parser handles labels correctly.
 void testParserLabel();
+// Tests that unknown mnemonics and registers, names too long to keep and
+// lines with too many operands are rejected.
+void testParserUnknownNames();
+// Tests parsing a line over a token that held a longer one.
+void testParserInPlace();
 // Tests the preprocessing on the IN instruction when its second param
 // is a variable.
 void testParserSingleRegisterReplacementINX();
@@ -485,6 +745,9 @@ void testParserSingleRegisterReplacementINX();
 void testParserSingleRegisterReplacementOUTX();
 // Tests two register instructions where the second register is a variable.
 void testParserTwoRegisterReplacementX();
+// Tests that a call to a lable takes its address and one to a variable
+// the address it holds.
+void testParserCallFixup();
 // Tests single variable replace on three register instructions.
 void testParserVariableRegisterReplacementX();
 // Tests double variable replace on three register instructions.
@@ -493,6 +756,24 @@ void testParserVariableRegisterReplacementXY();
 void testParserVariableRegisterReplacementXYZ();
 // Tests the handling of two register instruction with offset.
 void testParserTwoRegisterReplacementOffset();
+// Tests that constants that fit are folded into an ADDI.
+void testParserConstantFolding();
+// Tests that wider constants are loaded from one pool entry each and
+// that those a word can not hold or that are not numbers are reported.
+void testParserConstantPool();
+// Tests that a program whose constants are loaded next to a source in a
+// scratch register runs right.
+void testParserConstantScratch();
+// Tests that assembling in parallel chunks gives the same files.
+void testParserParallel();
+// Tests that a source read from stdin gives the same words on stdout.
+void testParserStream();
+// Tests that reassembling from the state gives the same files after edits.
+void testParserIncremental();
+// Tests that a cached source gives the same files without assembling it.
+void testParserCache();
+// Tests the counts printed by --stats and --stats-json.
+void testParserStats();
 #endif
 
 #endif
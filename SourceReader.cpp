@@ -0,0 +1,204 @@
+#include "SourceReader.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// PRE: This object is not defined.
+// POST: This object is defined and has no file.
+SourceReader::SourceReader(): mFile( -1 ), mOwned( false ), mMapped( false ), mEnd( true ), mData( 0 ),
+							  mSize( 0 ), mCapacity( 0 ), mPosition( 0 )
+{}
+
+// PRE: This object is defined.
+// POST: The file is closed and any mapping or buffer is released.
+SourceReader::~SourceReader()
+{
+	close();
+}
+
+// PRE: This object and file are defined.
+// POST: The RV is true if file could be opened for reading.
+bool SourceReader::open( const char *file )
+{
+	close();
+	mFile = ::open( file, O_RDONLY );
+	if( mFile < 0 )
+		return false;
+	mOwned = true;
+
+	struct stat info;
+	if( fstat( mFile, &info ) == 0 && S_ISREG( info.st_mode ) && info.st_size > 0 )
+	{
+		void *map = mmap( 0, info.st_size, PROT_READ, MAP_PRIVATE, mFile, 0 );
+		if( map != MAP_FAILED )
+		{
+			madvise( map, info.st_size, MADV_SEQUENTIAL );
+			mData = (char *)map;
+			mSize = info.st_size;
+			mMapped = true;
+		}
+	}
+
+	if( !mMapped )
+	{
+		mCapacity = READ_BLOCK;
+		mData = new char[mCapacity];
+		mEnd = false;
+	}
+
+	return true;
+}
+
+// PRE: This object is defined and fd is open for reading.
+// POST: Lines are read from fd in blocks, fd is not closed by the
+//		reader.
+void SourceReader::attach( int fd )
+{
+	close();
+	mFile = fd;
+	mCapacity = READ_BLOCK;
+	mData = new char[mCapacity];
+	mEnd = false;
+}
+
+// PRE: This object is defined.
+// POST: The file is closed and any mapping or buffer is released.
+void SourceReader::close()
+{
+	if( mMapped )
+		munmap( mData, mSize );
+	else
+		delete [] mData;
+
+	if( mFile >= 0 && mOwned )
+		::close( mFile );
+
+	mFile = -1;
+	mOwned = false;
+	mMapped = false;
+	mEnd = true;
+	mData = 0;
+	mSize = mCapacity = mPosition = 0;
+}
+
+// PRE: This object is defined and is reading blocks.
+// POST: The unread part of the buffer is moved to the front and
+//		more of the file is read after it. The RV is false when
+//		nothing more could be read.
+bool SourceReader::fill()
+{
+	size_t remaining = mSize - mPosition;
+	memmove( mData, mData + mPosition, remaining );
+	mSize = remaining;
+	mPosition = 0;
+
+	//A line longer than the buffer needs a bigger buffer.
+	if( mSize == mCapacity )
+	{
+		char *temp = new char[mCapacity * 2];
+		memcpy( temp, mData, mSize );
+		delete [] mData;
+		mData = temp;
+		mCapacity *= 2;
+	}
+
+	ssize_t count;
+	do
+		count = read( mFile, mData + mSize, mCapacity - mSize );
+	while( count < 0 && errno == EINTR );
+
+	if( count <= 0 )
+		mEnd = true;
+	else
+		mSize += count;
+
+	return count > 0;
+}
+
+// PRE: This object is defined and a file is open.
+// POST: If there is another line then line views it, without the
+//		'\n', and the RV is true. Else the RV is false.
+bool SourceReader::nextLine( std::string_view &line )
+{
+	const char *newline = 0;
+	size_t scanned = 0;//Bytes after mPosition already known to have no '\n'.
+	while( true )
+	{
+		newline = (const char *)memchr( mData + mPosition + scanned, '\n', mSize - mPosition - scanned );
+		if( newline != 0 || mEnd )
+			break;
+		scanned = mSize - mPosition;
+		if( !fill() )
+			break;
+	}
+
+	if( newline == 0 && mPosition == mSize )
+		return false;
+
+	const char *start = mData + mPosition;
+	size_t length = newline != 0 ? newline - start : mSize - mPosition;
+	line = std::string_view( start, length );
+	mPosition += length + ( newline != 0 ? 1 : 0 );
+	return true;
+}
+
+#ifdef TESTING
+#include <assert.h>
+#include <stdio.h>
+#include <sys/wait.h>
+
+void testSourceReaderLines()
+{
+	const char *name = "testSourceReader.tmp";
+	FILE *file = fopen( name, "w" );
+	fputs( "add $t0, $t1, $t2\n\nhalt", file );
+	fclose( file );
+
+	SourceReader reader;
+	std::string_view line;
+	assert( reader.open( name ) );
+	assert( reader.isMapped() );
+	assert( reader.nextLine( line ) && line == "add $t0, $t1, $t2" );
+	assert( reader.nextLine( line ) && line == "" );
+	assert( reader.nextLine( line ) && line == "halt" );
+	assert( !reader.nextLine( line ) );
+	reader.close();
+	remove( name );
+}
+
+void testSourceReaderLongLine()
+{
+	//A pipe can not be mapped so this goes through the block buffer.
+	int pipes[2];
+	assert( pipe( pipes ) == 0 );
+	if( fork() == 0 )
+	{
+		::close( pipes[0] );
+		char *text = new char[READ_BLOCK * 3];
+		memset( text, 'a', READ_BLOCK * 3 );
+		text[READ_BLOCK * 3 - 1] = '\n';
+		write( pipes[1], "halt\n", 5 );
+		write( pipes[1], text, READ_BLOCK * 3 );
+		write( pipes[1], "out $v0", 7 );
+		_exit( 0 );
+	}
+	::close( pipes[1] );
+
+	char name[64];
+	sprintf( name, "/dev/fd/%d", pipes[0] );
+	SourceReader reader;
+	std::string_view line;
+	assert( reader.open( name ) );
+	assert( !reader.isMapped() );
+	assert( reader.nextLine( line ) && line == "halt" );
+	assert( reader.nextLine( line ) && line.length() == READ_BLOCK * 3 - 1 );
+	assert( reader.nextLine( line ) && line == "out $v0" );
+	assert( !reader.nextLine( line ) );
+	reader.close();
+	::close( pipes[0] );
+	wait( 0 );
+}
+#endif
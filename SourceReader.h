@@ -0,0 +1,85 @@
+/*
+    SourceReader: Hands out the lines of a source file without copying them.
+
+    A regular file is mapped into memory and each line is a view straight
+    into the mapping. Anything that can not be mapped, such as a pipe, is
+    read in large blocks instead and the lines are views into the block
+    buffer, as is a descriptor handed to attach() such as stdin. In both
+    cases a view is only good until the next call to nextLine(). Lines are
+    not limited in length.
+*/
+
+#ifndef __SOURCEREADER__
+#define __SOURCEREADER__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+
+//Size of the blocks read when the file can not be mapped.
+#define READ_BLOCK ( 1 << 20 )
+
+class SourceReader
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined and has no file.
+		SourceReader();
+		// PRE: This object is defined.
+		// POST: The file is closed and any mapping or buffer is released.
+		~SourceReader();
+
+		// PRE: This object and file are defined.
+		// POST: The RV is true if file could be opened for reading.
+		bool open( const char *file );
+
+		// PRE: This object is defined and fd is open for reading.
+		// POST: Lines are read from fd in blocks, fd is not closed by the
+		//		reader.
+		void attach( int fd );
+
+		// PRE: This object is defined and a file is open.
+		// POST: If there is another line then line views it, without the
+		//		'\n', and the RV is true. Else the RV is false.
+		bool nextLine( std::string_view &line );
+
+		// PRE: This object is defined.
+		// POST: The RV is true if the file was mapped into memory.
+		bool isMapped() const { return mMapped; }
+
+		// PRE: This object is defined and isMapped().
+		// POST: The RV views the whole file.
+		std::string_view contents() const { return std::string_view( mData, mSize ); }
+
+		// PRE: This object is defined.
+		// POST: The file is closed and any mapping or buffer is released.
+		void close();
+	private:
+		// PRE: This object is defined and is reading blocks.
+		// POST: The unread part of the buffer is moved to the front and
+		//		more of the file is read after it. The RV is false when
+		//		nothing more could be read.
+		bool fill();
+
+		// Disallow copying, the reader owns the file.
+		SourceReader( const SourceReader & );
+		SourceReader &operator=( const SourceReader & );
+
+		int mFile;
+		bool mOwned;//The reader opened mFile and closes it.
+		bool mMapped;
+		bool mEnd;//No more can be read from mFile.
+		char *mData;//The mapping or the block buffer.
+		size_t mSize;//Bytes of mData that hold the file.
+		size_t mCapacity;//Size of the block buffer.
+		size_t mPosition;//Start of the next line in mData.
+};
+
+#ifdef TESTING
+// Tests that lines are split on '\n' and the last line does not need one.
+void testSourceReaderLines();
+// Tests that lines much longer than a block are still whole.
+void testSourceReaderLongLine();
+#endif
+
+#endif
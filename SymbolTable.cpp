@@ -0,0 +1,199 @@
+#include "SymbolTable.h"
+#include <string.h>
+
+#define INITIAL_SYMBOLS 64
+
+// PRE: name is defined.
+// POST: The RV is the FNV-1a hash of name.
+uint32_t hashSymbolName( const char *name )
+{
+	uint32_t hash = 2166136261u;
+	while( *name != '\0' )
+	{
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// PRE: This object is not defined.
+// POST: This object is defined and is empty.
+SymbolTable::SymbolTable(): mLength( 0 ), mCapacity( INITIAL_SYMBOLS ), mNumSlots( INITIAL_SYMBOLS * 2 )
+{
+	mSymbols = new ParseSymbol[mCapacity];
+	mHashes = new uint32_t[mCapacity];
+	mSlots = new uint32_t[mNumSlots];
+	memset( mSlots, 0, sizeof( uint32_t ) * mNumSlots );
+}
+
+// PRE: This object is defined.
+// POST: All memory held by this object is released.
+SymbolTable::~SymbolTable()
+{
+	delete [] mSymbols;
+	delete [] mHashes;
+	delete [] mSlots;
+}
+
+// PRE: This object is defined.
+// POST: The table is empty.
+void SymbolTable::clear()
+{
+	mLength = 0;
+	memset( mSlots, 0, sizeof( uint32_t ) * mNumSlots );
+}
+
+// PRE: This object is defined and name is defined.
+// POST: The RV is the slot that holds name or the empty slot where
+//		it would be placed.
+uint32_t SymbolTable::findSlot( const char *name, uint32_t hash )
+{
+	uint32_t mask = mNumSlots - 1;
+	uint32_t slot = hash & mask;
+
+	while( mSlots[slot] != 0 )
+	{
+		uint32_t index = mSlots[slot] - 1;
+		if( mHashes[index] == hash && strcmp( mSymbols[index].name, name ) == 0 )
+			break;
+		slot = ( slot + 1 ) & mask;
+	}
+
+	return slot;
+}
+
+// PRE: This object is defined.
+// POST: The number of slots is doubled and every symbol is rehashed.
+void SymbolTable::grow()
+{
+	ParseSymbol *tSymbols = new ParseSymbol[mCapacity * 2];
+	uint32_t *tHashes = new uint32_t[mCapacity * 2];
+	memcpy( tSymbols, mSymbols, sizeof( ParseSymbol ) * mLength );
+	memcpy( tHashes, mHashes, sizeof( uint32_t ) * mLength );
+	delete [] mSymbols;
+	delete [] mHashes;
+	mSymbols = tSymbols;
+	mHashes = tHashes;
+	mCapacity *= 2;
+
+	delete [] mSlots;
+	mNumSlots *= 2;
+	mSlots = new uint32_t[mNumSlots];
+	memset( mSlots, 0, sizeof( uint32_t ) * mNumSlots );
+
+	uint32_t mask = mNumSlots - 1;
+	for( uint32_t i = 0; i < mLength; i++ )
+	{
+		uint32_t slot = mHashes[i] & mask;
+		while( mSlots[slot] != 0 )
+			slot = ( slot + 1 ) & mask;
+		mSlots[slot] = i + 1;
+	}
+}
+
+// PRE: This object and symbol are defined.
+// POST: If there is no symbol with the same name then symbol is
+//		appended to the table and the RV is 0, else it is not added
+//		and the RV is the symbol that has the same name.
+ParseSymbol *SymbolTable::addUnique( const ParseSymbol &symbol )
+{
+	return addUnique( symbol, hashSymbolName( symbol.name ) );
+}
+
+// PRE: This object and symbol are defined, hash is
+//		hashSymbolName( symbol.name ).
+// POST: As addUnique( symbol ) without hashing the name again.
+ParseSymbol *SymbolTable::addUnique( const ParseSymbol &symbol, uint32_t hash )
+{
+	ParseSymbol *ret = 0;
+	uint32_t slot = findSlot( symbol.name, hash );
+
+	if( mSlots[slot] != 0 )
+	{
+		ret = &mSymbols[mSlots[slot] - 1];
+	}
+	else
+	{
+		if( mLength == mCapacity )
+		{
+			grow();
+			slot = findSlot( symbol.name, hash );
+		}
+
+		mSymbols[mLength] = symbol;
+		mHashes[mLength] = hash;
+		mSlots[slot] = ++mLength;
+	}
+
+	return ret;
+}
+
+// PRE: This object and name are defined.
+// POST: The RV is the symbol called name or 0 if there is none.
+ParseSymbol *SymbolTable::find( const char *name )
+{
+	ParseSymbol *ret = 0;
+	uint32_t slot = findSlot( name, hashSymbolName( name ) );
+
+	if( mSlots[slot] != 0 )
+		ret = &mSymbols[mSlots[slot] - 1];
+
+	return ret;
+}
+
+// PRE: This object and name are defined.
+// POST: The RV is the index of the symbol called name or NO_SYMBOL
+//		if there is none.
+uint32_t SymbolTable::indexOf( const char *name )
+{
+	uint32_t slot = findSlot( name, hashSymbolName( name ) );
+	return mSlots[slot] != 0 ? mSlots[slot] - 1 : NO_SYMBOL;
+}
+
+#ifdef TESTING
+#include <assert.h>
+#include <stdio.h>
+
+// PRE: name is defined.
+// POST: The RV is a variable symbol called name.
+static ParseSymbol makeSymbol( const char *name )
+{
+	ParseSymbol symbol;
+	symbol.type = Symbols::VARIABLE;
+	symbol.address = 0;
+	strcpy( symbol.name, name );
+	return symbol;
+}
+
+void testSymbolTableAddUnique()
+{
+	SymbolTable t;
+	assert( t.addUnique( makeSymbol( "x" ) ) == 0 );
+	assert( t.addUnique( makeSymbol( "y" ) ) == 0 );
+	assert( t.addUnique( makeSymbol( "x" ) ) == &t[0] );
+	assert( t.length() == 2 );
+	assert( t.find( "y" ) == &t[1] );
+	assert( t.find( "z" ) == 0 );
+	assert( t.indexOf( "y" ) == 1 );
+	assert( t.indexOf( "z" ) == NO_SYMBOL );
+}
+
+void testSymbolTableOrder()
+{
+	SymbolTable t;
+	char name[LINE];
+	for( int i = 0; i < 1000; i++ )
+	{
+		sprintf( name, "v%d", i );
+		t.addUnique( makeSymbol( name ) );
+	}
+
+	assert( t.length() == 1000 );
+	for( int i = 0; i < 1000; i++ )
+	{
+		sprintf( name, "v%d", i );
+		assert( strcmp( t[i].name, name ) == 0 );
+		assert( t.find( name ) == &t[i] );
+	}
+}
+#endif
@@ -0,0 +1,96 @@
+/*
+    SymbolTable: Holds the labels and variables found while parsing.
+
+    The symbols are kept in an array in the order that they were discovered,
+    this order is what decides where each variable lives in memory. An open
+    addressing hash table (linear probing) maps a symbol name onto its index
+    in that array so that inserting and finding a symbol does not need to
+    walk every symbol that has already been seen.
+*/
+
+#ifndef __SYMBOLTABLE__
+#define __SYMBOLTABLE__
+
+#include <stdint.h>
+#include "Parser.h"
+
+#define NO_SYMBOL 0xFFFFFFFF
+
+class SymbolTable
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined and is empty.
+		SymbolTable();
+		// PRE: This object is defined.
+		// POST: All memory held by this object is released.
+		~SymbolTable();
+
+		// PRE: This object and symbol are defined.
+		// POST: If there is no symbol with the same name then symbol is
+		//		appended to the table and the RV is 0, else it is not added
+		//		and the RV is the symbol that has the same name.
+		ParseSymbol *addUnique( const ParseSymbol &symbol );
+		// PRE: This object and symbol are defined, hash is
+		//		hashSymbolName( symbol.name ).
+		// POST: As addUnique( symbol ) without hashing the name again.
+		ParseSymbol *addUnique( const ParseSymbol &symbol, uint32_t hash );
+
+		// PRE: This object and name are defined.
+		// POST: The RV is the symbol called name or 0 if there is none.
+		ParseSymbol *find( const char *name );
+
+		// PRE: This object and name are defined.
+		// POST: The RV is the index of the symbol called name or NO_SYMBOL
+		//		if there is none.
+		uint32_t indexOf( const char *name );
+
+		// PRE: This object is defined and index < length().
+		// POST: The RV is the index'th symbol in discovery order.
+		ParseSymbol &operator[]( uint32_t index ) { return mSymbols[index]; }
+
+		// PRE: This object is defined and index < length().
+		// POST: The RV is the hash of the index'th symbol's name.
+		uint32_t hash( uint32_t index ) const { return mHashes[index]; }
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of symbols in the table.
+		uint32_t length() { return mLength; }
+
+		// PRE: This object is defined.
+		// POST: The table is empty.
+		void clear();
+	private:
+		// PRE: This object is defined and name is defined.
+		// POST: The RV is the slot that holds name or the empty slot where
+		//		it would be placed.
+		uint32_t findSlot( const char *name, uint32_t hash );
+
+		// PRE: This object is defined.
+		// POST: The number of slots is doubled and every symbol is rehashed.
+		void grow();
+
+		// Disallow copying, the table owns its arrays.
+		SymbolTable( const SymbolTable & );
+		SymbolTable &operator=( const SymbolTable & );
+
+		ParseSymbol *mSymbols;//Symbols in discovery order.
+		uint32_t *mHashes;//Hash of each symbol in mSymbols.
+		uint32_t *mSlots;//Index + 1 into mSymbols, 0 marks an empty slot.
+		uint32_t mLength;
+		uint32_t mCapacity;//Size of mSymbols and mHashes.
+		uint32_t mNumSlots;//Always a power of two.
+};
+
+// PRE: name is defined.
+// POST: The RV is the FNV-1a hash of name.
+uint32_t hashSymbolName( const char *name );
+
+#ifdef TESTING
+// Tests that addUnique only adds a name once.
+void testSymbolTableAddUnique();
+// Tests that symbols keep their discovery order as the table grows.
+void testSymbolTableOrder();
+#endif
+
+#endif
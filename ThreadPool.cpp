@@ -0,0 +1,122 @@
+#include "ThreadPool.h"
+
+// PRE: This object is not defined.
+// POST: This object is defined and has threads - 1 workers, the
+//		thread calling run() is the last one. 0 means one thread
+//		per core.
+ThreadPool::ThreadPool( uint32_t threads ): mWorkers( 0 ), mNumWorkers( 0 ), mGeneration( 0 ),
+											mBusy( 0 ), mStop( false ), mTask( 0 ), mContext( 0 ),
+											mCount( 0 ), mNext( 0 )
+{
+	if( threads == 0 )
+		threads = std::thread::hardware_concurrency();
+	if( threads > 1 )
+	{
+		mNumWorkers = threads - 1;
+		mWorkers = new std::thread[mNumWorkers];
+		for( uint32_t i = 0; i < mNumWorkers; i++ )
+			mWorkers[i] = std::thread( &ThreadPool::work, this );
+	}
+}
+
+// PRE: This object is defined and not inside run().
+// POST: The workers are stopped and joined.
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( mLock );
+		mStop = true;
+	}
+	mWake.notify_all();
+
+	for( uint32_t i = 0; i < mNumWorkers; i++ )
+		mWorkers[i].join();
+	delete [] mWorkers;
+}
+
+// PRE: This object and task are defined.
+// POST: task has been called once for every index below count.
+void ThreadPool::run( uint32_t count, PoolTask task, void *context )
+{
+	{
+		std::lock_guard<std::mutex> lock( mLock );
+		mTask = task;
+		mContext = context;
+		mCount = count;
+		mNext = 0;
+		mBusy = mNumWorkers;
+		mGeneration++;
+	}
+	mWake.notify_all();
+
+	runTasks();
+
+	std::unique_lock<std::mutex> lock( mLock );
+	while( mBusy != 0 )
+		mDone.wait( lock );
+}
+
+// PRE: This object is defined.
+// POST: Tasks of the current run are done until none are left.
+void ThreadPool::runTasks()
+{
+	uint32_t index;
+	while( ( index = mNext++ ) < mCount )
+		mTask( index, mContext );
+}
+
+// PRE: This object is defined.
+// POST: Runs tasks for every run until the pool is stopped.
+void ThreadPool::work()
+{
+	uint32_t seen = 0;
+	std::unique_lock<std::mutex> lock( mLock );
+	while( true )
+	{
+		while( !mStop && mGeneration == seen )
+			mWake.wait( lock );
+		if( mStop )
+			return;
+		seen = mGeneration;
+
+		lock.unlock();
+		runTasks();
+		lock.lock();
+
+		if( --mBusy == 0 )
+			mDone.notify_one();
+	}
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+// PRE: context is an array of at least index + 1 counters.
+// POST: The counter at index is incremented.
+static void countTask( uint32_t index, void *context )
+{
+	( (std::atomic<uint32_t> *)context )[index]++;
+}
+
+void testThreadPoolRun()
+{
+	std::atomic<uint32_t> counts[1000];
+	for( int i = 0; i < 1000; i++ )
+		counts[i] = 0;
+
+	ThreadPool pool( 4 );
+	assert( pool.threads() == 4 );
+	for( int run = 0; run < 20; run++ )
+		pool.run( 1000, countTask, counts );
+	pool.run( 0, countTask, counts );
+
+	for( int i = 0; i < 1000; i++ )
+		assert( counts[i] == 20 );
+
+	//A pool of one runs everything on the calling thread.
+	ThreadPool single( 1 );
+	single.run( 1000, countTask, counts );
+	for( int i = 0; i < 1000; i++ )
+		assert( counts[i] == 21 );
+}
+#endif
@@ -0,0 +1,76 @@
+/*
+    ThreadPool: A fixed set of worker threads that share out numbered tasks.
+
+    run() hands the tasks 0 .. count - 1 out to the workers and to the
+    calling thread, each one takes the next unclaimed index until none are
+    left, and run() returns once every task is finished. The workers are
+    started once and sleep between calls, so a pool can be used for many
+    runs without starting threads each time.
+*/
+
+#ifndef __THREADPOOL__
+#define __THREADPOOL__
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+//A task is given its index and the context passed to run().
+typedef void (*PoolTask)( uint32_t index, void *context );
+
+class ThreadPool
+{
+	public:
+		// PRE: This object is not defined.
+		// POST: This object is defined and has threads - 1 workers, the
+		//		thread calling run() is the last one. 0 means one thread
+		//		per core.
+		ThreadPool( uint32_t threads );
+		// PRE: This object is defined and not inside run().
+		// POST: The workers are stopped and joined.
+		~ThreadPool();
+
+		// PRE: This object and task are defined.
+		// POST: task has been called once for every index below count.
+		void run( uint32_t count, PoolTask task, void *context );
+
+		// PRE: This object is defined.
+		// POST: The RV is the number of threads that run tasks.
+		uint32_t threads() const { return mNumWorkers + 1; }
+	private:
+		// PRE: This object is defined.
+		// POST: Tasks of the current run are done until none are left.
+		void runTasks();
+
+		// PRE: This object is defined.
+		// POST: Runs tasks for every run until the pool is stopped.
+		void work();
+
+		// Disallow copying, the pool owns its threads.
+		ThreadPool( const ThreadPool & );
+		ThreadPool &operator=( const ThreadPool & );
+
+		std::thread *mWorkers;
+		uint32_t mNumWorkers;
+
+		std::mutex mLock;
+		std::condition_variable mWake;//A run started or the pool stopped.
+		std::condition_variable mDone;//A worker finished its part of a run.
+		uint32_t mGeneration;//Number of runs started.
+		uint32_t mBusy;//Workers still in the current run.
+		bool mStop;
+
+		PoolTask mTask;
+		void *mContext;
+		uint32_t mCount;
+		std::atomic<uint32_t> mNext;//Next task index to hand out.
+};
+
+#ifdef TESTING
+// Tests that every task is run exactly once, over several runs.
+void testThreadPoolRun();
+#endif
+
+#endif
@@ -0,0 +1,299 @@
+#include "TokenStore.h"
+#include <string.h>
+
+// PRE: This object and str are defined.
+// POST: str is copied onto the end of the arena and the RV is the
+//		offset that it can be found at.
+uint32_t StringArena::add( const char *str )
+{
+	uint32_t offset = mChars.length();
+	uint32_t length = strlen( str ) + 1;
+	mChars.resize( offset + length );
+	memcpy( mChars.data() + offset, str, length );
+	return offset;
+}
+
+// PRE: This object and other are defined.
+// POST: The strings of other are copied onto the end of the arena
+//		and the RV is the offset that other's offset 0 now has.
+uint32_t StringArena::append( const StringArena &other )
+{
+	uint32_t offset = mChars.length();
+	mChars.resize( offset + other.mChars.length() );
+	memcpy( mChars.data() + offset, other.mChars.data(), other.mChars.length() );
+	return offset;
+}
+
+// PRE: This object is defined and chars holds length bytes of
+//		strings.
+// POST: The strings are copied onto the end of the arena and the
+//		RV is the offset that chars[0] now has.
+uint32_t StringArena::append( const char *chars, uint32_t length )
+{
+	uint32_t offset = mChars.length();
+	mChars.resize( offset + length );
+	memcpy( mChars.data() + offset, chars, length );
+	return offset;
+}
+
+// PRE: This object and token are defined, token is an instruction.
+// POST: The word, address, lable and non register operands of token
+//		are appended to the store. The RV is the index of the token.
+uint32_t TokenStore::add( const InstructionToken &token )
+{
+	uint32_t index = mWords.length();
+	mWords.add( token.instruct.instruct.binary );
+	mAddresses.add( token.address );
+	mLables.add( token.hasLable ? mStrings.add( token.lable ) : NO_STRING );
+
+	for( int i = 0; i < NUM_PARAMS; i++ )
+	{
+		//Registers are already encoded in the word so there is no need
+		//to keep their names.
+		const char *param = token.params[i];
+		if( param[0] != '\0' && param[0] != '$' )
+			mOperands.add( mStrings.add( param ) );
+		else
+			mOperands.add( NO_STRING );
+	}
+
+	return index;
+}
+
+// PRE: This object is defined.
+// POST: A word with no lable or operands is appended to the store.
+//		The RV is the index of the word.
+uint32_t TokenStore::addWord( uint32_t word, uint32_t address )
+{
+	uint32_t index = mWords.length();
+	mWords.add( word );
+	mAddresses.add( address );
+	mLables.add( NO_STRING );
+	for( int i = 0; i < NUM_PARAMS; i++ )
+		mOperands.add( NO_STRING );
+	return index;
+}
+
+// PRE: This object and other are defined.
+// POST: Every word of other is appended to the store with
+//		addressOffset added to its address.
+void TokenStore::append( const TokenStore &other, uint32_t addressOffset )
+{
+	uint32_t base = mStrings.append( other.mStrings );
+	uint32_t length = mWords.length() + other.length();
+	mWords.reserve( length );
+	mAddresses.reserve( length );
+	mLables.reserve( length );
+	mOperands.reserve( length * NUM_PARAMS );
+
+	for( uint32_t i = 0; i < other.length(); i++ )
+	{
+		mWords.add( other.mWords[i] );
+		mAddresses.add( other.mAddresses[i] + addressOffset );
+		uint32_t lable = other.mLables[i];
+		mLables.add( lable == NO_STRING ? NO_STRING : lable + base );
+	}
+
+	for( uint32_t i = 0; i < other.mOperands.length(); i++ )
+	{
+		uint32_t operand = other.mOperands[i];
+		mOperands.add( operand == NO_STRING ? NO_STRING : operand + base );
+	}
+}
+
+// PRE: This object is defined, words, lables and operands hold
+//		count words laid out as in the store and the strings they
+//		name are already in the store at the same offsets.
+// POST: The words are appended with the addresses address,
+//		address + 4, ...
+void TokenStore::appendWords( const uint32_t *words, const uint32_t *lables,
+							  const uint32_t *operands, uint32_t count, uint32_t address )
+{
+	if( count == 0 )
+		return;
+
+	uint32_t length = mWords.length();
+	mWords.resize( length + count );
+	mAddresses.resize( length + count );
+	mLables.resize( length + count );
+	mOperands.resize( ( length + count ) * NUM_PARAMS );
+
+	memcpy( mWords.data() + length, words, count * 4 );
+	memcpy( mLables.data() + length, lables, count * 4 );
+	memcpy( mOperands.data() + length * NUM_PARAMS, operands, count * NUM_PARAMS * 4 );
+	for( uint32_t i = 0; i < count; i++ )
+		mAddresses[length + i] = address + i * 4;
+}
+
+// PRE: This object is defined and removed holds length() flags.
+// POST: The words whose flag is true are dropped, the rest keep their
+//		order and have the addresses 0, 4, ... Their strings stay where
+//		they are.
+void TokenStore::compact( const Array<bool> &removed )
+{
+	uint32_t kept = 0;
+	for( uint32_t i = 0; i < mWords.length(); i++ )
+	{
+		if( removed[i] )
+			continue;
+
+		mWords[kept] = mWords[i];
+		mAddresses[kept] = kept * 4;
+		mLables[kept] = mLables[i];
+		for( int p = 0; p < NUM_PARAMS; p++ )
+			mOperands[kept * NUM_PARAMS + p] = mOperands[i * NUM_PARAMS + p];
+		kept++;
+	}
+
+	mWords.resize( kept );
+	mAddresses.resize( kept );
+	mLables.resize( kept );
+	mOperands.resize( kept * NUM_PARAMS );
+}
+
+// PRE: This object is defined, index <= length() and words holds count
+//		words.
+// POST: The words are put in before the word at index with no lable or
+//		operands. Every word has the addresses 0, 4, ...
+void TokenStore::insertWords( uint32_t index, const uint32_t *words, uint32_t count )
+{
+	uint32_t length = mWords.length();
+	mWords.resize( length + count );
+	mAddresses.resize( length + count );
+	mLables.resize( length + count );
+	mOperands.resize( ( length + count ) * NUM_PARAMS );
+
+	for( uint32_t i = length; i-- > index; )
+	{
+		mWords[i + count] = mWords[i];
+		mLables[i + count] = mLables[i];
+		for( int p = 0; p < NUM_PARAMS; p++ )
+			mOperands[( i + count ) * NUM_PARAMS + p] = mOperands[i * NUM_PARAMS + p];
+	}
+	for( uint32_t i = 0; i < count; i++ )
+	{
+		mWords[index + i] = words[i];
+		mLables[index + i] = NO_STRING;
+		for( int p = 0; p < NUM_PARAMS; p++ )
+			mOperands[( index + i ) * NUM_PARAMS + p] = NO_STRING;
+	}
+	for( uint32_t i = 0; i < length + count; i++ )
+		mAddresses[i] = i * 4;
+}
+
+// PRE: This object is defined and index < length().
+// POST: The word at index has no operands, its lable stays.
+void TokenStore::clearOperands( uint32_t index )
+{
+	for( int p = 0; p < NUM_PARAMS; p++ )
+		mOperands[index * NUM_PARAMS + p] = NO_STRING;
+}
+
+// PRE: This object is defined and index < length().
+// POST: The RV is the lable on the word at index or 0 if it has none.
+const char *TokenStore::lable( uint32_t index ) const
+{
+	return mLables[index] == NO_STRING ? 0 : mStrings.get( mLables[index] );
+}
+
+// PRE: This object is defined, index < length() and param < NUM_PARAMS.
+// POST: The RV is the text of the param or 0 if it was empty or a
+//		register.
+const char *TokenStore::operand( uint32_t index, uint32_t param ) const
+{
+	uint32_t offset = mOperands[index * NUM_PARAMS + param];
+	return offset == NO_STRING ? 0 : mStrings.get( offset );
+}
+
+// PRE: This object is defined.
+// POST: The store is empty.
+void TokenStore::clear()
+{
+	mWords.clear();
+	mAddresses.clear();
+	mLables.clear();
+	mOperands.clear();
+	mStrings.clear();
+}
+
+#ifdef TESTING
+#include <assert.h>
+
+void testTokenStoreAdd()
+{
+	Parser p;
+	TokenStore t;
+	InstructionToken token = p.parseLine( "loop: beq $a0, $a1, done", 8 );
+	t.add( token );
+	t.addWord( 0, 12 );
+
+	assert( t.length() == 2 );
+	assert( t.word( 0 ) == token.instruct.instruct.binary );
+	assert( t.address( 0 ) == 8 );
+	assert( strcmp( t.lable( 0 ), "loop" ) == 0 );
+	assert( t.operand( 0, 0 ) == 0 );
+	assert( strcmp( t.operand( 0, 2 ), "done" ) == 0 );
+	assert( t.lable( 1 ) == 0 );
+	assert( t.word( 1 ) == 0 );
+}
+
+void testTokenStoreAppend()
+{
+	Parser p;
+	TokenStore a, b;
+	a.add( p.parseLine( "lw $a0, x", 0 ) );
+	b.add( p.parseLine( "loop: beq $a0, $a1, done", 0 ) );
+	b.add( p.parseLine( "sw $a0, y", 4 ) );
+	a.append( b, 4 );
+
+	assert( a.length() == 3 );
+	assert( strcmp( a.operand( 0, 1 ), "x" ) == 0 );
+	assert( a.address( 1 ) == 4 && a.address( 2 ) == 8 );
+	assert( strcmp( a.lable( 1 ), "loop" ) == 0 );
+	assert( strcmp( a.operand( 1, 2 ), "done" ) == 0 );
+	assert( a.lable( 2 ) == 0 );
+	assert( strcmp( a.operand( 2, 1 ), "y" ) == 0 );
+}
+
+void testTokenStoreCompact()
+{
+	Parser p;
+	TokenStore t;
+	t.add( p.parseLine( "lw $a0, x", 0 ) );
+	t.add( p.parseLine( "sw $a0, x", 4 ) );
+	t.add( p.parseLine( "loop: beq $a0, $a1, done", 8 ) );
+	t.add( p.parseLine( "out $a0", 12 ) );
+
+	Array<bool> removed;
+	removed.resize( 4 );
+	removed[0] = removed[2] = false;
+	removed[1] = removed[3] = true;
+	t.compact( removed );
+
+	assert( t.length() == 2 );
+	assert( strcmp( t.operand( 0, 1 ), "x" ) == 0 );
+	assert( t.address( 1 ) == 4 );
+	assert( strcmp( t.lable( 1 ), "loop" ) == 0 );
+	assert( strcmp( t.operand( 1, 2 ), "done" ) == 0 );
+}
+
+void testTokenStoreInsert()
+{
+	Parser p;
+	TokenStore t;
+	t.add( p.parseLine( "loop: lw $a0, x", 0 ) );
+	t.add( p.parseLine( "beq $a0, $a1, loop", 4 ) );
+
+	uint32_t words[] = { 0x12345678, 0x7000000 };
+	t.insertWords( 1, words, 2 );
+	assert( t.length() == 4 );
+	assert( t.word( 1 ) == 0x12345678 && t.word( 2 ) == 0x7000000 );
+	assert( t.lable( 1 ) == 0 && t.operand( 2, 2 ) == 0 );
+	assert( strcmp( t.lable( 0 ), "loop" ) == 0 );
+	assert( strcmp( t.operand( 3, 2 ), "loop" ) == 0 );
+	assert( t.address( 3 ) == 12 );
+
+	t.clearOperands( 0 );
+	assert( t.operand( 0, 1 ) == 0 && strcmp( t.lable( 0 ), "loop" ) == 0 );
+}
+#endif
@@ -0,0 +1,153 @@
+/*
+    TokenStore: Holds the assembled instructions of a program.
+
+    Rather than keeping a whole InstructionToken for every line the store
+    keeps each part in its own array, one entry per word of the image. The
+    binary words and their addresses sit next to each other in memory so the
+    passes that patch and print them walk straight through. The text that is
+    still needed after parsing, lables and the operands that are not
+    registers, is copied into one shared StringArena and the token only
+    keeps the offset of it.
+*/
+
+#ifndef __TOKENSTORE__
+#define __TOKENSTORE__
+
+#include <stdint.h>
+#include "Array.h"
+#include "Parser.h"
+
+#define NO_STRING 0xFFFFFFFF
+
+class StringArena
+{
+	public:
+		// PRE: This object and str are defined.
+		// POST: str is copied onto the end of the arena and the RV is the
+		//		offset that it can be found at.
+		uint32_t add( const char *str );
+		// PRE: This object is defined and offset came from add().
+		// POST: The RV is the string at offset.
+		const char *get( uint32_t offset ) const { return mChars.data() + offset; }
+		// PRE: This object and other are defined.
+		// POST: The strings of other are copied onto the end of the arena
+		//		and the RV is the offset that other's offset 0 now has.
+		uint32_t append( const StringArena &other );
+		// PRE: This object is defined and chars holds length bytes of
+		//		strings.
+		// POST: The strings are copied onto the end of the arena and the
+		//		RV is the offset that chars[0] now has.
+		uint32_t append( const char *chars, uint32_t length );
+		// PRE: This object is defined.
+		// POST: The RV is every string of the arena, one after the other.
+		const char *data() const { return mChars.data(); }
+		// PRE: This object is defined.
+		// POST: The RV is the number of bytes held by the arena.
+		uint32_t length() const { return mChars.length(); }
+		// PRE: This object is defined.
+		// POST: The arena is empty.
+		void clear() { mChars.clear(); }
+	private:
+		Array<char> mChars;
+};
+
+class TokenStore
+{
+	public:
+		// PRE: This object and token are defined, token is an instruction.
+		// POST: The word, address, lable and non register operands of token
+		//		are appended to the store. The RV is the index of the token.
+		uint32_t add( const InstructionToken &token );
+
+		// PRE: This object is defined.
+		// POST: A word with no lable or operands is appended to the store.
+		//		The RV is the index of the word.
+		uint32_t addWord( uint32_t word, uint32_t address );
+
+		// PRE: This object and other are defined.
+		// POST: Every word of other is appended to the store with
+		//		addressOffset added to its address.
+		void append( const TokenStore &other, uint32_t addressOffset );
+
+		// PRE: This object is defined, words, lables and operands hold
+		//		count words laid out as in the store and the strings they
+		//		name are already in the store at the same offsets.
+		// POST: The words are appended with the addresses address,
+		//		address + 4, ...
+		void appendWords( const uint32_t *words, const uint32_t *lables,
+						  const uint32_t *operands, uint32_t count, uint32_t address );
+
+		// PRE: This object is defined and removed holds length() flags.
+		// POST: The words whose flag is true are dropped, the rest keep
+		//		their order and have the addresses 0, 4, ... Their strings
+		//		stay where they are.
+		void compact( const Array<bool> &removed );
+
+		// PRE: This object is defined, index <= length() and words holds
+		//		count words.
+		// POST: The words are put in before the word at index with no
+		//		lable or operands. Every word has the addresses 0, 4, ...
+		void insertWords( uint32_t index, const uint32_t *words, uint32_t count );
+
+		// PRE: This object is defined and index < length().
+		// POST: The word at index has no operands, its lable stays.
+		void clearOperands( uint32_t index );
+
+		// PRE: This object is defined and chars holds length bytes of
+		//		strings.
+		// POST: The strings are added to the store, the RV is the offset
+		//		chars[0] now has.
+		uint32_t addStrings( const char *chars, uint32_t length ) { return mStrings.append( chars, length ); }
+
+		// PRE: This object is defined and index < length().
+		// POST: The RV is the binary word at index.
+		uint32_t &word( uint32_t index ) { return mWords[index]; }
+		// PRE: This object is defined and index < length().
+		// POST: The RV is the address of the word at index.
+		uint32_t &address( uint32_t index ) { return mAddresses[index]; }
+		// PRE: This object is defined and index < length().
+		// POST: The RV is the lable on the word at index or 0 if it has none.
+		const char *lable( uint32_t index ) const;
+		// PRE: This object is defined, index < length() and param < NUM_PARAMS.
+		// POST: The RV is the text of the param or 0 if it was empty or a
+		//		register.
+		const char *operand( uint32_t index, uint32_t param ) const;
+
+		// PRE: This object is defined.
+		// POST: The RV is the words of the image in order.
+		const uint32_t *words() const { return mWords.data(); }
+		// PRE: This object is defined.
+		// POST: The RV is the lable offset of every word, see mLables.
+		const uint32_t *lables() const { return mLables.data(); }
+		// PRE: This object is defined.
+		// POST: The RV is the NUM_PARAMS operand offsets of every word.
+		const uint32_t *operands() const { return mOperands.data(); }
+		// PRE: This object is defined.
+		// POST: The RV is the strings the offsets point into.
+		const StringArena &strings() const { return mStrings; }
+		// PRE: This object is defined.
+		// POST: The RV is the number of words in the store.
+		uint32_t length() const { return mWords.length(); }
+		// PRE: This object is defined.
+		// POST: The store is empty.
+		void clear();
+	private:
+		Array<uint32_t> mWords;
+		Array<uint32_t> mAddresses;
+		Array<uint32_t> mLables;//Offset into mStrings or NO_STRING.
+		Array<uint32_t> mOperands;//NUM_PARAMS offsets per word.
+		StringArena mStrings;
+};
+
+#ifdef TESTING
+// Tests that a token is split into the store and can be read back.
+void testTokenStoreAdd();
+// Tests that appending a store rebases its addresses and strings.
+void testTokenStoreAppend();
+// Tests that compacting drops words and gives the rest new addresses.
+void testTokenStoreCompact();
+// Tests that words put in move the rest along and keep their strings.
+void testTokenStoreInsert();
+#endif
+
+#endif
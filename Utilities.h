@@ -4,13 +4,23 @@ Utility functions
 
 */
 
-bool iswhitespace( char c )
+// PRE: to can hold LINE chars and from is defined.
+// POST: to holds as much of from as will fit in LINE chars.
+void copyString( char *to, const char *from )
 {
-	bool retVal = false;
-	if( c == '\t' || c == ' ' )
-		retVal = true;
+	int i = 0;
+	for( ; i < LINE - 1 && from[i] != '\0'; i++ )
+		to[i] = from[i];
+	to[i] = '\0';
+}
 
-	return retVal;
+// PRE: to can hold LINE chars and from is defined.
+// POST: to holds as much of from as will fit in LINE chars.
+void copyString( char *to, std::string_view from )
+{
+	size_t length = from.length() < LINE - 1 ? from.length() : LINE - 1;
+	memcpy( to, from.data(), length );
+	to[length] = '\0';
 }
 
 int strToInt( char *in )
@@ -0,0 +1,256 @@
+#include "benchMain.h"
+#ifdef BENCH
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+//The instructions are drawn from this table, an opcode appears as often
+//as it should be picked.
+static const Opcode sMix[] =
+{
+	ADD, ADD, ADD, ADD, ADD,
+	NAND, NAND,
+	ADDI, ADDI, ADDI, ADDI,
+	LW, LW, LW, LW,
+	SW, SW, SW,
+	BEQ, BEQ, BEQ,
+	JALR,
+	IN,
+	OUT, OUT
+};
+#define MIX_LENGTH ( sizeof( sMix ) / sizeof( sMix[0] ) )
+
+//Sizes assembled when no --lines is given.
+static const uint32_t sDefaultLines[] = { 1000, 10000, 100000 };
+
+//How the timed phases are named in the JSON.
+static const char *sPhaseNames[Phases::NUM_PHASES] =
+{
+	"preprocess", "lex", "collectSymbols", "fixAddresses", "printHexToFile"
+};
+
+// PRE: state is defined and not 0, limit is not 0.
+// POST: state is stepped and the RV is its next number below limit.
+static uint32_t nextRandom( uint64_t &state, uint32_t limit )
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return (uint32_t)( ( state >> 32 ) % limit );
+}
+
+// PRE: state is defined, variables is not 0 and text can hold LINE chars.
+// POST: text is a register, or a variable for variableRatio percent of
+//		the operands.
+static void makeOperand( uint64_t &state, const GeneratorOptions &options, uint32_t variables, char *text )
+{
+	if( nextRandom( state, 100 ) < options.variableRatio )
+		sprintf( text, "v%u", nextRandom( state, variables ) );
+	else
+		strcpy( text, RegisterStrings[nextRandom( state, NUM_REGISTERS )] );
+}
+
+// PRE: options and out are defined.
+// POST: out holds a program shaped by options that ends in a halt, the
+//		same options always give the same program. The RV is the number
+//		of lines written.
+uint32_t generateProgram( const GeneratorOptions &options, std::ostream &out )
+{
+	uint64_t state = options.seed * 0x9E3779B97F4A7C15ull + 1;
+	uint32_t variables = options.lines / 50 + 8;
+	uint32_t lables = 0;
+	uint32_t written = 0;
+	char a[LINE], b[LINE], c[LINE];
+
+	for( uint32_t i = 0; i < options.lines; i++ )
+	{
+		//A few comment and blank lines, as a person would write.
+		uint32_t filler = nextRandom( state, 100 );
+		if( filler < 3 )
+		{
+			out << "; block " << i << '\n';
+			written++;
+		}
+		else if( filler < 5 )
+		{
+			out << '\n';
+			written++;
+		}
+
+		if( nextRandom( state, 100 ) < options.lableDensity )
+			out << 'L' << lables++ << ": ";
+
+		Opcode op = sMix[nextRandom( state, MIX_LENGTH )];
+		out << GetOpCodeString( op ) << ' ';
+		makeOperand( state, options, variables, a );
+		makeOperand( state, options, variables, b );
+		makeOperand( state, options, variables, c );
+		switch( op )
+		{
+			case ADD: case NAND:
+				out << a << ", " << b << ", " << c;
+				break;
+			case ADDI:
+				out << a << ", " << b << ", " << (int)nextRandom( state, 128 ) - 64;
+				break;
+			case LW: case SW:
+				out << RegisterStrings[nextRandom( state, NUM_REGISTERS )] << ", ";
+				if( nextRandom( state, 100 ) < options.variableRatio )
+					out << 'v' << nextRandom( state, variables );
+				else
+					out << nextRandom( state, 16 ) * 4 << '(' << RegisterStrings[nextRandom( state, NUM_REGISTERS )] << ')';
+				break;
+			case BEQ:
+				//Branches go back to a lable that is already there, as loops do.
+				out << a << ", " << b << ", ";
+				if( lables != 0 )
+					out << 'L' << nextRandom( state, lables );
+				else
+					out << (int)nextRandom( state, 16 ) - 8;
+				break;
+			case JALR:
+				if( lables != 0 && nextRandom( state, 2 ) == 0 )
+					out << 'L' << nextRandom( state, lables );
+				else
+					out << "$a0, $ra";
+				break;
+			case IN: case OUT:
+				out << a;
+				break;
+			default:
+				break;
+		}
+
+		if( nextRandom( state, 100 ) < 5 )
+			out << " ; note";
+		out << '\n';
+		written++;
+	}
+
+	out << "halt\n";
+	return written + 1;
+}
+
+// PRE: seconds is the time lines took.
+// POST: The JSON object for the time is written to cout.
+static void printTime( const char *name, double seconds, uint32_t lines, bool last )
+{
+	cout << "        \"" << name << "\": { \"seconds\": " << seconds
+		 << ", \"nsPerLine\": " << seconds * 1e9 / lines
+		 << ", \"linesPerSecond\": " << ( seconds > 0 ? lines / seconds : 0 )
+		 << " }" << ( last ? "" : "," ) << endl;
+}
+
+// PRE: argv holds argc arguments.
+// POST: Programs are generated and assembled and the best time of each
+//		phase is written to cout as JSON. The RV is the exit status.
+int benchMain( int argc, char **argv )
+{
+	GeneratorOptions options = { 0, 10, 30, 1 };
+	Array<uint32_t> sizes;
+	uint32_t runs = 5;
+	uint32_t threads = 1;
+	bool badArgs = false;
+	for( int i = 1; i < argc; i++ )
+	{
+		bool hasNumber = i + 1 < argc && isdigit( argv[i + 1][0] );
+		if( strcmp( argv[i], "--lines" ) == 0 && hasNumber )
+			sizes.add( atoi( argv[++i] ) );
+		else if( strcmp( argv[i], "--lables" ) == 0 && hasNumber )
+			options.lableDensity = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--variables" ) == 0 && hasNumber )
+			options.variableRatio = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--seed" ) == 0 && hasNumber )
+			options.seed = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--runs" ) == 0 && hasNumber )
+			runs = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--threads" ) == 0 && hasNumber )
+			threads = atoi( argv[++i] );
+		else
+			badArgs = true;
+	}
+
+	if( badArgs || runs == 0 )
+	{
+		cerr << "Usage: " << argv[0] << " [--lines N] ... [--lables PERCENT] [--variables PERCENT]" << endl;
+		cerr << "       [--seed N] [--runs N] [--threads N]" << endl;
+		return 1;
+	}
+	if( sizes.length() == 0 )
+		for( uint32_t i = 0; i < sizeof( sDefaultLines ) / sizeof( sDefaultLines[0] ); i++ )
+			sizes.add( sDefaultLines[i] );
+
+	char file[] = "bench.tmp";
+	cout << "{" << endl;
+	cout << "  \"runs\": " << runs << ", \"threads\": " << threads
+		 << ", \"lableDensity\": " << options.lableDensity
+		 << ", \"variableRatio\": " << options.variableRatio
+		 << ", \"seed\": " << options.seed << "," << endl;
+	cout << "  \"benchmarks\": [" << endl;
+
+	int status = 0;
+	for( uint32_t i = 0; i < sizes.length(); i++ )
+	{
+		options.lines = sizes[i];
+		std::ofstream source( file );
+		uint32_t lines = generateProgram( options, source );
+		source.close();
+
+		//The best of the runs is kept, a slower run was held up by the machine.
+		double best[Phases::NUM_PHASES];
+		double bestParse = 0;
+		uint32_t words = 0;
+		for( uint32_t run = 0; run < runs; run++ )
+		{
+			std::ostringstream log;
+			Parser parser( file );
+			parser.setLog( &log );
+			parser.setThreads( threads );
+			parser.preprocess();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			parser.parse();
+			double parse = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+			if( parser.getErrors() != 0 || !parser.wasWritten() )
+			{
+				cerr << log.str() << file << " was not assembled." << endl;
+				status = 1;
+			}
+
+			for( int phase = 0; phase < Phases::NUM_PHASES; phase++ )
+			{
+				double seconds = parser.getPhaseSeconds( (Phases::Phase)phase );
+				if( run == 0 || seconds < best[phase] )
+					best[phase] = seconds;
+			}
+			if( run == 0 || parse < bestParse )
+				bestParse = parse;
+			words = parser.getWordCount();
+		}
+
+		cout << "    {" << endl;
+		cout << "      \"lines\": " << lines << ", \"words\": " << words << "," << endl;
+		cout << "      \"phases\": {" << endl;
+		printTime( sPhaseNames[Phases::PREPROCESS], best[Phases::PREPROCESS], lines, false );
+		printTime( "parse", bestParse, lines, false );
+		for( int phase = Phases::COLLECT; phase < Phases::NUM_PHASES; phase++ )
+			printTime( sPhaseNames[phase], best[phase], lines, phase + 1 == Phases::NUM_PHASES );
+		cout << "      }" << endl;
+		cout << "    }" << ( i + 1 == sizes.length() ? "" : "," ) << endl;
+	}
+	cout << "  ]" << endl;
+	cout << "}" << endl;
+
+	remove( file );
+	remove( "bench.tmp.bin" );
+	return status;
+}
+#endif
@@ -0,0 +1,39 @@
+#ifndef __BENCH_MAIN__
+#define __BENCH_MAIN__
+#pragma once
+
+/*
+    benchMain: Times the assembler on generated programs.
+
+    Built with -D BENCH the executable generates LC2200 programs of the
+    requested sizes, assembles each a number of times and writes the best
+    time of every phase to cout as JSON, so runs can be compared by a
+    script.
+*/
+
+#include <iostream>
+#include <stdint.h>
+#include "Parser.h"
+
+/*
+	GeneratorOptions shapes the programs given to the benchmark.
+*/
+typedef struct __generatoroptions
+{
+	uint32_t lines;//Instructions, the comments and blank lines are extra.
+	uint32_t lableDensity;//Percent of the instructions that have a lable.
+	uint32_t variableRatio;//Percent of the operands that name a variable.
+	uint32_t seed;
+}GeneratorOptions;
+
+// PRE: options and out are defined.
+// POST: out holds a program shaped by options that ends in a halt, the
+//		same options always give the same program. The RV is the number
+//		of lines written.
+uint32_t generateProgram( const GeneratorOptions &options, std::ostream &out );
+
+// PRE: argv holds argc arguments.
+// POST: Programs are generated and assembled and the best time of each
+//		phase is written to cout as JSON. The RV is the exit status.
+int benchMain( int argc, char **argv );
+#endif
@@ -1,29 +1,139 @@
 #include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include "Parser.h"
+#include "Batch.h"
+#include "Cache.h"
 
 #ifdef TESTING
 #include "testMain.h"
 #endif
+#ifdef BENCH
+#include "benchMain.h"
+#endif
 
 using std::cout;
+using std::cerr;
 using std::endl;
 
 int main( int argc, char **argv )
 {
-#ifndef TESTING
-	if( argc != 2 )
+#if !defined( TESTING ) && !defined( BENCH )
+	Arena arena;
+	Array<char *> files;
+	Array<char *> roots;
+	BatchOptions options = { false, false, Formats::HEX, 1, 1, 0, 0, false, &roots };
+	const char *cacheDirectory = 0;
+	uint64_t cacheLimit = CACHE_LIMIT;
+	bool batch = false;
+	bool stats = false;
+	bool statsJson = false;
+	bool badArgs = false;
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "--pre" ) == 0 )
+			options.writePreProcessed = true;
+		else if( strcmp( argv[i], "-O" ) == 0 )
+			options.optimize = 1;
+		else if( strcmp( argv[i], "-O2" ) == 0 )
+			options.optimize = 2;
+		else if( strcmp( argv[i], "--strip" ) == 0 )
+			options.strip = true;
+		else if( strcmp( argv[i], "--keep" ) == 0 && i + 1 < argc )
+			roots.add( argv[++i] );
+		else if( strcmp( argv[i], "--incremental" ) == 0 )
+			options.incremental = true;
+		else if( strcmp( argv[i], "--stats" ) == 0 )
+			stats = true;
+		else if( strcmp( argv[i], "--stats-json" ) == 0 )
+			stats = statsJson = true;
+		else if( strcmp( argv[i], "--image" ) == 0 )
+			options.format = Formats::IMAGE;
+		else if( strcmp( argv[i], "--threads" ) == 0 && i + 1 < argc && isdigit( argv[i + 1][0] ) )
+			options.threads = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--jobs" ) == 0 && i + 1 < argc && isdigit( argv[i + 1][0] ) )
+		{
+			options.jobs = atoi( argv[++i] );
+			batch = true;
+		}
+		else if( strcmp( argv[i], "--cache" ) == 0 && i + 1 < argc )
+			cacheDirectory = argv[++i];
+		else if( strcmp( argv[i], "--cache-size" ) == 0 && i + 1 < argc && isdigit( argv[i + 1][0] ) )
+			cacheLimit = (uint64_t)atoi( argv[++i] ) << 20;
+		else if( argv[i][0] == '@' )
+		{
+			batch = true;
+			if( !readResponseFile( argv[i] + 1, files, arena ) )
+			{
+				cout << argv[i] + 1 << " could not be opened." << endl;
+				badArgs = true;
+			}
+		}
+		else if( argv[i][0] == '-' && argv[i][1] == '-' )
+			badArgs = true;
+		else
+			files.add( argv[i] );
+	}
+
+	//stdout can only take the output of one file.
+	for( uint32_t i = 0; i < files.length(); i++ )
+		if( strcmp( files[i], STREAM_FILE ) == 0 && ( batch || files.length() > 1 ) )
+			badArgs = true;
+
+	if( files.length() == 0 || badArgs )
+	{
+		cout << "Usage: " << argv[0] << " [options] [--threads N] <input file | ->" << endl;
+		cout << "       " << argv[0] << " [options] [--jobs N] <input file | @list> ..." << endl;
+		cout << "Options: -O -O2 --strip --keep LABLE --pre --image --incremental --cache DIR --cache-size MB --stats --stats-json" << endl;
+		return 0;
+	}
+
+	Cache *cache = 0;
+	if( cacheDirectory != 0 )
 	{
-		cout << "Usage: " << argv[0] << " <input file>" << endl;
+		cache = new Cache( cacheDirectory, cacheLimit );
+		if( cache->isUsable() )
+			options.cache = cache;
+		else
+			cerr << cacheDirectory << " could not be used as a cache." << endl;
+	}
+
+	int status = 0;
+	if( batch || files.length() > 1 )
+	{
+		status = assembleBatch( files.data(), files.length(), options, cout ) == 0 ? 0 : 1;
 	}
 	else
 	{
-		Parser parser( argv[1] );
+		Parser parser( files[0] );
+		//The output goes to stdout so problems go to stderr.
+		bool stream = strcmp( files[0], STREAM_FILE ) == 0;
+		if( stream )
+			parser.setLog( &cerr );
+		parser.setWritePreProcessed( options.writePreProcessed );
+		parser.setIncremental( options.incremental );
+		parser.setOutputFormat( options.format );
+		parser.setThreads( options.threads );
+		parser.setOptimize( options.optimize );
+		parser.setStrip( options.strip );
+		for( uint32_t i = 0; i < roots.length(); i++ )
+			parser.addRoot( roots[i] );
+		parser.setCache( options.cache );
+		parser.setStats( stats );
 		parser.preprocess();
 		parser.parse();
+		if( stats )
+			parser.printStats( stream ? cerr : cout, statsJson );
+		status = parser.getErrors() == 0 ? 0 : 1;
 	}
-	return 0;
-#else
+
+	delete cache;
+	return status;
+#elif defined( TESTING )
 	testMain( argc, argv );
 	return 0;
+#else
+	return benchMain( argc, argv );
 #endif
 }
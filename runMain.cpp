@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <chrono>
+#include "Emulator.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*
+	lc2200-run: Runs the .bin or .img the parser wrote, with IN and OUT on
+	stdin and stdout.
+*/
+int main( int argc, char **argv )
+{
+	uint32_t memoryWords = EMULATOR_MEMORY;
+	uint64_t limit = 0;
+	bool stats = false;
+	bool badArgs = false;
+	const char *file = 0;
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "--memory" ) == 0 && i + 1 < argc && isdigit( argv[i + 1][0] ) )
+			memoryWords = strtoul( argv[++i], 0, 10 );
+		else if( strcmp( argv[i], "--limit" ) == 0 && i + 1 < argc && isdigit( argv[i + 1][0] ) )
+			limit = strtoull( argv[++i], 0, 10 );
+		else if( strcmp( argv[i], "--stats" ) == 0 )
+			stats = true;
+		else if( argv[i][0] == '-' && argv[i][1] == '-' )
+			badArgs = true;
+		else if( file == 0 )
+			file = argv[i];
+		else
+			badArgs = true;
+	}
+
+	if( file == 0 || badArgs )
+	{
+		cout << "Usage: " << argv[0] << " [--memory WORDS] [--limit N] [--stats] <file.bin | file.img>" << endl;
+		return 2;
+	}
+
+	Emulator emulator( memoryWords );
+	if( !emulator.load( file ) )
+	{
+		cerr << file << " could not be loaded." << endl;
+		return 2;
+	}
+
+	std::ios::sync_with_stdio( false );
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool halted = emulator.run( limit, std::cin, cout );
+	double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	cout.flush();
+
+	if( !halted )
+		cerr << file << " stopped at " << emulator.getPC() << " without a halt." << endl;
+	if( stats )
+	{
+		cerr << emulator.getSteps() << " instructions in " << seconds << " s, "
+			 << ( seconds > 0 ? emulator.getSteps() / seconds / 1e6 : 0 ) << " million a second" << endl;
+	}
+	return halted ? 0 : 1;
+}
@@ -6,7 +6,23 @@ using std::endl;
 void testMain( int argc, char **argv )
 {
 	testList( argc, argv );
+	testArray( argc, argv );
+	testArena( argc, argv );
+	testSymbolTable( argc, argv );
+	testTokenStore( argc, argv );
+	testSourceReader( argc, argv );
+	testLexer( argc, argv );
+	testLookup( argc, argv );
+	testThreadPool( argc, argv );
+	testEmitter( argc, argv );
+	testImage( argc, argv );
+	testIncremental( argc, argv );
+	testCache( argc, argv );
 	testParser( argc, argv );
+	testFlowGraph( argc, argv );
+	testOptimizer( argc, argv );
+	testBatch( argc, argv );
+	testEmulator( argc, argv );
 }
 
 void testList( int argc, char **argv )
@@ -21,6 +37,158 @@ void testList( int argc, char **argv )
 	testListReplace();
 	cout << "Test the addUnique method." << endl;
 	testListAddUnique();
+	cout << "Test list links in an arena." << endl;
+	testListArena();
+	cout << "Test list iterators." << endl;
+	testListIterator();
+	cout << "Test list indexing from the cursor." << endl;
+	testListCursor();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testArena( int argc, char **argv )
+{
+	cout << "Tests for the arena..." << endl;
+
+	cout << "Test allocating from an arena." << endl;
+	testArenaAllocate();
+	cout << "Test resetting an arena." << endl;
+	testArenaReset();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testArray( int argc, char **argv )
+{
+	cout << "Tests for the array class..." << endl;
+
+	cout << "Test array insert and get using []'s." << endl;
+	testArrayAdd();
+	cout << "Test array resize." << endl;
+	testArrayResize();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testSymbolTable( int argc, char **argv )
+{
+	cout << "Tests for the symbol table..." << endl;
+
+	cout << "Test the addUnique method." << endl;
+	testSymbolTableAddUnique();
+	cout << "Test symbols keep their discovery order." << endl;
+	testSymbolTableOrder();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testTokenStore( int argc, char **argv )
+{
+	cout << "Tests for the token store..." << endl;
+
+	cout << "Test adding a token to the store." << endl;
+	testTokenStoreAdd();
+	cout << "Test appending a token store." << endl;
+	testTokenStoreAppend();
+	cout << "Test compacting the store." << endl;
+	testTokenStoreCompact();
+	cout << "Test putting words into the store." << endl;
+	testTokenStoreInsert();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testSourceReader( int argc, char **argv )
+{
+	cout << "Tests for the source reader..." << endl;
+
+	cout << "Test splitting a mapped file into lines." << endl;
+	testSourceReaderLines();
+	cout << "Test a line longer than the read block." << endl;
+	testSourceReaderLongLine();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testLexer( int argc, char **argv )
+{
+	cout << "Tests for the lexer..." << endl;
+
+	cout << "Test lexing a whole line." << endl;
+	testLexerLine();
+	cout << "Test lexing an offset and base register." << endl;
+	testLexerOffsetOperand();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testLookup( int argc, char **argv )
+{
+	cout << "Tests for the mnemonic and register lookup..." << endl;
+
+	cout << "Test looking up mnemonics." << endl;
+	testLookupOpcode();
+	cout << "Test looking up registers." << endl;
+	testLookupRegister();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testThreadPool( int argc, char **argv )
+{
+	cout << "Tests for the thread pool..." << endl;
+
+	cout << "Test running tasks on the pool." << endl;
+	testThreadPoolRun();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testEmitter( int argc, char **argv )
+{
+	cout << "Tests for the emitter..." << endl;
+
+	cout << "Test writing words in hex." << endl;
+	testEmitterHex();
+	cout << "Test writing more than one buffer." << endl;
+	testEmitterLarge();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testImage( int argc, char **argv )
+{
+	cout << "Tests for the packed image..." << endl;
+
+	cout << "Test writing and mapping an image." << endl;
+	testImageRoundTrip();
+	cout << "Test refusing files that are not images." << endl;
+	testImageReject();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testIncremental( int argc, char **argv )
+{
+	cout << "Tests for the incremental state..." << endl;
+
+	cout << "Test writing and mapping a state." << endl;
+	testIncrementalRoundTrip();
+	cout << "Test refusing a state that was cut short." << endl;
+	testIncrementalReject();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testCache( int argc, char **argv )
+{
+	cout << "Tests for the cache..." << endl;
+
+	cout << "Test storing and fetching an entry." << endl;
+	testCacheStoreFetch();
+	cout << "Test removing the entries used longest ago." << endl;
+	testCacheEvict();
 
 	cout << "All Tests Passed." << endl;
 }
@@ -37,6 +205,10 @@ void testParser( int argc, char **argv )
 	testParserBEQ();
 	cout << "Test parsing out label" << endl;
 	testParserLabel();
+	cout << "Test rejecting unknown mnemonics and registers" << endl;
+	testParserUnknownNames();
+	cout << "Test parsing a line in place" << endl;
+	testParserInPlace();
 	
 	cout << "Test single register replacement and substitution for 'in'" << endl;
 	testParserSingleRegisterReplacementINX();
@@ -44,6 +216,8 @@ void testParser( int argc, char **argv )
 	testParserSingleRegisterReplacementOUTX();
 	cout << "Test two register replacement and substitution" << endl;
 	testParserTwoRegisterReplacementX();
+	cout << "Test the LW of a call to a lable or variable." << endl;
+	testParserCallFixup();
 	cout << "Test three register replacement and substitution, with one variable." << endl;
 	testParserVariableRegisterReplacementX();
 	cout << "Test three register replacement and substitution, with two variable." << endl;
@@ -52,7 +226,95 @@ void testParser( int argc, char **argv )
 	testParserVariableRegisterReplacementXYZ();
 	cout << "Test two register and offset replacement." << endl;
 	testParserTwoRegisterReplacementOffset();
+	cout << "Test folding constants into ADDI." << endl;
+	testParserConstantFolding();
+	cout << "Test the constant pool." << endl;
+	testParserConstantPool();
+	cout << "Test the scratch registers constants are loaded into." << endl;
+	testParserConstantScratch();
+	cout << "Test assembling in parallel chunks." << endl;
+	testParserParallel();
+	cout << "Test assembling from stdin to stdout." << endl;
+	testParserStream();
+	cout << "Test reassembling incrementally." << endl;
+	testParserIncremental();
+	cout << "Test reusing cached files." << endl;
+	testParserCache();
+	cout << "Test the stats of a run." << endl;
+	testParserStats();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testFlowGraph( int argc, char **argv )
+{
+	cout << "Tests for the flow graph..." << endl;
+
+	cout << "Test splitting the words into blocks." << endl;
+	testFlowGraphBlocks();
+	cout << "Test the edges between the blocks." << endl;
+	testFlowGraphEdges();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testOptimizer( int argc, char **argv )
+{
+	cout << "Tests for the optimizer..." << endl;
+
+	cout << "Test leaving out repeated loads." << endl;
+	testPeepholeRedundantLoads();
+	cout << "Test where the peephole forgets the registers." << endl;
+	testPeepholeBoundaries();
+	cout << "Test running an optimized program." << endl;
+	testPeepholeProgram();
+	cout << "Test loads across the blocks of a loop." << endl;
+	testOptimizerLoop();
+	cout << "Test where blocks join." << endl;
+	testOptimizerJoins();
+	cout << "Test the tests/ programs with -O." << endl;
+	testOptimizerEquivalence();
+	cout << "Test promoting variables into registers." << endl;
+	testOptimizerPromote();
+	cout << "Test running a program with promoted variables." << endl;
+	testOptimizerPromoteProgram();
+	cout << "Test finding the code that is not reached." << endl;
+	testOptimizerUnreachable();
+	cout << "Test running a stripped program." << endl;
+	testOptimizerStripProgram();
+	cout << "Test running a program that calls a routine." << endl;
+	testOptimizerCallProgram();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testBatch( int argc, char **argv )
+{
+	cout << "Tests for batch mode..." << endl;
+
+	cout << "Test assembling a batch of files." << endl;
+	testBatchAssemble();
+	cout << "Test reading a response file." << endl;
+	testBatchResponseFile();
+
+	cout << "All Tests Passed." << endl;
+}
+
+void testEmulator( int argc, char **argv )
+{
+	cout << "Tests for the emulator..." << endl;
+
+	cout << "Test running a program with variables." << endl;
+	testEmulatorVariables();
+	cout << "Test running a loop." << endl;
+	testEmulatorLoop();
+	cout << "Test jalr and $zero." << endl;
+	testEmulatorJalr();
+	cout << "Test storing into code." << endl;
+	testEmulatorStoreCode();
+	cout << "Test the instruction limit." << endl;
+	testEmulatorLimit();
 
 	cout << "All Tests Passed." << endl;
 }
-#endif
\ No newline at end of file
+#endif
@@ -6,10 +6,58 @@
 #include <iostream>
 #include "Parser.h"
 #include "List.h"
+#include "Array.h"
+#include "Arena.h"
+#include "SymbolTable.h"
+#include "TokenStore.h"
+#include "SourceReader.h"
+#include "Lexer.h"
+#include "Lookup.h"
+#include "ThreadPool.h"
+#include "Emitter.h"
+#include "Image.h"
+#include "Incremental.h"
+#include "FlowGraph.h"
+#include "Optimizer.h"
+#include "Cache.h"
+#include "Batch.h"
+#include "Emulator.h"
 
 void testMain( int argc, char **argv );
 
 void testList( int argc, char **argv );
 
+void testArray( int argc, char **argv );
+
+void testArena( int argc, char **argv );
+
+void testSymbolTable( int argc, char **argv );
+
+void testTokenStore( int argc, char **argv );
+
+void testSourceReader( int argc, char **argv );
+
+void testLexer( int argc, char **argv );
+
+void testLookup( int argc, char **argv );
+
+void testThreadPool( int argc, char **argv );
+
+void testEmitter( int argc, char **argv );
+
+void testImage( int argc, char **argv );
+
+void testIncremental( int argc, char **argv );
+
+void testCache( int argc, char **argv );
+
 void testParser( int argc, char **argv );
+
+void testFlowGraph( int argc, char **argv );
+
+void testOptimizer( int argc, char **argv );
+
+void testBatch( int argc, char **argv );
+
+void testEmulator( int argc, char **argv );
 #endif
\ No newline at end of file